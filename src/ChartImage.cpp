@@ -1,6 +1,7 @@
 #include "ChartImage.h"
 #include "debug.h"
 #include "ChartItemTools.h"
+#include "scene.h"
 #include <QMessageBox>
 
 ChartImage::ChartImage(const QString& filename, QGraphicsItem* parent):
@@ -38,9 +39,22 @@ ChartImage::ChartImage(QDataStream& stream, QGraphicsItem* parent):
 
 ChartImage::~ChartImage()
 {
+	Scene::layerItemChange(this, mLayer, ItemSceneChange);
 	delete mPixmap;
 }
 
+QVariant ChartImage::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+	Scene::layerItemChange(this, mLayer, change);
+	return QGraphicsObject::itemChange(change, value);
+}
+
+void ChartImage::setLayer(unsigned int layer)
+{
+	Scene::layerItemMoved(this, mLayer, layer);
+	mLayer = layer;
+}
+
 QRectF ChartImage::boundingRect() const
 {
 	
@@ -24,13 +24,16 @@ public:
 	const QPixmap* pixmap() const { return mPixmap; } 
 	
 	unsigned int layer() const { return mLayer; }
-	void setLayer(unsigned int layer) { mLayer = layer; }
+	void setLayer(unsigned int layer);
 	
 	const QString& filename() const { return mFilename; }
 	void setFile(const QString& filename);
 	
 	void setZLayer(const QString& zlayer);
 	const QString& ZLayer() const { return mZLayer; }
+
+protected:
+	QVariant itemChange(GraphicsItemChange change, const QVariant &value);
 	
 private:
 	unsigned int mLayer;
@@ -0,0 +1,489 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "bandwriter.h"
+
+#include "debug.h"
+
+//the size of the png IDAT chunks, in bytes.
+#define PNG_CHUNK_SIZE (64 * 1024)
+//the largest prime below 2^16, used by the adler32 checksum.
+#define PNG_ADLER_BASE 65521
+//the most bytes that can be added to the adler32 sums before they overflow.
+#define PNG_ADLER_NMAX 5552
+//the number of rows in each tiff strip.
+#define TIFF_ROWS_PER_STRIP 16
+
+static void putBigEndian32(QByteArray *data, quint32 value)
+{
+    data->append(char(value >> 24));
+    data->append(char(value >> 16));
+    data->append(char(value >> 8));
+    data->append(char(value));
+}
+
+static void putLittleEndian16(QByteArray *data, quint16 value)
+{
+    data->append(char(value));
+    data->append(char(value >> 8));
+}
+
+static void putLittleEndian32(QByteArray *data, quint32 value)
+{
+    data->append(char(value));
+    data->append(char(value >> 8));
+    data->append(char(value >> 16));
+    data->append(char(value >> 24));
+}
+
+static quint32 crc32(const QByteArray &data)
+{
+    static quint32 table[256];
+    static bool tableReady = false;
+
+    if(!tableReady) {
+        for(quint32 n = 0; n < 256; ++n) {
+            quint32 c = n;
+            for(int k = 0; k < 8; ++k)
+                c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+            table[n] = c;
+        }
+        tableReady = true;
+    }
+
+    quint32 crc = 0xffffffff;
+    const uchar *p = (const uchar*)data.constData();
+    for(int i = 0; i < data.size(); ++i)
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+
+    return crc ^ 0xffffffff;
+}
+
+BandWriter* BandWriter::create(const QString &format)
+{
+    QString f = format.toLower();
+    if(f == "png")
+        return new PngBandWriter();
+    if(f == "tiff" || f == "tif")
+        return new TiffBandWriter();
+    return 0;
+}
+
+bool BandWriter::canWrite(const QString &format)
+{
+    QString f = format.toLower();
+    return (f == "png" || f == "tiff" || f == "tif");
+}
+
+BandWriter::BandWriter()
+    : mDotsPerMeter(0),
+      mRows(0)
+{
+}
+
+BandWriter::~BandWriter()
+{
+    if(mFile.isOpen())
+        mFile.close();
+}
+
+bool BandWriter::begin(const QString &fileName, QSize size, int dotsPerMeter)
+{
+    if(size.isEmpty())
+        return false;
+
+    mFile.setFileName(fileName);
+    if(!mFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        WARN("could not open " + fileName + " for writing");
+        return false;
+    }
+
+    mSize = size;
+    mDotsPerMeter = dotsPerMeter;
+    mRows = 0;
+    mRow.resize(size.width() * 3);
+
+    return writeHeader();
+}
+
+bool BandWriter::writeBand(const QImage &band)
+{
+    if(band.width() != mSize.width() || mRows + band.height() > mSize.height())
+        return false;
+
+    QImage img = band;
+    if(img.format() != QImage::Format_ARGB32 && img.format() != QImage::Format_RGB32)
+        img = img.convertToFormat(QImage::Format_RGB32);
+
+    uchar *rgb = (uchar*)mRow.data();
+    for(int y = 0; y < img.height(); ++y) {
+        const QRgb *line = (const QRgb*)img.constScanLine(y);
+        for(int x = 0; x < img.width(); ++x) {
+            rgb[x * 3] = qRed(line[x]);
+            rgb[x * 3 + 1] = qGreen(line[x]);
+            rgb[x * 3 + 2] = qBlue(line[x]);
+        }
+
+        if(!writeRow(rgb))
+            return false;
+        mRows++;
+    }
+
+    return true;
+}
+
+bool BandWriter::finish()
+{
+    if(mRows != mSize.height())
+        return false;
+
+    bool ok = writeFooter();
+    mFile.close();
+    return ok;
+}
+
+/*************************************************************\
+| PngBandWriter                                               |
+\*************************************************************/
+PngBandWriter::PngBandWriter()
+    : mBitBuffer(0),
+      mBitCount(0),
+      mLastByte(-1),
+      mAdlerA(1),
+      mAdlerB(0)
+{
+}
+
+bool PngBandWriter::writeChunk(const char *type, const QByteArray &data)
+{
+    QByteArray chunk;
+    putBigEndian32(&chunk, data.size());
+
+    QByteArray body(type, 4);
+    body.append(data);
+    chunk.append(body);
+    putBigEndian32(&chunk, crc32(body));
+
+    return (mFile.write(chunk) == chunk.size());
+}
+
+bool PngBandWriter::writeHeader()
+{
+    if(mFile.write("\x89PNG\r\n\x1a\n", 8) != 8)
+        return false;
+
+    QByteArray header;
+    putBigEndian32(&header, mSize.width());
+    putBigEndian32(&header, mSize.height());
+    header.append(char(8));    //bit depth
+    header.append(char(2));    //color type: rgb
+    header.append(char(0));    //compression: deflate
+    header.append(char(0));    //filter: adaptive
+    header.append(char(0));    //no interlace
+    if(!writeChunk("IHDR", header))
+        return false;
+
+    if(mDotsPerMeter > 0) {
+        QByteArray phys;
+        putBigEndian32(&phys, mDotsPerMeter);
+        putBigEndian32(&phys, mDotsPerMeter);
+        phys.append(char(1)); //meters
+        if(!writeChunk("pHYs", phys))
+            return false;
+    }
+
+    mData.clear();
+    mBitBuffer = 0;
+    mBitCount = 0;
+    mLastByte = -1;
+    mAdlerA = 1;
+    mAdlerB = 0;
+    mFiltered.resize(mSize.width() * 3 + 1);
+
+    //zlib header, then one block using the fixed codes that holds all the rows.
+    mData.append(char(0x78));
+    mData.append(char(0x01));
+    writeBits(0, 1);
+    writeBits(1, 2);
+
+    return true;
+}
+
+bool PngBandWriter::writeRow(const uchar *rgb)
+{
+    //the Sub filter turns runs of the same color into runs of zeros.
+    uchar *f = (uchar*)mFiltered.data();
+    int size = mSize.width() * 3;
+    f[0] = 1;
+    for(int i = 0; i < size; ++i)
+        f[i + 1] = (i < 3) ? rgb[i] : uchar(rgb[i] - rgb[i - 3]);
+
+    const uchar *p = f;
+    int left = size + 1;
+    while(left > 0) {
+        int n = qMin(left, PNG_ADLER_NMAX);
+        left -= n;
+        while(n--) {
+            mAdlerA += *p++;
+            mAdlerB += mAdlerA;
+        }
+        mAdlerA %= PNG_ADLER_BASE;
+        mAdlerB %= PNG_ADLER_BASE;
+    }
+
+    compress(f, size + 1);
+    return flushData(false);
+}
+
+bool PngBandWriter::writeFooter()
+{
+    //end the block, then an empty final block.
+    writeCode(0, 7);
+    writeBits(1, 1);
+    writeBits(1, 2);
+    writeCode(0, 7);
+    if(mBitCount > 0)
+        writeBits(0, 8 - mBitCount);
+
+    putBigEndian32(&mData, (mAdlerB << 16) | mAdlerA);
+
+    if(!flushData(true))
+        return false;
+    return writeChunk("IEND", QByteArray());
+}
+
+void PngBandWriter::writeBits(quint32 bits, int count)
+{
+    mBitBuffer |= bits << mBitCount;
+    mBitCount += count;
+    while(mBitCount >= 8) {
+        mData.append(char(mBitBuffer & 0xff));
+        mBitBuffer >>= 8;
+        mBitCount -= 8;
+    }
+}
+
+void PngBandWriter::writeCode(quint32 code, int length)
+{
+    quint32 reversed = 0;
+    for(int i = 0; i < length; ++i)
+        reversed |= ((code >> i) & 1) << (length - 1 - i);
+    writeBits(reversed, length);
+}
+
+void PngBandWriter::writeLiteral(int value)
+{
+    if(value < 144)
+        writeCode(0x30 + value, 8);
+    else
+        writeCode(0x190 + value - 144, 9);
+}
+
+void PngBandWriter::writeRun(int length)
+{
+    static const int base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const int extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                   3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+    int i = 28;
+    while(base[i] > length)
+        --i;
+
+    int code = 257 + i;
+    if(code < 280)
+        writeCode(code - 256, 7);
+    else
+        writeCode(0xc0 + code - 280, 8);
+    writeBits(length - base[i], extra[i]);
+
+    //every match repeats the byte before it, distance 1.
+    writeCode(0, 5);
+}
+
+void PngBandWriter::compress(const uchar *data, int size)
+{
+    int i = 0;
+    while(i < size) {
+        uchar c = data[i];
+        if(c == mLastByte) {
+            int run = 1;
+            while(i + run < size && run < 258 && data[i + run] == c)
+                run++;
+            if(run >= 3) {
+                writeRun(run);
+                i += run;
+                continue;
+            }
+        }
+
+        writeLiteral(c);
+        mLastByte = c;
+        ++i;
+    }
+}
+
+bool PngBandWriter::flushData(bool force)
+{
+    if(mData.isEmpty() || (!force && mData.size() < PNG_CHUNK_SIZE))
+        return true;
+
+    bool ok = writeChunk("IDAT", mData);
+    mData.clear();
+    return ok;
+}
+
+/*************************************************************\
+| TiffBandWriter                                              |
+\*************************************************************/
+TiffBandWriter::TiffBandWriter()
+{
+}
+
+bool TiffBandWriter::writeHeader()
+{
+    mStripOffsets.clear();
+    mStripSizes.clear();
+
+    //little endian, the offset of the directory is filled in by writeFooter().
+    QByteArray header("II");
+    putLittleEndian16(&header, 42);
+    putLittleEndian32(&header, 0);
+
+    return (mFile.write(header) == header.size());
+}
+
+bool TiffBandWriter::writeRow(const uchar *rgb)
+{
+    if(mRows % TIFF_ROWS_PER_STRIP == 0) {
+        mStripOffsets.append(mFile.pos());
+        mStripSizes.append(0);
+    }
+
+    //PackBits: a header n >= 0 is followed by n + 1 bytes, n < 0 repeats the next byte 1 - n times.
+    int size = mSize.width() * 3;
+    mPacked.resize(0);
+    int i = 0;
+    while(i < size) {
+        int run = 1;
+        while(i + run < size && run < 128 && rgb[i + run] == rgb[i])
+            run++;
+
+        if(run >= 2) {
+            mPacked.append(char(1 - run));
+            mPacked.append(char(rgb[i]));
+            i += run;
+            continue;
+        }
+
+        int start = i;
+        int count = 0;
+        while(i < size && count < 128) {
+            if(i + 1 < size && rgb[i] == rgb[i + 1])
+                break;
+            ++i;
+            ++count;
+        }
+        mPacked.append(char(count - 1));
+        mPacked.append((const char*)rgb + start, count);
+    }
+
+    if(mFile.write(mPacked) != mPacked.size())
+        return false;
+    mStripSizes.last() += mPacked.size();
+
+    //the offsets in a tiff file are 32 bits.
+    return (mFile.pos() < Q_INT64_C(0xffffffff));
+}
+
+bool TiffBandWriter::writeFooter()
+{
+    qint64 pos = mFile.pos();
+    QByteArray data;
+    if(pos % 2)
+        data.append(char(0));
+
+    //values that don't fit in a directory entry go before the directory.
+    quint32 bitsOffset = pos + data.size();
+    for(int i = 0; i < 3; ++i)
+        putLittleEndian16(&data, 8);
+
+    quint32 resolution = mDotsPerMeter > 0 ? mDotsPerMeter * 254 : 96 * 10000;
+    quint32 xResOffset = pos + data.size();
+    putLittleEndian32(&data, resolution);
+    putLittleEndian32(&data, 10000);
+    quint32 yResOffset = pos + data.size();
+    putLittleEndian32(&data, resolution);
+    putLittleEndian32(&data, 10000);
+
+    int strips = mStripOffsets.count();
+    quint32 offsetsOffset = mStripOffsets.first();
+    quint32 sizesOffset = mStripSizes.first();
+    if(strips > 1) {
+        offsetsOffset = pos + data.size();
+        foreach(quint32 offset, mStripOffsets)
+            putLittleEndian32(&data, offset);
+        sizesOffset = pos + data.size();
+        foreach(quint32 size, mStripSizes)
+            putLittleEndian32(&data, size);
+    }
+
+    quint32 directoryOffset = pos + data.size();
+
+    enum { Short = 3, Long = 4, Rational = 5 };
+    struct Entry { quint16 tag; quint16 type; quint32 count; quint32 value; };
+    Entry entries[] = {
+        { 256, Long, 1, (quint32)mSize.width() },
+        { 257, Long, 1, (quint32)mSize.height() },
+        { 258, Short, 3, bitsOffset },              //bits per sample
+        { 259, Short, 1, 32773 },                   //compression: PackBits
+        { 262, Short, 1, 2 },                       //photometric: rgb
+        { 273, Long, (quint32)strips, offsetsOffset },
+        { 277, Short, 1, 3 },                       //samples per pixel
+        { 278, Long, 1, TIFF_ROWS_PER_STRIP },
+        { 279, Long, (quint32)strips, sizesOffset },
+        { 282, Rational, 1, xResOffset },
+        { 283, Rational, 1, yResOffset },
+        { 296, Short, 1, 2 }                        //resolution unit: inch
+    };
+    int count = sizeof(entries) / sizeof(Entry);
+
+    putLittleEndian16(&data, count);
+    for(int i = 0; i < count; ++i) {
+        putLittleEndian16(&data, entries[i].tag);
+        putLittleEndian16(&data, entries[i].type);
+        putLittleEndian32(&data, entries[i].count);
+        //a single short is stored in the first two bytes of the value.
+        if(entries[i].type == Short && entries[i].count == 1) {
+            putLittleEndian16(&data, entries[i].value);
+            putLittleEndian16(&data, 0);
+        } else {
+            putLittleEndian32(&data, entries[i].value);
+        }
+    }
+    putLittleEndian32(&data, 0);
+
+    if(mFile.write(data) != data.size())
+        return false;
+
+    QByteArray offset;
+    putLittleEndian32(&offset, directoryOffset);
+    return (mFile.seek(4) && mFile.write(offset) == offset.size());
+}
@@ -0,0 +1,122 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef BANDWRITER_H
+#define BANDWRITER_H
+
+#include <QFile>
+#include <QImage>
+#include <QVector>
+
+/**
+ * A BandWriter saves an image that is drawn a few rows at a time,
+ * so a large export never has the whole image in memory.
+ *
+ * The bands are written top to bottom, every band has the width the
+ * writer was started with. Only the colors are saved, not the alpha.
+ */
+class BandWriter
+{
+public:
+    /**
+     * Returns a writer for @format (png or tiff) or 0 if the format can't be written in bands.
+     */
+    static BandWriter* create(const QString &format);
+    static bool canWrite(const QString &format);
+
+    virtual ~BandWriter();
+
+    bool begin(const QString &fileName, QSize size, int dotsPerMeter);
+    bool writeBand(const QImage &band);
+    bool finish();
+
+    QString errorString() const { return mFile.errorString(); }
+
+protected:
+    BandWriter();
+
+    virtual bool writeHeader() = 0;
+    virtual bool writeRow(const uchar *rgb) = 0;
+    virtual bool writeFooter() = 0;
+
+    QFile mFile;
+    QSize mSize;
+    int mDotsPerMeter;
+    int mRows;
+
+private:
+    QByteArray mRow;
+};
+
+/**
+ * 24 bit png, the rows use the Sub filter and are compressed with
+ * run length matches and the fixed deflate codes.
+ */
+class PngBandWriter : public BandWriter
+{
+public:
+    PngBandWriter();
+
+protected:
+    bool writeHeader();
+    bool writeRow(const uchar *rgb);
+    bool writeFooter();
+
+private:
+    bool writeChunk(const char *type, const QByteArray &data);
+
+    void writeBits(quint32 bits, int count);
+    //huffman codes are written starting with the most significant bit.
+    void writeCode(quint32 code, int length);
+    void writeLiteral(int value);
+    void writeRun(int length);
+    void compress(const uchar *data, int size);
+    bool flushData(bool force);
+
+    QByteArray mData;
+    quint32 mBitBuffer;
+    int mBitCount;
+
+    QByteArray mFiltered;
+    int mLastByte;
+    quint32 mAdlerA;
+    quint32 mAdlerB;
+};
+
+/**
+ * 24 bit tiff, each row is compressed with PackBits.
+ */
+class TiffBandWriter : public BandWriter
+{
+public:
+    TiffBandWriter();
+
+protected:
+    bool writeHeader();
+    bool writeRow(const uchar *rgb);
+    bool writeFooter();
+
+private:
+    QVector<quint32> mStripOffsets;
+    QVector<quint32> mStripSizes;
+    QByteArray mPacked;
+};
+
+#endif // BANDWRITER_H
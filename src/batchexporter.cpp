@@ -0,0 +1,321 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "batchexporter.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QProcess>
+#include <QThread>
+
+#include <math.h>
+
+#include "mainwindow.h"
+#include "ui_mainwindow.h"
+#include "exportui.h"
+#include "crochettab.h"
+#include "debug.h"
+
+//how long to wait on each worker before checking the next one, in ms.
+#define BATCH_POLL_INTERVAL 50
+//the resolution the charts are drawn at on screen.
+#define BATCH_SCREEN_DPI 96.0
+
+BatchExporter::BatchExporter(const QStringList &arguments)
+    : mFormat("png"),
+      mDpi((int)BATCH_SCREEN_DPI),
+      mOutDir("."),
+      mLegends(false),
+      mJobs(QThread::idealThreadCount()),
+      mValid(false)
+{
+    mValid = parseArguments(arguments);
+}
+
+bool BatchExporter::isBatchExport(const QStringList &arguments)
+{
+    return arguments.contains("--export");
+}
+
+bool BatchExporter::parseArguments(QStringList arguments)
+{
+    while(!arguments.isEmpty()) {
+        QString arg = arguments.takeFirst();
+
+        if(arg == "--legends") {
+            mLegends = true;
+            continue;
+        }
+
+        if(arg == "--export") {
+            while(!arguments.isEmpty() && !arguments.first().startsWith("--"))
+                mFiles.append(arguments.takeFirst());
+            continue;
+        }
+
+        if(arguments.isEmpty()) {
+            qWarning() << "Missing value for" << arg;
+            return false;
+        }
+
+        QString value = arguments.takeFirst();
+        if(arg == "--format") {
+            mFormat = value.toLower();
+            if(mFormat == "jpg")
+                mFormat = "jpeg";
+        } else if(arg == "--dpi") {
+            mDpi = value.toInt();
+        } else if(arg == "--out") {
+            mOutDir = value;
+        } else if(arg == "--jobs") {
+            mJobs = value.toInt();
+        } else if(arg == "--name") {
+            mName = value;
+        } else {
+            qWarning() << "Unknown option" << arg;
+            return false;
+        }
+    }
+
+    QStringList formats;
+    formats << "pdf" << "svg" << "jpeg" << "png" << "tiff" << "bmp";
+    if(!formats.contains(mFormat)) {
+        qWarning() << "Unknown export format" << mFormat;
+        return false;
+    }
+
+    if(mFiles.isEmpty() || mDpi <= 0) {
+        qWarning() << "Usage: --export <file.pattern>... [--format png] [--dpi 96] [--out folder] [--legends] [--jobs N]";
+        return false;
+    }
+
+    mJobs = qMax(1, mJobs);
+    return true;
+}
+
+int BatchExporter::run()
+{
+    if(!mValid)
+        return 2;
+
+    if(!QDir().mkpath(mOutDir)) {
+        qWarning() << "Could not create the output folder" << mOutDir;
+        return 1;
+    }
+
+    assignBaseNames();
+
+    if(mFiles.count() > 1 && mJobs > 1)
+        return runWorkers();
+
+    int failed = 0;
+    for(int i = 0; i < mFiles.count(); ++i) {
+        if(!exportFile(mFiles.at(i), mBaseNames.at(i)))
+            failed++;
+    }
+
+    return (failed > 0) ? 1 : 0;
+}
+
+void BatchExporter::assignBaseNames()
+{
+    mBaseNames.clear();
+    if(!mName.isEmpty() && mFiles.count() == 1) {
+        mBaseNames.append(mName);
+        return;
+    }
+
+    //the workers don't know about each other's files, so a/x.pattern and b/x.pattern
+    //are told apart here. Lower case, file systems may not care about the case.
+    QSet<QString> names;
+    foreach(QString fileName, mFiles)
+        names.insert(QFileInfo(fileName).completeBaseName().toLower());
+
+    QSet<QString> used;
+    foreach(QString fileName, mFiles) {
+        QString base = QFileInfo(fileName).completeBaseName();
+        QString name = base;
+        for(int i = 2; used.contains(name.toLower()) || (name != base && names.contains(name.toLower())); ++i)
+            name = base + "-" + QString::number(i);
+
+        used.insert(name.toLower());
+        mBaseNames.append(name);
+    }
+}
+
+QStringList BatchExporter::workerArguments(const QString &fileName, const QString &baseName) const
+{
+    QStringList args;
+    args << "--export" << fileName << "--name" << baseName << "--format" << mFormat
+         << "--dpi" << QString::number(mDpi) << "--out" << mOutDir << "--jobs" << "1";
+    if(mLegends)
+        args << "--legends";
+    return args;
+}
+
+int BatchExporter::runWorkers()
+{
+    int next = 0;
+    QList<QProcess*> running;
+    int failed = 0;
+
+    while(next < mFiles.count() || !running.isEmpty()) {
+
+        while(running.count() < mJobs && next < mFiles.count()) {
+            QProcess *p = new QProcess();
+            p->setProcessChannelMode(QProcess::ForwardedChannels);
+            p->start(QCoreApplication::applicationFilePath(), workerArguments(mFiles.at(next), mBaseNames.at(next)));
+            ++next;
+            if(!p->waitForStarted()) {
+                qWarning() << "Could not start an export process:" << p->errorString();
+                failed++;
+                delete p;
+                continue;
+            }
+            running.append(p);
+        }
+
+        for(int i = running.count() - 1; i >= 0; --i) {
+            QProcess *p = running.at(i);
+            if(p->state() != QProcess::NotRunning && !p->waitForFinished(BATCH_POLL_INTERVAL))
+                continue;
+
+            if(p->exitStatus() != QProcess::NormalExit || p->exitCode() != 0)
+                failed++;
+            running.removeAt(i);
+            delete p;
+        }
+    }
+
+    return (failed > 0) ? 1 : 0;
+}
+
+QString BatchExporter::outputFile(const QString &baseName, const QString &part)
+{
+    QString name = baseName;
+    if(!part.isEmpty()) {
+        //chart names can have characters that aren't allowed in file names.
+        QString safe = part;
+        safe.replace(QRegExp("[^A-Za-z0-9 _.-]"), "_");
+        name += "-" + safe;
+    }
+
+    QString file = QDir(mOutDir).filePath(name + "." + mFormat);
+    for(int i = 2; mOutputFiles.contains(file.toLower()); ++i)
+        file = QDir(mOutDir).filePath(name + "-" + QString::number(i) + "." + mFormat);
+
+    mOutputFiles.insert(file.toLower());
+    return file;
+}
+
+bool BatchExporter::exportFile(const QString &fileName, const QString &baseName)
+{
+    //the window is never shown, it holds the tabs the file is loaded into.
+    MainWindow w(QStringList(), 0, true);
+    w.mFile->fileName = fileName;
+
+    FileFactory::FileError error = w.mFile->load();
+    if(error == FileFactory::No_Error)
+        error = w.mFile->loadPendingCharts();
+
+    if(error != FileFactory::No_Error) {
+        qWarning() << "Could not load" << fileName << "error:" << error;
+        return false;
+    }
+
+    bool ok = exportCharts(&w, baseName);
+    if(mLegends && !exportLegends(&w, baseName))
+        ok = false;
+
+    return ok;
+}
+
+bool BatchExporter::exportCharts(MainWindow *w, const QString &baseName)
+{
+    QTabWidget *tabs = w->ui->tabWidget;
+    ExportUi exporter(tabs, &w->mPatternStitches, &w->mPatternColors, w);
+    exporter.exportType = mFormat;
+    exporter.resolution = mDpi;
+    exporter.pageToChartSize = true;
+    exporter.selectionOnly = false;
+    exporter.includeHeaderFooter = false;
+
+    //a pdf has a page for each chart.
+    if(mFormat == "pdf") {
+        exporter.setSelection(ExportUi::tr("All Charts"));
+        exporter.selection = ExportUi::tr("All Charts");
+        exporter.fileName = outputFile(baseName, QString());
+        return exporter.exportFile();
+    }
+
+    bool ok = true;
+
+    for(int i = 0; i < tabs->count(); ++i) {
+        CrochetTab *tab = qobject_cast<CrochetTab*>(tabs->widget(i));
+        if(!tab)
+            continue;
+
+        QString name = tabs->tabText(i);
+        exporter.setSelection(name);
+        exporter.selection = name;
+        exporter.fileName = outputFile(baseName, name);
+
+        //images are scaled to the resolution, svg keeps the scene size.
+        QRectF rect = tab->scene()->itemsBoundingRect();
+        qreal scale = (mFormat == "svg") ? 1.0 : mDpi / BATCH_SCREEN_DPI;
+        exporter.width = ceil(rect.width() * scale);
+        exporter.height = ceil(rect.height() * scale);
+
+        if(!exporter.exportFile())
+            ok = false;
+    }
+
+    return ok;
+}
+
+bool BatchExporter::exportLegends(MainWindow *w, const QString &baseName)
+{
+    ExportUi exporter(w->ui->tabWidget, &w->mPatternStitches, &w->mPatternColors, w);
+    exporter.exportType = mFormat;
+    exporter.resolution = mDpi;
+    exporter.pageToChartSize = true;
+    exporter.selectionOnly = false;
+    exporter.includeHeaderFooter = false;
+
+    bool ok = true;
+    if(!w->mPatternStitches.isEmpty()) {
+        exporter.setSelection(ExportUi::tr("Stitch Legend"));
+        exporter.selection = ExportUi::tr("Stitch Legend");
+        exporter.fileName = outputFile(baseName, "stitches");
+        if(!exporter.exportFile())
+            ok = false;
+    }
+
+    if(!w->mPatternColors.isEmpty()) {
+        exporter.setSelection(ExportUi::tr("Color Legend"));
+        exporter.selection = ExportUi::tr("Color Legend");
+        exporter.fileName = outputFile(baseName, "colors");
+        if(!exporter.exportFile())
+            ok = false;
+    }
+
+    return ok;
+}
@@ -0,0 +1,98 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef BATCHEXPORTER_H
+#define BATCHEXPORTER_H
+
+#include <QStringList>
+#include <QSet>
+
+class MainWindow;
+
+/**
+ * Export the charts of pattern files from the command line without showing a window:
+ *
+ *   CrochetCharts --export <file.pattern>... [--format png] [--dpi 96] [--out folder]
+ *                 [--legends] [--jobs N]
+ *
+ * Each chart is saved as <out>/<file>-<chart>.<format>, a pdf has all the charts
+ * in <out>/<file>.pdf. --legends also saves the stitch and color legends.
+ * Charts whose names end up as the same file name get a number added: <file>-<chart>-2.<format>.
+ * Files with the same name in different folders get a number added too: <file>-2-<chart>.<format>.
+ *
+ * The exit code is 1 if any file or chart could not be exported.
+ *
+ * When there is more than one file each file is exported by its own copy of the
+ * program, up to --jobs at a time (the number of cores by default). Each copy is
+ * given the name to use for its file's output with --name.
+ */
+class BatchExporter
+{
+public:
+    BatchExporter(const QStringList &arguments);
+
+    /**
+     * Returns true if @arguments ask for a batch export.
+     */
+    static bool isBatchExport(const QStringList &arguments);
+
+    /**
+     * Export all the files, returns the exit code for the program.
+     */
+    int run();
+
+private:
+    bool parseArguments(QStringList arguments);
+
+    /**
+     * Run one worker process per file, @mJobs at a time.
+     */
+    int runWorkers();
+    /**
+     * Give every file a base name for its output that no other file uses.
+     */
+    void assignBaseNames();
+    bool exportFile(const QString &fileName, const QString &baseName);
+    bool exportCharts(MainWindow *w, const QString &baseName);
+    bool exportLegends(MainWindow *w, const QString &baseName);
+
+    /**
+     * A file name in the output folder that hasn't been used by this export yet.
+     */
+    QString outputFile(const QString &baseName, const QString &part);
+    QStringList workerArguments(const QString &fileName, const QString &baseName) const;
+
+    QStringList mFiles;
+    //the output name of each file in mFiles.
+    QStringList mBaseNames;
+    //the name given by --name, the parent process picks it for a worker.
+    QString mName;
+    QString mFormat;
+    int mDpi;
+    QString mOutDir;
+    bool mLegends;
+    int mJobs;
+    bool mValid;
+
+    //lower case, file systems may not care about the case.
+    QSet<QString> mOutputFiles;
+};
+
+#endif // BATCHEXPORTER_H
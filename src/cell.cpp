@@ -27,6 +27,8 @@
 #include "stitchset.h"
 #include "settings.h"
 #include "ChartItemTools.h"
+#include "stitchspritecache.h"
+#include "scene.h"
 #include <QStyleOption>
 #include <QEvent>
 
@@ -50,6 +52,19 @@ Cell::Cell(QGraphicsItem *parent)
 
 Cell::~Cell()
 {
+    Scene::layerItemChange(this, mLayer, ItemSceneChange);
+}
+
+QVariant Cell::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    Scene::layerItemChange(this, mLayer, change);
+    return QGraphicsSvgItem::itemChange(change, value);
+}
+
+void Cell::setLayer(unsigned int layer)
+{
+    Scene::layerItemMoved(this, mLayer, layer);
+    mLayer = layer;
 }
 
 QRectF Cell::boundingRect() const
@@ -79,6 +94,23 @@ void Cell::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
         painter->fillRect(option->rect, option->palette.highlight());
 
     if(stitch()->isSvg()) {
+        //Only paint from the sprite cache on screen, exports and prints keep the vector output.
+        if(widget && !StitchSpriteCache::isVectorDevice(painter)) {
+            QImage sprite = StitchSpriteCache::inst()->sprite(stitch(), mColor, painter);
+            if(!sprite.isNull()) {
+                painter->save();
+                painter->setRenderHint(QPainter::SmoothPixmapTransform);
+                painter->drawImage(boundingRect(), sprite);
+                painter->restore();
+
+                if(option->state & QStyle::State_Selected) {
+                    painter->setPen(Qt::DashLine);
+                    painter->drawRect(boundingRect());
+                    painter->setPen(Qt::SolidLine);
+                }
+                return;
+            }
+        }
         QGraphicsSvgItem::paint(painter, option, widget);
     } else {
         painter->drawPixmap(option->rect.x(), option->rect.y(), *(stitch()->renderPixmap()));
@@ -216,24 +248,28 @@ QString Cell::name()
 void Cell::useAlternateRenderer(bool useAlt)
 {
     if(mStitch->isSvg() && mStitch->renderSvg()->isValid()) {
-        QString primary = Settings::inst()->value("stitchPrimaryColor").toString();
-        QString secondary = Settings::inst()->value("stitchAlternateColor").toString();
-        QString color;
-
-        //only use the primary and secondary colors if the stitch is using the default colors.
-        if(useAlt && mColor == primary) {
-            color = secondary;
-        } else if(!useAlt && mColor == secondary) {
-            color = primary;
-        } else {
-            color = mColor.name();
-        }
-
-        mColor = QColor(color);
+        mColor = alternateColor(mStitch, mColor, useAlt);
         setSharedRenderer(mStitch->renderSvg(mColor.name()));
     }
 }
 
+QColor Cell::alternateColor(Stitch *s, QColor color, bool useAlt)
+{
+    if(!s || !s->isSvg() || !s->renderSvg()->isValid())
+        return color;
+
+    QString primary = Settings::inst()->value("stitchPrimaryColor").toString();
+    QString secondary = Settings::inst()->value("stitchAlternateColor").toString();
+
+    //only use the primary and secondary colors if the stitch is using the default colors.
+    if(useAlt && color == primary)
+        return QColor(secondary);
+    else if(!useAlt && color == secondary)
+        return QColor(primary);
+
+    return color;
+}
+
 Cell* Cell::copy(Cell *cell)
 {
     Cell *c = 0;
@@ -31,6 +31,7 @@ class Cell : public QGraphicsSvgItem
     friend class SaveFile;
     friend class File_v1;
     friend class File_v2;
+    friend class File_v3;
 public:
 
     enum { Type = UserType + 1 };
@@ -62,7 +63,7 @@ public:
     Stitch* stitch() const { return mStitch; }
 	
 	unsigned int layer() { return mLayer; }
-	void setLayer(unsigned int layer) { mLayer = layer; }
+	void setLayer(unsigned int layer);
 
     /**
      * The stitch name.
@@ -70,11 +71,18 @@ public:
     QString name();
 
     void useAlternateRenderer(bool useAlt);
+    /**
+     * Returns the color a stitch @s drawn in @color has on an alternate (@useAlt) or normal row.
+     */
+    static QColor alternateColor(Stitch *s, QColor color, bool useAlt);
     
 signals:
     void stitchChanged(QString oldSt, QString newSt = 0);
     void colorChanged(QString oldColor, QString newColor);
     void bgColorChanged(QString oldColor, QString newColor);
+
+protected:
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value);
     
 private:
 	//the layer of the cell
@@ -0,0 +1,506 @@
+/****************************************************************************\
+ Copyright (c) 2010-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "cellstore.h"
+
+#include <QMatrix4x4>
+#include <QPixmap>
+#include <QtSvg/QSvgRenderer>
+
+#include "cell.h"
+#include "stitch.h"
+#include "debug.h"
+
+#include <math.h>
+#include <algorithm>
+
+//size of the square buckets used to find cells by position, in scene units.
+#define CELLSTORE_BUCKET_SIZE 128.0
+
+CellStore::CellStore()
+    : mGridCellCount(0)
+{
+}
+
+CellStore::~CellStore()
+{
+}
+
+void CellStore::clear()
+{
+    mStitchTable.clear();
+    mStitchIndex.clear();
+    mColorTable.clear();
+    mColorIndex.clear();
+
+    mStitchIds.clear();
+    mColorIds.clear();
+    mBgColorIds.clear();
+    mLayers.clear();
+    mPositions.clear();
+    mTransforms.clear();
+    mBounds.clear();
+    mGridPositions.clear();
+    mGroups.clear();
+    mIds.clear();
+    mGridCellCount = 0;
+    mGridIndex.clear();
+    mBuckets.clear();
+}
+
+quint16 CellStore::stitchId(Stitch *s)
+{
+    if(mStitchIndex.contains(s))
+        return mStitchIndex.value(s);
+
+    quint16 id = mStitchTable.count();
+    mStitchTable.append(s);
+    mStitchIndex.insert(s, id);
+    return id;
+}
+
+quint16 CellStore::colorId(QColor color)
+{
+    QRgb rgb = color.rgba();
+    if(mColorIndex.contains(rgb))
+        return mColorIndex.value(rgb);
+
+    quint16 id = mColorTable.count();
+    mColorTable.append(rgb);
+    mColorIndex.insert(rgb, id);
+    return id;
+}
+
+int CellStore::append(const CellRecord &record)
+{
+    mStitchIds.append(stitchId(record.stitch));
+    mColorIds.append(colorId(record.color));
+    mBgColorIds.append(colorId(record.bgColor));
+    mLayers.append(record.layer);
+    mPositions.append(record.pos);
+
+    const QTransform &t = record.transform;
+    mTransforms << t.m11() << t.m12() << t.m21() << t.m22() << t.dx() << t.dy();
+
+    mBounds.append(QRectF());
+
+    mGridPositions.append(QPoint(-1, -1));
+    mGroups.append(record.group);
+    mIds.append(record.id);
+
+    int index = count() - 1;
+    if(record.row >= 0 && record.column >= 0)
+        setGridPosition(index, record.row, record.column);
+    updateBounds(index);
+    return index;
+}
+
+CellRecord CellStore::record(int index) const
+{
+    CellRecord r;
+    r.stitch = stitch(index);
+    r.color = color(index);
+    r.bgColor = bgColor(index);
+    r.layer = layer(index);
+    r.pos = pos(index);
+    r.transform = transform(index);
+    r.row = row(index);
+    r.column = column(index);
+    r.group = group(index);
+    r.id = id(index);
+    return r;
+}
+
+void CellStore::remove(int index)
+{
+    if(index < 0 || index >= count())
+        return;
+
+    int last = count() - 1;
+    setGridPosition(index, -1, -1);
+    removeFromBuckets(index);
+    if(index != last) {
+        removeFromBuckets(last);
+        mStitchIds[index] = mStitchIds[last];
+        mColorIds[index] = mColorIds[last];
+        mBgColorIds[index] = mBgColorIds[last];
+        mLayers[index] = mLayers[last];
+        mPositions[index] = mPositions[last];
+        for(int i = 0; i < 6; ++i)
+            mTransforms[index * 6 + i] = mTransforms[last * 6 + i];
+        mBounds[index] = mBounds[last];
+        mGridPositions[index] = mGridPositions[last];
+        if(row(index) >= 0)
+            mGridIndex.insert(bucketKey(column(index), row(index)), index);
+        mGroups[index] = mGroups[last];
+        mIds[index] = mIds[last];
+        addToBuckets(index);
+    }
+
+    mStitchIds.resize(last);
+    mColorIds.resize(last);
+    mBgColorIds.resize(last);
+    mLayers.resize(last);
+    mPositions.resize(last);
+    mTransforms.resize(last * 6);
+    mBounds.resize(last);
+    mGridPositions.resize(last);
+    mGroups.resize(last);
+    mIds.resize(last);
+}
+
+QTransform CellStore::transform(int index) const
+{
+    const float *t = mTransforms.constData() + index * 6;
+    return QTransform(t[0], t[1], t[2], t[3], t[4], t[5]);
+}
+
+QTransform CellStore::sceneTransform(int index) const
+{
+    QPointF p = pos(index);
+    return transform(index) * QTransform::fromTranslate(p.x(), p.y());
+}
+
+void CellStore::setStitch(int index, Stitch *s)
+{
+    mStitchIds[index] = stitchId(s);
+    updateBounds(index);
+}
+
+void CellStore::setColor(int index, QColor color)
+{
+    mColorIds[index] = colorId(color);
+}
+
+void CellStore::setBgColor(int index, QColor color)
+{
+    mBgColorIds[index] = colorId(color);
+}
+
+void CellStore::setLayer(int index, unsigned int layer)
+{
+    mLayers[index] = layer;
+}
+
+void CellStore::updateBounds(int index)
+{
+    removeFromBuckets(index);
+    mBounds[index] = sceneTransform(index).mapRect(stitchRect(stitch(index)));
+    addToBuckets(index);
+}
+
+void CellStore::bucketRange(const QRectF &rect, int *left, int *top, int *right, int *bottom)
+{
+    *left = (int)floor(rect.left() / CELLSTORE_BUCKET_SIZE);
+    *top = (int)floor(rect.top() / CELLSTORE_BUCKET_SIZE);
+    *right = (int)floor(rect.right() / CELLSTORE_BUCKET_SIZE);
+    *bottom = (int)floor(rect.bottom() / CELLSTORE_BUCKET_SIZE);
+}
+
+void CellStore::addToBuckets(int index)
+{
+    const QRectF &rect = mBounds.at(index);
+    if(rect.isNull())
+        return;
+
+    int left, top, right, bottom;
+    bucketRange(rect, &left, &top, &right, &bottom);
+    for(int x = left; x <= right; ++x) {
+        for(int y = top; y <= bottom; ++y)
+            mBuckets[bucketKey(x, y)].append(index);
+    }
+}
+
+void CellStore::removeFromBuckets(int index)
+{
+    const QRectF &rect = mBounds.at(index);
+    if(rect.isNull())
+        return;
+
+    int left, top, right, bottom;
+    bucketRange(rect, &left, &top, &right, &bottom);
+    for(int x = left; x <= right; ++x) {
+        for(int y = top; y <= bottom; ++y) {
+            QHash<quint64, QVector<int> >::iterator it = mBuckets.find(bucketKey(x, y));
+            if(it == mBuckets.end())
+                continue;
+
+            int i = it->indexOf(index);
+            if(i >= 0) {
+                (*it)[i] = it->last();
+                it->pop_back();
+            }
+            if(it->isEmpty())
+                mBuckets.erase(it);
+        }
+    }
+}
+
+QList<int> CellStore::candidates(const QRectF &rect) const
+{
+    int left, top, right, bottom;
+    bucketRange(rect, &left, &top, &right, &bottom);
+
+    QList<int> cells;
+    for(int x = left; x <= right; ++x) {
+        for(int y = top; y <= bottom; ++y) {
+            QHash<quint64, QVector<int> >::const_iterator it = mBuckets.constFind(bucketKey(x, y));
+            if(it == mBuckets.constEnd())
+                continue;
+            foreach(int i, *it)
+                cells.append(i);
+        }
+    }
+
+    qSort(cells);
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    return cells;
+}
+
+QRectF CellStore::stitchRect(Stitch *s)
+{
+    if(!s)
+        return QRectF(0, 0, 32, 32);
+
+    if(s->isSvg()) {
+        QSvgRenderer *r = s->renderSvg();
+        if(r)
+            return QRectF(QPointF(0, 0), r->defaultSize());
+        return QRectF(0, 0, 32, 32);
+    }
+
+    return s->renderPixmap()->rect();
+}
+
+int CellStore::cellAt(const QPointF &pos, unsigned int layer) const
+{
+    QList<int> cells = candidates(QRectF(pos, QSizeF(0, 0)));
+
+    //the last cell added is drawn on top.
+    for(int c = cells.count() - 1; c >= 0; --c) {
+        int i = cells.at(c);
+        if(mLayers.at(i) != layer || !mBounds.at(i).contains(pos))
+            continue;
+
+        QPointF local = sceneTransform(i).inverted().map(pos);
+        if(stitchRect(stitch(i)).contains(local))
+            return i;
+    }
+
+    return -1;
+}
+
+QList<int> CellStore::cellsIn(const QPainterPath &path, unsigned int layer) const
+{
+    QList<int> cells;
+    QRectF pathRect = path.boundingRect();
+
+    foreach(int i, candidates(pathRect)) {
+        if(mLayers.at(i) != layer || !pathRect.intersects(mBounds.at(i)))
+            continue;
+
+        QPainterPath shape;
+        shape.addRect(stitchRect(stitch(i)));
+        if(path.intersects(sceneTransform(i).map(shape)))
+            cells.append(i);
+    }
+
+    return cells;
+}
+
+QList<int> CellStore::cellsInLayer(unsigned int layer) const
+{
+    QList<int> cells;
+    for(int i = 0; i < count(); ++i) {
+        if(mLayers.at(i) == layer)
+            cells.append(i);
+    }
+    return cells;
+}
+
+QList<int> CellStore::cellsInRect(const QRectF &rect, unsigned int layer) const
+{
+    QList<int> cells;
+    foreach(int i, candidates(rect)) {
+        if(mLayers.at(i) == layer && rect.intersects(mBounds.at(i)))
+            cells.append(i);
+    }
+    return cells;
+}
+
+QList<int> CellStore::cellsInGroup(ItemGroup *group) const
+{
+    QList<int> cells;
+    if(!group)
+        return cells;
+
+    for(int i = 0; i < count(); ++i) {
+        if(mGroups.at(i) == group)
+            cells.append(i);
+    }
+    return cells;
+}
+
+QList<int> CellStore::cellsInRow(int row) const
+{
+    QList<int> cells;
+    if(mGridCellCount == 0 || row < 0)
+        return cells;
+
+    for(int i = 0; i < count(); ++i) {
+        if(mGridPositions.at(i).y() == row)
+            cells.append(i);
+    }
+    return cells;
+}
+
+int CellStore::gridCell(int row, int column) const
+{
+    return mGridIndex.value(bucketKey(column, row), -1);
+}
+
+void CellStore::setGridPosition(int index, int row, int column)
+{
+    QPoint &pt = mGridPositions[index];
+    if(pt.y() >= 0) {
+        mGridIndex.remove(bucketKey(pt.x(), pt.y()));
+        mGridCellCount--;
+    }
+
+    pt = (row >= 0 && column >= 0) ? QPoint(column, row) : QPoint(-1, -1);
+    if(pt.y() >= 0) {
+        mGridIndex.insert(bucketKey(column, row), index);
+        mGridCellCount++;
+    }
+}
+
+void CellStore::shiftColumns(int row, int first, int delta)
+{
+    if(mGridCellCount == 0 || delta == 0)
+        return;
+
+    //take the cells off the grid first so they don't replace each other in the index.
+    QList<int> cells;
+    for(int i = 0; i < count(); ++i) {
+        const QPoint &pt = mGridPositions.at(i);
+        if(pt.y() == row && pt.x() >= first) {
+            mGridIndex.remove(bucketKey(pt.x(), pt.y()));
+            cells.append(i);
+        }
+    }
+
+    foreach(int i, cells) {
+        mGridPositions[i].rx() += delta;
+        mGridIndex.insert(bucketKey(column(i), row), i);
+    }
+}
+
+void CellStore::shiftRows(int first, int delta)
+{
+    if(mGridCellCount == 0 || delta == 0)
+        return;
+
+    for(int i = 0; i < count(); ++i) {
+        if(mGridPositions.at(i).y() >= first)
+            mGridPositions[i].ry() += delta;
+    }
+    rebuildGridIndex();
+}
+
+void CellStore::swapRows(int a, int b)
+{
+    if(mGridCellCount == 0 || a == b)
+        return;
+
+    for(int i = 0; i < count(); ++i) {
+        int r = mGridPositions.at(i).y();
+        if(r == a)
+            mGridPositions[i].ry() = b;
+        else if(r == b)
+            mGridPositions[i].ry() = a;
+    }
+    rebuildGridIndex();
+}
+
+void CellStore::removeRow(int row)
+{
+    if(mGridCellCount == 0)
+        return;
+
+    foreach(int i, cellsInRow(row))
+        setGridPosition(i, -1, -1);
+    shiftRows(row + 1, -1);
+}
+
+void CellStore::rebuildGridIndex()
+{
+    mGridIndex.clear();
+    for(int i = 0; i < count(); ++i) {
+        const QPoint &pt = mGridPositions.at(i);
+        if(pt.y() >= 0)
+            mGridIndex.insert(bucketKey(pt.x(), pt.y()), i);
+    }
+}
+
+QRectF CellStore::layerBoundingRect(unsigned int layer) const
+{
+    QRectF rect;
+    for(int i = 0; i < count(); ++i) {
+        if(mLayers.at(i) == layer)
+            rect = rect.united(mBounds.at(i));
+    }
+    return rect;
+}
+
+CellRecord CellStore::recordFromCell(Cell *c)
+{
+    CellRecord r;
+    r.stitch = c->stitch();
+    r.color = c->color();
+    r.bgColor = c->bgColor();
+    r.layer = c->layer();
+    r.pos = c->pos();
+    r.transform = c->sceneTransform() * QTransform::fromTranslate(-r.pos.x(), -r.pos.y());
+    return r;
+}
+
+QTransform CellStore::itemTransform(QTransform transform, qreal angle, QPointF origin,
+                                    qreal rotation, QPointF rotationPivot,
+                                    qreal scaleX, qreal scaleY, QPointF scalePivot)
+{
+    //Same order QGraphicsItem uses: transform(), transformations(), then the rotation around the origin.
+    QMatrix4x4 m;
+    m.translate(rotationPivot.x(), rotationPivot.y());
+    m.rotate(rotation, 0, 0, 1);
+    m.translate(-rotationPivot.x(), -rotationPivot.y());
+
+    m.translate(scalePivot.x(), scalePivot.y());
+    m.scale(scaleX, scaleY, 1);
+    m.translate(-scalePivot.x(), -scalePivot.y());
+
+    QTransform x = transform;
+    x *= m.toTransform();
+
+    x.translate(origin.x(), origin.y());
+    x.rotate(angle);
+    x.translate(-origin.x(), -origin.y());
+
+    return x;
+}
@@ -0,0 +1,213 @@
+/****************************************************************************\
+ Copyright (c) 2010-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef CELLSTORE_H
+#define CELLSTORE_H
+
+#include <QVector>
+#include <QHash>
+#include <QColor>
+#include <QPoint>
+#include <QPointF>
+#include <QRectF>
+#include <QTransform>
+#include <QPainterPath>
+
+class Stitch;
+class Cell;
+class ItemGroup;
+
+/**
+ * All the values needed to draw a stitch on the chart.
+ *
+ * The transform is the full item transform without the position,
+ * as returned by Cell::sceneTransform() for a cell at (0,0).
+ *
+ * A stitch on the grid keeps its @row and @column, a grouped stitch
+ * keeps its @group so it can be put back when it becomes a Cell again.
+ * The @id is the one the autosave journal knows the stitch by, 0 if it has none.
+ */
+struct CellRecord
+{
+    CellRecord()
+        : stitch(0), color(Qt::black), bgColor(Qt::white), layer(0),
+          row(-1), column(-1), group(0), id(0) {}
+
+    Stitch *stitch;
+    QColor color;
+    QColor bgColor;
+    unsigned int layer;
+    QPointF pos;
+    QTransform transform;
+    int row;
+    int column;
+    ItemGroup *group;
+    quint32 id;
+};
+
+/**
+ * The CellStore keeps stitches that aren't being edited as plain values
+ * instead of one Cell (QGraphicsSvgItem) per stitch.
+ *
+ * Each field is kept in its own array, stitches and colors are stored as
+ * indexes into lookup tables shared by all the cells in the store.
+ *
+ * Removing a cell moves the last cell into its place, so indexes are only
+ * valid until the next removal.
+ *
+ * Cells are also sorted into square buckets by their scene bounding rect
+ * so hit testing only looks at the cells near the point or path.
+ */
+class CellStore
+{
+public:
+    CellStore();
+    ~CellStore();
+
+    int count() const { return mPositions.count(); }
+    void clear();
+
+    int append(const CellRecord &record);
+    CellRecord record(int index) const;
+    void remove(int index);
+
+    /**
+     * Convert a cell to a record, the cell should not be in a group.
+     */
+    static CellRecord recordFromCell(Cell *c);
+    /**
+     * Create the transform a Cell would end up with when loaded with these values.
+     */
+    static QTransform itemTransform(QTransform transform, qreal angle, QPointF origin,
+                                    qreal rotation, QPointF rotationPivot,
+                                    qreal scaleX, qreal scaleY, QPointF scalePivot);
+
+    Stitch* stitch(int index) const { return mStitchTable.at(mStitchIds.at(index)); }
+    QColor color(int index) const { return QColor::fromRgba(mColorTable.at(mColorIds.at(index))); }
+    QColor bgColor(int index) const { return QColor::fromRgba(mColorTable.at(mBgColorIds.at(index))); }
+    unsigned int layer(int index) const { return mLayers.at(index); }
+    QPointF pos(int index) const { return mPositions.at(index); }
+    QTransform transform(int index) const;
+    /**
+     * The transform from the stitch symbol to the scene, including the position.
+     */
+    QTransform sceneTransform(int index) const;
+    QRectF sceneBoundingRect(int index) const { return mBounds.at(index); }
+    int row(int index) const { return mGridPositions.at(index).y(); }
+    int column(int index) const { return mGridPositions.at(index).x(); }
+    ItemGroup* group(int index) const { return mGroups.at(index); }
+
+    void setStitch(int index, Stitch *s);
+    void setColor(int index, QColor color);
+    void setBgColor(int index, QColor color);
+    void setLayer(int index, unsigned int layer);
+    quint32 id(int index) const { return mIds.at(index); }
+    void setId(int index, quint32 id) { mIds[index] = id; }
+
+    /**
+     * Returns the top most cell in @layer at @pos or -1 if there isn't one.
+     */
+    int cellAt(const QPointF &pos, unsigned int layer) const;
+    /**
+     * Returns all the cells in @layer that intersect @path.
+     */
+    QList<int> cellsIn(const QPainterPath &path, unsigned int layer) const;
+    QList<int> cellsInLayer(unsigned int layer) const;
+    /**
+     * Returns the cells in @layer whose bounding rect intersects @rect, in drawing order.
+     */
+    QList<int> cellsInRect(const QRectF &rect, unsigned int layer) const;
+    QList<int> cellsInGroup(ItemGroup *group) const;
+    /**
+     * Returns the cells that are in @row of the grid.
+     */
+    QList<int> cellsInRow(int row) const;
+    int gridCellCount() const { return mGridCellCount; }
+    /**
+     * Returns the cell at @row, @column of the grid or -1 if there isn't one.
+     */
+    int gridCell(int row, int column) const;
+    /**
+     * Put a cell on the grid, or take it off with a @row of -1.
+     */
+    void setGridPosition(int index, int row, int column);
+
+    /**
+     * Keep the cells in line with the Scene's grid when it changes:
+     * move the cells in @row from @first on by @delta columns,
+     * move the rows from @first on by @delta rows,
+     * swap two rows or take a row off the grid.
+     */
+    void shiftColumns(int row, int first, int delta);
+    void shiftRows(int first, int delta);
+    void swapRows(int a, int b);
+    void removeRow(int row);
+
+    QRectF layerBoundingRect(unsigned int layer) const;
+
+    /**
+     * The area of the stitch symbol in item coordinates.
+     */
+    static QRectF stitchRect(Stitch *s);
+
+private:
+    quint16 stitchId(Stitch *s);
+    quint16 colorId(QColor color);
+
+    void updateBounds(int index);
+
+    void addToBuckets(int index);
+    void removeFromBuckets(int index);
+    /**
+     * The indexes of all cells in the buckets @rect touches, sorted and without duplicates.
+     */
+    QList<int> candidates(const QRectF &rect) const;
+    static void bucketRange(const QRectF &rect, int *left, int *top, int *right, int *bottom);
+    static quint64 bucketKey(int x, int y) { return (quint64(quint32(x)) << 32) | quint32(y); }
+
+    void rebuildGridIndex();
+
+    //lookup tables for the values used by the cells.
+    QVector<Stitch*> mStitchTable;
+    QHash<Stitch*, quint16> mStitchIndex;
+    QVector<QRgb> mColorTable;
+    QHash<QRgb, quint16> mColorIndex;
+
+    //one entry per cell.
+    QVector<quint16> mStitchIds;
+    QVector<quint16> mColorIds;
+    QVector<quint16> mBgColorIds;
+    QVector<unsigned int> mLayers;
+    QVector<QPointF> mPositions;
+    //m11, m12, m21, m22, dx, dy
+    QVector<float> mTransforms;
+    QVector<QRectF> mBounds;
+    //QPoint(column, row), (-1, -1) for cells that aren't on the grid.
+    QVector<QPoint> mGridPositions;
+    QVector<ItemGroup*> mGroups;
+    QVector<quint32> mIds;
+    int mGridCellCount;
+    //bucketKey(column, row) to the cell at that grid position.
+    QHash<quint64, int> mGridIndex;
+
+    QHash<quint64, QVector<int> > mBuckets;
+};
+
+#endif // CELLSTORE_H
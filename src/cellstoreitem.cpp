@@ -0,0 +1,112 @@
+/****************************************************************************\
+ Copyright (c) 2010-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "cellstoreitem.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QtSvg/QSvgRenderer>
+
+#include "cellstore.h"
+#include "stitch.h"
+#include "stitchspritecache.h"
+
+CellStoreItem::CellStoreItem(CellStore *store, unsigned int layer, QGraphicsItem *parent)
+    : QGraphicsItem(parent),
+      mStore(store),
+      mLayer(layer)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    //same z value as a Cell that isn't on the grid.
+    setZValue(10);
+    updateBounds();
+}
+
+CellStoreItem::~CellStoreItem()
+{
+}
+
+QRectF CellStoreItem::boundingRect() const
+{
+    return mBounds;
+}
+
+void CellStoreItem::updateBounds()
+{
+    prepareGeometryChange();
+    mBounds = mStore->layerBoundingRect(mLayer);
+    update();
+}
+
+void CellStoreItem::extendBounds(const QRectF &rect)
+{
+    if(mBounds.contains(rect))
+        return;
+
+    prepareGeometryChange();
+    mBounds = mBounds.united(rect);
+}
+
+void CellStoreItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    bool useSprites = (widget && !StitchSpriteCache::isVectorDevice(painter));
+    QRectF exposed = option->exposedRect;
+
+    //use the buckets when only part of the layer is drawn, like a printed page or a zoomed in view.
+    QList<int> cells;
+    if(exposed.contains(mBounds))
+        cells = mStore->cellsInLayer(mLayer);
+    else
+        cells = mStore->cellsInRect(exposed, mLayer);
+
+    foreach(int i, cells) {
+        Stitch *s = mStore->stitch(i);
+        if(!s)
+            continue;
+
+        QRectF rect = CellStore::stitchRect(s);
+
+        painter->save();
+        painter->setTransform(mStore->sceneTransform(i), true);
+
+        QColor bg = mStore->bgColor(i);
+        if(bg.isValid() && bg != Qt::white)
+            painter->fillRect(rect, bg);
+
+        if(s->isSvg()) {
+            QImage sprite;
+            if(useSprites)
+                sprite = StitchSpriteCache::inst()->sprite(s, mStore->color(i), painter);
+
+            if(!sprite.isNull()) {
+                painter->setRenderHint(QPainter::SmoothPixmapTransform);
+                painter->drawImage(rect, sprite);
+            } else {
+                QSvgRenderer *r = s->renderSvg(mStore->color(i));
+                if(r)
+                    r->render(painter, rect);
+            }
+        } else {
+            painter->drawPixmap(rect.topLeft(), *(s->renderPixmap()));
+        }
+
+        painter->restore();
+    }
+}
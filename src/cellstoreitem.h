@@ -0,0 +1,65 @@
+/****************************************************************************\
+ Copyright (c) 2010-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef CELLSTOREITEM_H
+#define CELLSTOREITEM_H
+
+#include <QGraphicsItem>
+
+class CellStore;
+
+/**
+ * Draws all the cells in one layer of a CellStore.
+ *
+ * The item can't be selected or moved, clicking on a cell
+ * turns it back into a Cell (see Scene::materializeCell).
+ */
+class CellStoreItem : public QGraphicsItem
+{
+public:
+    enum { Type = UserType + 25 };
+
+    CellStoreItem(CellStore *store, unsigned int layer, QGraphicsItem *parent = 0);
+    ~CellStoreItem();
+
+    int type() const { return CellStoreItem::Type; }
+
+    QRectF boundingRect() const;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0);
+
+    unsigned int layer() const { return mLayer; }
+    CellStore* store() const { return mStore; }
+
+    /**
+     * Call after cells in this layer are added, removed or changed.
+     */
+    void updateBounds();
+    /**
+     * Grow the bounding rect to include a newly added cell.
+     */
+    void extendBounds(const QRectF &rect);
+
+private:
+    CellStore *mStore;
+    unsigned int mLayer;
+    QRectF mBounds;
+};
+
+#endif // CELLSTOREITEM_H
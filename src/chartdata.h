@@ -0,0 +1,213 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef CHARTDATA_H
+#define CHARTDATA_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+#include <QString>
+#include <QTransform>
+
+/**
+ * Plain values read from or written to a saved chart.
+ *
+ * These are filled in without touching any QObjects or graphics items so
+ * a file can be parsed or written on a worker thread, the items are created
+ * from them or copied into them on the GUI thread.
+ */
+
+/**
+ * The values shared by everything that can be placed on a chart.
+ */
+struct ItemData
+{
+    ItemData()
+        : angle(0.0), scale(1.0, 1.0), rotation(0.0), scaleX(1.0), scaleY(1.0),
+          group(-1), layer(0), id(0) {}
+
+    QPointF position;
+    QPointF pivotPoint;
+    qreal angle;
+    QPointF scale;
+    QTransform transform;
+
+    qreal rotation;
+    QPointF pivotRotation;
+    qreal scaleX;
+    qreal scaleY;
+    QPointF pivotScale;
+
+    int group;
+    unsigned int layer;
+
+    //identifies the item in the autosave journal, 0 if it isn't tracked.
+    quint32 id;
+};
+
+struct CellData : public ItemData
+{
+    CellData()
+        : row(-1), column(-1) {}
+
+    QString stitch;
+    int row;
+    int column;
+    QString color;
+    QString bgColor;
+};
+
+struct IndicatorData : public ItemData
+{
+    IndicatorData()
+        : fontSize(-1), fontUsed(false) {}
+
+    QString text;
+    QString textColor;
+    QString bgColor;
+    QString style;
+    QString fontName;
+    int fontSize;
+    bool fontUsed;
+};
+
+struct ChartImageData : public ItemData
+{
+    QString filename;
+};
+
+struct LayerData
+{
+    LayerData()
+        : uid(0), visible(true) {}
+
+    QString name;
+    unsigned int uid;
+    bool visible;
+};
+
+struct ChartData
+{
+    ChartData()
+        : style(-1), hasDefaultSt(false), hasSize(false), hasCenter(false),
+          hasGuidelines(false), guidelineRows(0), guidelineColumns(0),
+          guidelineCellWidth(0), guidelineCellHeight(0),
+          hasRowSpacing(false), groupCount(0) {}
+
+    /**
+     * The number of items that have to be created for this chart.
+     */
+    int itemCount() const { return cells.count() + images.count() + indicators.count(); }
+
+    QString name;
+    int style;
+    bool hasDefaultSt;
+    QString defaultSt;
+
+    bool hasSize;
+    QRectF size;
+
+    bool hasCenter;
+    QPointF center;
+
+    bool hasGuidelines;
+    QString guidelineType;
+    int guidelineRows;
+    int guidelineColumns;
+    int guidelineCellWidth;
+    int guidelineCellHeight;
+
+    bool hasRowSpacing;
+    QSizeF rowSpacing;
+
+    //number of columns in each row of the grid.
+    QList<int> gridRows;
+    QList<LayerData> layers;
+    int groupCount;
+
+    QList<CellData> cells;
+    QList<ChartImageData> images;
+    QList<IndicatorData> indicators;
+
+    //a chart that wasn't loaded has no items, only its version 1.3 sections
+    //and the stitches and colors they use, see File_v3::writeCharts().
+    QByteArray sections;
+    QMap<QString, int> sectionStitches;
+    QMap<QString, int> sectionColors;
+};
+
+/**
+ * Where a chart is in a version 1.3 file and the stitches and colors it uses,
+ * so the chart can be shown in the document before its items are loaded.
+ */
+struct ChartIndexData
+{
+    ChartIndexData()
+        : offset(0), size(0) {}
+
+    //the chart's sections, relative to the start of the charts.
+    quint32 offset;
+    quint32 size;
+    QString name;
+
+    //the number of cells using each stitch and color, counted like loaded cells are.
+    QMap<QString, int> stitches;
+    QMap<QString, int> colors;
+
+    //the chart's sections, filled in when the file is read.
+    QByteArray sections;
+};
+
+struct StitchData
+{
+    QString name;
+    //the file name saved in the pattern, see StitchSet::saveXmlStitchSet.
+    QString icon;
+    QString description;
+    QString category;
+    QString wrongSide;
+};
+
+/**
+ * Everything written to a pattern file, copied from the open document
+ * so the file can be written on a worker thread.
+ */
+struct PatternData
+{
+    QString stitchSetName;
+    QString author;
+    QString email;
+    QString org;
+    QString url;
+    QList<StitchData> stitches;
+    //the icon name saved in the file and the file to read it from.
+    QMap<QString, QString> iconFiles;
+
+    //the color name and when it was added.
+    QMap<QString, qint64> colors;
+
+    QList<ChartData> charts;
+};
+
+#endif // CHARTDATA_H
@@ -0,0 +1,550 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "chartparser.h"
+
+#include <QXmlStreamReader>
+#include <QDebug>
+
+//mantissas with more digits than this can't be converted exactly, they use QString::toDouble().
+#define CHARTPARSER_MAX_DIGITS 15
+
+static const double pow10Table[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+ChartParser::ChartParser()
+    : mCancelled(0)
+{
+}
+
+ChartParser::Tag ChartParser::tagId(const QStringRef &name)
+{
+    static const struct {
+        const char *name;
+        int length;
+        Tag tag;
+    } tags[] = {
+        { "cell", 4, Tag_Cell },
+        { "stitch", 6, Tag_Stitch },
+        { "layer", 5, Tag_Layer },
+        { "position", 8, Tag_Position },
+        { "newscale", 8, Tag_NewScale },
+        { "rotation", 8, Tag_Rotation },
+        { "color", 5, Tag_Color },
+        { "bgColor", 7, Tag_BgColor },
+        { "pivotPoint", 10, Tag_PivotPoint },
+        { "transformation", 14, Tag_Transformation },
+        { "grid", 4, Tag_Grid },
+        { "group", 5, Tag_Group },
+        { "angle", 5, Tag_Angle },
+        { "scale", 5, Tag_Scale },
+        { "row", 3, Tag_Row },
+        { "indicator", 9, Tag_Indicator },
+        { "chartimage", 10, Tag_ChartImage },
+        { "x", 1, Tag_X },
+        { "y", 1, Tag_Y },
+        { "text", 4, Tag_Text },
+        { "textColor", 9, Tag_TextColor },
+        { "style", 5, Tag_Style },
+        { "fontname", 8, Tag_FontName },
+        { "fontsize", 8, Tag_FontSize },
+        { "filename", 8, Tag_Filename },
+        { "chart", 5, Tag_Chart },
+        { "name", 4, Tag_Name },
+        { "defaultSt", 9, Tag_DefaultSt },
+        { "chartCenter", 11, Tag_ChartCenter },
+        { "rowSpacing", 10, Tag_RowSpacing },
+        { "guidelines", 10, Tag_Guidelines },
+        { "chartLayer", 10, Tag_ChartLayer },
+        { "size", 4, Tag_Size }
+    };
+
+    //the most common tags are at the top of the table.
+    int length = name.size();
+    for(unsigned int i = 0; i < sizeof(tags) / sizeof(tags[0]); ++i) {
+        if(tags[i].length == length && name == QLatin1String(tags[i].name))
+            return tags[i].tag;
+    }
+
+    return Tag_Unknown;
+}
+
+double ChartParser::toDouble(const QStringRef &text, bool *ok)
+{
+    const QChar *c = text.unicode();
+    const QChar *end = c + text.size();
+
+    while(c != end && c->isSpace())
+        ++c;
+
+    bool negative = false;
+    if(c != end && (*c == QLatin1Char('-') || *c == QLatin1Char('+'))) {
+        negative = (*c == QLatin1Char('-'));
+        ++c;
+    }
+
+    quint64 mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+
+    while(c != end && c->unicode() >= '0' && c->unicode() <= '9') {
+        if(mantissa || c->unicode() != '0') {
+            mantissa = mantissa * 10 + (c->unicode() - '0');
+            ++digits;
+        }
+        hasDigits = true;
+        ++c;
+    }
+
+    if(c != end && *c == QLatin1Char('.')) {
+        ++c;
+        while(c != end && c->unicode() >= '0' && c->unicode() <= '9') {
+            if(mantissa || c->unicode() != '0') {
+                mantissa = mantissa * 10 + (c->unicode() - '0');
+                ++digits;
+            }
+            --exponent;
+            hasDigits = true;
+            ++c;
+        }
+    }
+
+    if(hasDigits && c != end && (*c == QLatin1Char('e') || *c == QLatin1Char('E'))) {
+        ++c;
+        bool negativeExp = false;
+        if(c != end && (*c == QLatin1Char('-') || *c == QLatin1Char('+'))) {
+            negativeExp = (*c == QLatin1Char('-'));
+            ++c;
+        }
+
+        int exp = 0;
+        bool hasExp = false;
+        while(c != end && c->unicode() >= '0' && c->unicode() <= '9' && exp < 10000) {
+            exp = exp * 10 + (c->unicode() - '0');
+            hasExp = true;
+            ++c;
+        }
+        if(!hasExp)
+            hasDigits = false;
+        exponent += negativeExp ? -exp : exp;
+    }
+
+    while(c != end && c->isSpace())
+        ++c;
+
+    if(!hasDigits || c != end || digits > CHARTPARSER_MAX_DIGITS || exponent > 22 || exponent < -22)
+        return text.toString().toDouble(ok);
+
+    //both values are exact so there is only one rounding, the same as QString::toDouble().
+    double value = (double)mantissa;
+    if(exponent < 0)
+        value /= pow10Table[-exponent];
+    else
+        value *= pow10Table[exponent];
+
+    if(ok)
+        *ok = true;
+    return negative ? -value : value;
+}
+
+qlonglong ChartParser::toLongLong(const QStringRef &text, bool *ok)
+{
+    const QChar *c = text.unicode();
+    const QChar *end = c + text.size();
+
+    bool negative = false;
+    if(c != end && (*c == QLatin1Char('-') || *c == QLatin1Char('+'))) {
+        negative = (*c == QLatin1Char('-'));
+        ++c;
+    }
+
+    qlonglong value = 0;
+    int digits = 0;
+    while(c != end && c->unicode() >= '0' && c->unicode() <= '9') {
+        value = value * 10 + (c->unicode() - '0');
+        ++digits;
+        ++c;
+    }
+
+    if(digits == 0 || digits > 18 || c != end)
+        return text.toString().toLongLong(ok);
+
+    if(ok)
+        *ok = true;
+    return negative ? -value : value;
+}
+
+bool ChartParser::nextText(QXmlStreamReader *stream)
+{
+    while(!stream->atEnd()) {
+        switch(stream->readNext()) {
+            case QXmlStreamReader::Characters:
+                return true;
+            case QXmlStreamReader::EndElement:
+                return false;
+            case QXmlStreamReader::StartElement:
+                stream->skipCurrentElement();
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+double ChartParser::readDouble(QXmlStreamReader *stream)
+{
+    double value = 0;
+    while(nextText(stream))
+        value = toDouble(stream->text());
+    return value;
+}
+
+qlonglong ChartParser::readLongLong(QXmlStreamReader *stream)
+{
+    qlonglong value = 0;
+    while(nextText(stream))
+        value = toLongLong(stream->text());
+    return value;
+}
+
+double ChartParser::attribute(const QXmlStreamAttributes &attributes, const char *name)
+{
+    return toDouble(attributes.value(QLatin1String(name)));
+}
+
+QString ChartParser::readInterned(QXmlStreamReader *stream)
+{
+    QString value;
+    while(nextText(stream)) {
+        if(value.isEmpty())
+            value = intern(stream->text());
+        else
+            value.append(stream->text());
+    }
+    return value;
+}
+
+QString ChartParser::intern(const QStringRef &text)
+{
+    uint hash = 0;
+    const QChar *c = text.unicode();
+    for(int i = 0; i < text.size(); ++i)
+        hash = 31 * hash + c[i].unicode();
+
+    QMultiHash<uint, QString>::const_iterator it = mStrings.constFind(hash);
+    while(it != mStrings.constEnd() && it.key() == hash) {
+        if(text == it.value())
+            return it.value();
+        ++it;
+    }
+
+    QString str = text.toString();
+    mStrings.insert(hash, str);
+    return str;
+}
+
+bool ChartParser::parse(const QByteArray &data, QList<ChartData> *charts)
+{
+    mErrorString.clear();
+
+    QXmlStreamReader xmlStream(data);
+
+    //the pattern element.
+    if(xmlStream.readNextStartElement()) {
+        while(!mCancelled && xmlStream.readNextStartElement()) {
+            if(tagId(xmlStream.name()) == Tag_Chart) {
+                ChartData chart;
+                parseChart(&xmlStream, &chart);
+                charts->append(chart);
+            } else {
+                //the colors and stitch set are loaded on the GUI thread.
+                xmlStream.skipCurrentElement();
+            }
+        }
+    }
+
+    mStrings.clear();
+
+    if(xmlStream.hasError()) {
+        mErrorString = xmlStream.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+void ChartParser::parseChart(QXmlStreamReader *stream, ChartData *chart)
+{
+    while(stream->readNextStartElement()) {
+        Tag tag = tagId(stream->name());
+
+        switch(tag) {
+            case Tag_Cell: {
+                chart->cells.append(CellData());
+                parseCell(stream, &chart->cells.last());
+                break;
+            }
+            case Tag_Indicator: {
+                chart->indicators.append(IndicatorData());
+                parseIndicator(stream, &chart->indicators.last());
+                break;
+            }
+            case Tag_ChartImage: {
+                chart->images.append(ChartImageData());
+                parseChartImage(stream, &chart->images.last());
+                break;
+            }
+            case Tag_Name:
+                chart->name = stream->readElementText();
+                break;
+
+            case Tag_Style:
+                chart->style = readLongLong(stream);
+                break;
+
+            case Tag_DefaultSt:
+                chart->hasDefaultSt = true;
+                chart->defaultSt = stream->readElementText();
+                break;
+
+            case Tag_ChartCenter: {
+                QXmlStreamAttributes attrs = stream->attributes();
+                chart->hasCenter = true;
+                chart->center = QPointF(attribute(attrs, "x"), attribute(attrs, "y"));
+                stream->skipCurrentElement();
+                break;
+            }
+            case Tag_Grid:
+                parseGrid(stream, chart);
+                break;
+
+            case Tag_RowSpacing: {
+                QXmlStreamAttributes attrs = stream->attributes();
+                chart->hasRowSpacing = true;
+                chart->rowSpacing = QSizeF(attribute(attrs, "width"), attribute(attrs, "height"));
+                stream->skipCurrentElement();
+                break;
+            }
+            case Tag_Group:
+                //create an empty group for future use.
+                chart->groupCount++;
+                stream->skipCurrentElement();
+                break;
+
+            case Tag_Guidelines: {
+                QXmlStreamAttributes attrs = stream->attributes();
+                chart->hasGuidelines = true;
+                chart->guidelineType = attrs.value(QLatin1String("type")).toString();
+                chart->guidelineRows = toLongLong(attrs.value(QLatin1String("rows")));
+                chart->guidelineColumns = toLongLong(attrs.value(QLatin1String("columns")));
+                chart->guidelineCellHeight = toLongLong(attrs.value(QLatin1String("cellHeight")));
+                chart->guidelineCellWidth = toLongLong(attrs.value(QLatin1String("cellWidth")));
+                stream->skipCurrentElement();
+                break;
+            }
+            case Tag_ChartLayer: {
+                QXmlStreamAttributes attrs = stream->attributes();
+                LayerData layer;
+                layer.name = attrs.value(QLatin1String("name")).toString();
+                layer.uid = toLongLong(attrs.value(QLatin1String("uid")));
+                layer.visible = toLongLong(attrs.value(QLatin1String("visible")));
+                chart->layers.append(layer);
+                stream->skipCurrentElement();
+                break;
+            }
+            case Tag_Size: {
+                QXmlStreamAttributes attrs = stream->attributes();
+                chart->hasSize = true;
+                chart->size = QRectF(attribute(attrs, "x"), attribute(attrs, "y"),
+                                     attribute(attrs, "width"), attribute(attrs, "height"));
+                stream->skipCurrentElement();
+                break;
+            }
+            default:
+                qWarning() << "loadChart Unknown tag:" << stream->name().toString();
+                stream->skipCurrentElement();
+                break;
+        }
+    }
+}
+
+void ChartParser::parseGrid(QXmlStreamReader *stream, ChartData *chart)
+{
+    while(stream->readNextStartElement()) {
+        if(tagId(stream->name()) == Tag_Row)
+            chart->gridRows.append(readLongLong(stream));
+        else
+            stream->skipCurrentElement();
+    }
+}
+
+bool ChartParser::parseItemTag(QXmlStreamReader *stream, Tag tag, ItemData *item)
+{
+    switch(tag) {
+        case Tag_Position: {
+            QXmlStreamAttributes attrs = stream->attributes();
+            item->position = QPointF(attribute(attrs, "x"), attribute(attrs, "y"));
+            stream->skipCurrentElement();
+            break;
+        }
+        case Tag_Angle:
+            item->angle = readDouble(stream);
+            break;
+
+        case Tag_Scale: {
+            QXmlStreamAttributes attrs = stream->attributes();
+            item->scale = QPointF(attribute(attrs, "x"), attribute(attrs, "y"));
+            stream->skipCurrentElement();
+            break;
+        }
+        case Tag_PivotPoint: {
+            QXmlStreamAttributes attrs = stream->attributes();
+            item->pivotPoint = QPointF(attribute(attrs, "x"), attribute(attrs, "y"));
+            stream->skipCurrentElement();
+            break;
+        }
+        case Tag_Group:
+            item->group = readLongLong(stream);
+            break;
+
+        case Tag_Layer:
+            item->layer = readLongLong(stream);
+            break;
+
+        case Tag_NewScale: {
+            QXmlStreamAttributes attrs = stream->attributes();
+            item->scaleX = attribute(attrs, "scaleX");
+            item->scaleY = attribute(attrs, "scaleY");
+            item->pivotScale = QPointF(attribute(attrs, "pivotX"), attribute(attrs, "pivotY"));
+            stream->skipCurrentElement();
+            break;
+        }
+        case Tag_Rotation: {
+            QXmlStreamAttributes attrs = stream->attributes();
+            item->rotation = attribute(attrs, "rotation");
+            item->pivotRotation = QPointF(attribute(attrs, "pivotX"), attribute(attrs, "pivotY"));
+            stream->skipCurrentElement();
+            break;
+        }
+        case Tag_Transformation: {
+            QXmlStreamAttributes attrs = stream->attributes();
+            item->transform.setMatrix(
+                attribute(attrs, "m11"), attribute(attrs, "m12"), attribute(attrs, "m13"),
+                attribute(attrs, "m21"), attribute(attrs, "m22"), attribute(attrs, "m23"),
+                attribute(attrs, "m31"), attribute(attrs, "m32"), attribute(attrs, "m33"));
+            stream->skipCurrentElement();
+            break;
+        }
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+void ChartParser::parseCell(QXmlStreamReader *stream, CellData *cell)
+{
+    while(stream->readNextStartElement()) {
+        Tag tag = tagId(stream->name());
+
+        switch(tag) {
+            case Tag_Stitch:
+                cell->stitch = readInterned(stream);
+                break;
+
+            case Tag_Grid: {
+                QXmlStreamAttributes attrs = stream->attributes();
+                cell->row = (int)attribute(attrs, "row");
+                cell->column = (int)attribute(attrs, "column");
+                stream->skipCurrentElement();
+                break;
+            }
+            case Tag_Color:
+                cell->color = readInterned(stream);
+                break;
+
+            case Tag_BgColor:
+                cell->bgColor = readInterned(stream);
+                break;
+
+            default:
+                if(!parseItemTag(stream, tag, cell))
+                    stream->skipCurrentElement();
+                break;
+        }
+    }
+}
+
+void ChartParser::parseIndicator(QXmlStreamReader *stream, IndicatorData *indicator)
+{
+    while(stream->readNextStartElement()) {
+        Tag tag = tagId(stream->name());
+
+        switch(tag) {
+            case Tag_X:
+                indicator->position.rx() = readDouble(stream);
+                break;
+            case Tag_Y:
+                indicator->position.ry() = readDouble(stream);
+                break;
+            case Tag_Text:
+                indicator->text = stream->readElementText();
+                break;
+            case Tag_TextColor:
+                indicator->textColor = readInterned(stream);
+                break;
+            case Tag_BgColor:
+                indicator->bgColor = readInterned(stream);
+                break;
+            case Tag_Style:
+                indicator->style = readInterned(stream);
+                break;
+            case Tag_FontName:
+                indicator->fontName = readInterned(stream);
+                indicator->fontUsed = true;
+                break;
+            case Tag_FontSize:
+                indicator->fontSize = readLongLong(stream);
+                indicator->fontUsed = true;
+                break;
+            default:
+                if(!parseItemTag(stream, tag, indicator))
+                    stream->skipCurrentElement();
+                break;
+        }
+    }
+}
+
+void ChartParser::parseChartImage(QXmlStreamReader *stream, ChartImageData *image)
+{
+    while(stream->readNextStartElement()) {
+        Tag tag = tagId(stream->name());
+
+        if(tag == Tag_Filename) {
+            image->filename = stream->readElementText();
+        } else if(!parseItemTag(stream, tag, image)) {
+            stream->skipCurrentElement();
+        }
+    }
+}
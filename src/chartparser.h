@@ -0,0 +1,139 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef CHARTPARSER_H
+#define CHARTPARSER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QList>
+#include <QMultiHash>
+#include <QString>
+#include <QStringRef>
+
+#include "chartdata.h"
+
+class QXmlStreamReader;
+class QXmlStreamAttributes;
+
+/**
+ * Reads the charts of a version 1.2 pattern into ChartData.
+ *
+ * Tags are matched against a table of ids and numbers are read straight
+ * out of the reader's buffer, so parsing a cell doesn't create any
+ * temporary strings. The parser doesn't use any QObjects and can run
+ * on a worker thread.
+ */
+class ChartParser
+{
+public:
+    ChartParser();
+
+    /**
+     * Read every chart in the xml document @data and append them to @charts.
+     * The stitch set and colors are skipped.
+     */
+    bool parse(const QByteArray &data, QList<ChartData> *charts);
+
+    /**
+     * Stop parse(), can be called from any thread.
+     */
+    void cancel() { mCancelled = 1; }
+
+    QString errorString() const { return mErrorString; }
+
+    /**
+     * Convert @text to a number without creating a QString,
+     * falls back to QString::toDouble() for anything unusual.
+     */
+    static double toDouble(const QStringRef &text, bool *ok = 0);
+    static qlonglong toLongLong(const QStringRef &text, bool *ok = 0);
+
+private:
+    enum Tag {
+        Tag_Unknown,
+        Tag_Chart,
+        Tag_Name,
+        Tag_Style,
+        Tag_DefaultSt,
+        Tag_ChartCenter,
+        Tag_Grid,
+        Tag_Row,
+        Tag_RowSpacing,
+        Tag_Cell,
+        Tag_Indicator,
+        Tag_ChartImage,
+        Tag_Group,
+        Tag_Guidelines,
+        Tag_ChartLayer,
+        Tag_Size,
+        Tag_Stitch,
+        Tag_Color,
+        Tag_BgColor,
+        Tag_Position,
+        Tag_Angle,
+        Tag_Scale,
+        Tag_PivotPoint,
+        Tag_Layer,
+        Tag_NewScale,
+        Tag_Rotation,
+        Tag_Transformation,
+        Tag_X,
+        Tag_Y,
+        Tag_Text,
+        Tag_TextColor,
+        Tag_FontName,
+        Tag_FontSize,
+        Tag_Filename
+    };
+
+    static Tag tagId(const QStringRef &name);
+
+    void parseChart(QXmlStreamReader *stream, ChartData *chart);
+    void parseGrid(QXmlStreamReader *stream, ChartData *chart);
+    void parseCell(QXmlStreamReader *stream, CellData *cell);
+    void parseIndicator(QXmlStreamReader *stream, IndicatorData *indicator);
+    void parseChartImage(QXmlStreamReader *stream, ChartImageData *image);
+    /**
+     * Read the tags every item can have, returns false if @tag isn't one of them.
+     */
+    bool parseItemTag(QXmlStreamReader *stream, Tag tag, ItemData *item);
+
+    /**
+     * Move to the next piece of text in the current element,
+     * returns false at the end of the element.
+     */
+    static bool nextText(QXmlStreamReader *stream);
+    static double readDouble(QXmlStreamReader *stream);
+    static qlonglong readLongLong(QXmlStreamReader *stream);
+    static double attribute(const QXmlStreamAttributes &attributes, const char *name);
+    /**
+     * Read the text of the current element keeping one copy of each value,
+     * for strings like stitch names and colors that repeat across cells.
+     */
+    QString readInterned(QXmlStreamReader *stream);
+    QString intern(const QStringRef &text);
+
+    QAtomicInt mCancelled;
+    QString mErrorString;
+    QMultiHash<uint, QString> mStrings;
+};
+
+#endif // CHARTPARSER_H
@@ -21,9 +21,106 @@
 #include "crochetchartcommands.h"
 #include "ChartItemTools.h"
 #include "settings.h"
+#include "stitchlibrary.h"
+#include "indicatorundo.h"
 #include <QDebug>
 #include <QObject>
 
+//rough size of a chart item that is kept alive by an undo command.
+#define UNDO_ITEM_SIZE 512
+
+qint64 undoCommandSize(const QUndoCommand *cmd)
+{
+    qint64 size = sizeof(QUndoCommand) + 64 + cmd->text().size() * sizeof(QChar);
+
+    if(const RemoveItems *r = dynamic_cast<const RemoveItems*>(cmd))
+        size += r->itemCount() * (UNDO_ITEM_SIZE + sizeof(QGraphicsItem*));
+    else if(dynamic_cast<const AddItem*>(cmd) || dynamic_cast<const RemoveItem*>(cmd))
+        size += UNDO_ITEM_SIZE;
+    else if(const ReplaceCellStitches *s = dynamic_cast<const ReplaceCellStitches*>(cmd))
+        size += s->cellCount() * sizeof(Cell*);
+    else if(const ReplaceCellColors *c = dynamic_cast<const ReplaceCellColors*>(cmd))
+        size += c->cellCount() * (sizeof(Cell*) + sizeof(QRgb));
+
+    return size;
+}
+
+static void appendItem(QList<QGraphicsItem*> *items, QGraphicsItem *item)
+{
+    if(!item)
+        return;
+
+    //the journal stores the items inside a group, not the group itself.
+    if(item->type() == ItemGroup::Type) {
+        foreach(QGraphicsItem *child, item->childItems())
+            appendItem(items, child);
+        return;
+    }
+
+    items->append(item);
+}
+
+bool undoCommandItems(const QUndoCommand *cmd, QList<QGraphicsItem*> *items)
+{
+    if(const SetIndicatorText *c = dynamic_cast<const SetIndicatorText*>(cmd))
+        appendItem(items, c->indicator());
+    else if(const SetCellStitch *c = dynamic_cast<const SetCellStitch*>(cmd))
+        appendItem(items, c->cell());
+    else if(const ReplaceCellStitches *c = dynamic_cast<const ReplaceCellStitches*>(cmd)) {
+        foreach(Cell *cell, c->cells())
+            appendItem(items, cell);
+    } else if(const ReplaceCellColors *c = dynamic_cast<const ReplaceCellColors*>(cmd)) {
+        foreach(Cell *cell, c->cells())
+            appendItem(items, cell);
+    } else if(const SetChartZLayer *c = dynamic_cast<const SetChartZLayer*>(cmd))
+        appendItem(items, c->image());
+    else if(const SetChartImagePath *c = dynamic_cast<const SetChartImagePath*>(cmd))
+        appendItem(items, c->image());
+    else if(const SetCellBgColor *c = dynamic_cast<const SetCellBgColor*>(cmd))
+        appendItem(items, c->cell());
+    else if(const SetCellColor *c = dynamic_cast<const SetCellColor*>(cmd))
+        appendItem(items, c->cell());
+    else if(const SetItemRotation *c = dynamic_cast<const SetItemRotation*>(cmd))
+        appendItem(items, c->item());
+    else if(const SetSelectionRotation *c = dynamic_cast<const SetSelectionRotation*>(cmd)) {
+        foreach(QGraphicsItem *item, c->itemList())
+            appendItem(items, item);
+    } else if(const SetItemCoordinates *c = dynamic_cast<const SetItemCoordinates*>(cmd))
+        appendItem(items, c->item());
+    else if(const SetItemScale *c = dynamic_cast<const SetItemScale*>(cmd))
+        appendItem(items, c->item());
+    else if(const AddItem *c = dynamic_cast<const AddItem*>(cmd))
+        appendItem(items, c->item());
+    else if(const RemoveItem *c = dynamic_cast<const RemoveItem*>(cmd))
+        appendItem(items, c->item());
+    else if(const RemoveItems *c = dynamic_cast<const RemoveItems*>(cmd)) {
+        foreach(QGraphicsItem *item, c->itemList())
+            appendItem(items, item);
+    } else if(const SetLayerStitch *c = dynamic_cast<const SetLayerStitch*>(cmd))
+        appendItem(items, c->item());
+    else if(const SetLayerIndicator *c = dynamic_cast<const SetLayerIndicator*>(cmd))
+        appendItem(items, c->item());
+    else if(const SetLayerGroup *c = dynamic_cast<const SetLayerGroup*>(cmd))
+        appendItem(items, c->item());
+    else if(const SetLayerImage *c = dynamic_cast<const SetLayerImage*>(cmd))
+        appendItem(items, c->item());
+    else if(const AddIndicator *c = dynamic_cast<const AddIndicator*>(cmd))
+        appendItem(items, c->indicator());
+    else if(const RemoveIndicator *c = dynamic_cast<const RemoveIndicator*>(cmd))
+        appendItem(items, c->indicator());
+    else if(const ChangeTextIndicator *c = dynamic_cast<const ChangeTextIndicator*>(cmd))
+        appendItem(items, c->indicator());
+    else if(cmd->childCount() == 0 || cmd->id() != -1)
+        return false;
+
+    for(int i = 0; i < cmd->childCount(); ++i) {
+        if(!undoCommandItems(cmd->child(i), items))
+            return false;
+    }
+
+    return true;
+}
+
 /*************************************************\
 | SetIndicatorText                                   |
 \*************************************************/
@@ -78,6 +175,104 @@ void SetCellStitch::setStitch(Cell *cell, QString stitch)
     cell->setStitch(stitch);
 }
 
+/*************************************************\
+| ReplaceCellStitches                             |
+\*************************************************/
+ReplaceCellStitches::ReplaceCellStitches(Scene *scene, QVector<Cell*> cells, QString oldSt, QString newSt, QUndoCommand *parent)
+    : QUndoCommand(parent)
+{
+    s = scene;
+    mCells = cells;
+    oldStitch = oldSt;
+    newStitch = newSt;
+    setText(QObject::tr("replace stitches"));
+}
+
+void ReplaceCellStitches::redo()
+{
+    setStitches(s, mCells, oldStitch, newStitch);
+}
+
+void ReplaceCellStitches::undo()
+{
+    setStitches(s, mCells, newStitch, oldStitch);
+}
+
+void ReplaceCellStitches::setStitches(Scene *scene, const QVector<Cell*> &cells, QString oldSt, QString newSt)
+{
+    Stitch *stitch = StitchLibrary::inst()->findStitch(newSt);
+    if(!stitch) {
+        QString st = Settings::inst()->value("defaultStitch").toString();
+        stitch = StitchLibrary::inst()->findStitch(st);
+    }
+
+    foreach(Cell *c, cells) {
+        c->blockSignals(true);
+        c->setStitch(stitch);
+        c->blockSignals(false);
+    }
+
+    scene->emitStitchesChanged(oldSt, stitch->name(), cells.count());
+}
+
+/*************************************************\
+| ReplaceCellColors                               |
+\*************************************************/
+ReplaceCellColors::ReplaceCellColors(Scene *scene, QVector<Cell*> cells, QColor newCl, bool background, QUndoCommand *parent)
+    : QUndoCommand(parent)
+{
+    s = scene;
+    mCells = cells;
+    mNewColor = newCl.rgba();
+    mBackground = background;
+
+    mOldColors.reserve(mCells.count());
+    foreach(Cell *c, mCells)
+        mOldColors.append(mBackground ? c->bgColor().rgba() : c->color().rgba());
+
+    setText(mBackground ? QObject::tr("replace background color") : QObject::tr("replace color"));
+}
+
+void ReplaceCellColors::redo()
+{
+    setColors(false);
+}
+
+void ReplaceCellColors::undo()
+{
+    setColors(true);
+}
+
+void ReplaceCellColors::setColors(bool useOld)
+{
+    //count the changes by color so the pattern colors are updated once per color.
+    QHash<QRgb, int> changes;
+    int count = mCells.count();
+
+    for(int i = 0; i < count; ++i) {
+        Cell *c = mCells.at(i);
+        QColor color = QColor::fromRgba(useOld ? mOldColors.at(i) : mNewColor);
+
+        c->blockSignals(true);
+        if(mBackground)
+            c->setBgColor(color);
+        else
+            c->setColor(color);
+        c->blockSignals(false);
+
+        changes[mOldColors.at(i)]++;
+    }
+
+    QString newName = QColor::fromRgba(mNewColor).name();
+    foreach(QRgb old, changes.keys()) {
+        QString oldName = QColor::fromRgba(old).name();
+        if(useOld)
+            s->emitColorsChanged(newName, oldName, changes.value(old));
+        else
+            s->emitColorsChanged(oldName, newName, changes.value(old));
+    }
+}
+
 /*************************************************\
 | SetChartZLayer                                  |
 \*************************************************/
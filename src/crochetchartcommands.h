@@ -22,11 +22,25 @@
 #define CROCHETCHARTCOMMANDS_H
 
 #include <QUndoCommand>
+#include <QVector>
 
 #include "cell.h"
 #include "ChartImage.h"
 #include "scene.h"
 
+/**
+ * Rough number of bytes held by an undo command, not counting its children.
+ * Used by the UndoStack to keep the history under the memory limit.
+ */
+qint64 undoCommandSize(const QUndoCommand *cmd);
+
+/**
+ * Add the chart items changed by @cmd and its children to @items.
+ * Returns false if the command changes more than the items (groups, layers)
+ * or isn't a known command.
+ */
+bool undoCommandItems(const QUndoCommand *cmd, QList<QGraphicsItem*> *items);
+
 class SetIndicatorText : public QUndoCommand
 {
 public:
@@ -38,6 +52,8 @@ public:
     void redo();
 
     int id() const { return Id; }
+
+    Indicator* indicator() const { return i; }
     
     static void setText(Indicator *i, QString text);
 
@@ -58,6 +74,8 @@ public:
     void redo();
 
     int id() const { return Id; }
+
+    Cell* cell() const { return c; }
     
     static void setStitch(Cell *cell, QString stitch);
 
@@ -67,6 +85,63 @@ private:
     Cell *c;
 };
 
+/**
+ * Change the stitch of many cells in one command.
+ * The cells don't emit their own signals, the pattern stitches are updated once.
+ */
+class ReplaceCellStitches : public QUndoCommand
+{
+public:
+    enum { Id = 1310 };
+
+    ReplaceCellStitches(Scene *scene, QVector<Cell*> cells, QString oldSt, QString newSt, QUndoCommand *parent = 0);
+
+    void undo();
+    void redo();
+
+    int id() const { return Id; }
+
+    static void setStitches(Scene *scene, const QVector<Cell*> &cells, QString oldSt, QString newSt);
+
+    int cellCount() const { return mCells.count(); }
+    QVector<Cell*> cells() const { return mCells; }
+
+private:
+    Scene *s;
+    QVector<Cell*> mCells;
+    QString oldStitch;
+    QString newStitch;
+};
+
+/**
+ * Change the color or background color of many cells in one command.
+ * The old colors are kept in one array and the pattern colors are updated once.
+ */
+class ReplaceCellColors : public QUndoCommand
+{
+public:
+    enum { Id = 1320 };
+
+    ReplaceCellColors(Scene *scene, QVector<Cell*> cells, QColor newCl, bool background, QUndoCommand *parent = 0);
+
+    void undo();
+    void redo();
+
+    int id() const { return Id; }
+
+    int cellCount() const { return mCells.count(); }
+    QVector<Cell*> cells() const { return mCells; }
+
+private:
+    void setColors(bool useOld);
+
+    Scene *s;
+    QVector<Cell*> mCells;
+    QVector<QRgb> mOldColors;
+    QRgb mNewColor;
+    bool mBackground;
+};
+
 class SetChartZLayer : public QUndoCommand
 {
 public:
@@ -77,6 +152,8 @@ public:
     void redo();
 
     int id() const { return Id; }
+
+	ChartImage* image() const { return ci; }
     
     static void setZLayer(ChartImage *ci, const QString& layer);
 	
@@ -96,6 +173,8 @@ public:
     void redo();
 
     int id() const { return Id; }
+
+	ChartImage* image() const { return ci; }
     
     static void setPath(ChartImage *ci, const QString& path);
 	
@@ -116,6 +195,8 @@ public:
     void redo();
 
     int id() const { return Id; }
+
+    Cell* cell() const { return c; }
     
     static void setBgColor(Cell *cell, QColor color);
 
@@ -137,6 +218,8 @@ public:
 
     int id() const { return Id; }
 
+    Cell* cell() const { return c; }
+
     static void setColor(Cell *cell, QColor color);
 
 private:
@@ -157,6 +240,8 @@ public:
 
     int id() const { return Id; }
 
+    QGraphicsItem* item() const { return i; }
+
     static void setRotation(QGraphicsItem *item, qreal angle, QPointF pivot);
 
 private:
@@ -190,6 +275,8 @@ public:
 
     int id() const { return Id; }
 
+    QList<QGraphicsItem*> itemList() const { return items; }
+
     static void rotate(Scene *scene, qreal degrees, QList<QGraphicsItem*> items, QPointF pivotPoint);
 
 private:
@@ -212,6 +299,8 @@ public:
 
     int id() const { return Id; }
 
+    QGraphicsItem* item() const { return i; }
+
     static void setPosition(QGraphicsItem *item, QPointF position);
 
 private:
@@ -232,6 +321,8 @@ public:
 
     int id() const { return Id; }
 
+    QGraphicsItem* item() const { return i; }
+
     static void setScale(QGraphicsItem *item, QPointF scale, QPointF pivot);
 
 private:
@@ -255,6 +346,8 @@ public:
 
     int id() const { return Id; }
 
+    QGraphicsItem* item() const { return i; }
+
     static void add(Scene *scene, QGraphicsItem *item);
 
 private:
@@ -275,6 +368,8 @@ public:
 
     int id() const { return Id; }
 
+    QGraphicsItem* item() const { return i; }
+
     static void remove(Scene *scene, QGraphicsItem *item);
 
 private:
@@ -298,6 +393,9 @@ public:
 
     int id() const { return Id; }
 
+    int itemCount() const { return items.count(); }
+    QList<QGraphicsItem*> itemList() const { return items; }
+
 private:
     QList<QGraphicsItem*> items;
 	QGraphicsItemGroup* removegroup;
@@ -387,6 +485,7 @@ public:
 	void redo();
 	
 	int id() const { return Id; }
+	QGraphicsItem* item() const { return c; }
 private:
 	Scene* s;
 	Cell* c;
@@ -405,6 +504,7 @@ public:
 	void redo();
 	
 	int id() const { return Id; }
+	QGraphicsItem* item() const { return c; }
 private:
 	Scene* s;
 	Indicator* c;
@@ -423,6 +523,7 @@ public:
 	void redo();
 	
 	int id() const { return Id; }
+	QGraphicsItem* item() const { return c; }
 private:
 	Scene* s;
 	ItemGroup* c;
@@ -441,6 +542,7 @@ public:
 	void redo();
 	
 	int id() const { return Id; }
+	QGraphicsItem* item() const { return c; }
 private:
 	Scene* s;
 	ChartImage* c;
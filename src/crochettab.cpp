@@ -25,6 +25,8 @@
 #include <QSplitter>
 
 #include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QSet>
 
 #include <QXmlStreamWriter>
 #include <QDropEvent>
@@ -70,6 +72,8 @@ CrochetTab::CrochetTab(Scene::ChartStyle style, int defEditMode, QString defStit
     
     connect(mScene, SIGNAL(stitchChanged(QString,QString)), SLOT(stitchChanged(QString,QString)));
     connect(mScene, SIGNAL(colorChanged(QString,QString)), SLOT(colorChanged(QString,QString)));
+    connect(mScene, SIGNAL(stitchesChanged(QString,QString,int)), SLOT(stitchesChanged(QString,QString,int)));
+    connect(mScene, SIGNAL(colorsChanged(QString,QString,int)), SLOT(colorsChanged(QString,QString,int)));
     connect(mScene, SIGNAL(rowEdited(bool)), SIGNAL(tabModified(bool)));
     connect(mScene, SIGNAL(guidelinesUpdated(Guidelines)), SIGNAL(guidelinesUpdated(Guidelines)));
 	connect(mScene, SIGNAL(layersChanged(QList<ChartLayer*>&, ChartLayer*)), this, SLOT(layersChangedSlot(QList<ChartLayer*>&, ChartLayer*)));
@@ -142,24 +146,53 @@ Scene::SelectMode CrochetTab::selectMode() const
 
 void CrochetTab::renderChartSelected(QPainter* painter, QRectF rect)
 {
-	
-    QRectF r = mScene->selectedItemsBoundingRect(mScene->selectedItems());
-	//make all unselected items invisible
-	QList<QGraphicsItem*> selected = mScene->selectedItems();
-	foreach(QGraphicsItem* item, mScene->items()) {
-		item->setVisible(false);
-	}
-	foreach(QGraphicsItem* item, selected) {
-		item->setVisible(true);
-	}
-    mScene->render(painter, rect, r);
+    QList<QGraphicsItem*> selected = mScene->selectedItems();
+    QRectF r = mScene->selectedItemsBoundingRect(selected);
+    if(r.isEmpty())
+        return;
+
+    if(rect.isNull())
+        rect = QRectF(0, 0, painter->device()->width(), painter->device()->height());
+
+    //only look at the items around the selection, and keep the selected ones and their children.
+    QSet<QGraphicsItem*> selectedSet = selected.toSet();
+    QList<QGraphicsItem*> items;
+    foreach(QGraphicsItem* item, mScene->items(r, Qt::IntersectsItemBoundingRect, Qt::AscendingOrder)) {
+        if(!item->isVisible())
+            continue;
+
+        QGraphicsItem* i = item;
+        while(i && !selectedSet.contains(i))
+            i = i->parentItem();
+        if(i)
+            items.append(item);
+    }
 
-    mView->centerOn(r.center());
-	
-	//and make them visible once more
-	foreach(QGraphicsItem* item, mScene->items()) {
-		item->setVisible(true);
-	}
+    //map the selection onto rect the same way QGraphicsScene::render does.
+    qreal ratio = qMin(rect.width() / r.width(), rect.height() / r.height());
+    QTransform view = QTransform().translate(rect.left(), rect.top())
+                                  .scale(ratio, ratio)
+                                  .translate(-r.left(), -r.top());
+
+    painter->save();
+    painter->setClipRect(rect, Qt::IntersectClip);
+    QTransform base = painter->worldTransform();
+
+    //the items are painted without the selected state so there are no dotted lines.
+    foreach(QGraphicsItem* item, items) {
+        QStyleOptionGraphicsItem option;
+        option.state = item->isEnabled() ? QStyle::State_Enabled : QStyle::State_None;
+        option.rect = item->boundingRect().toRect();
+        option.exposedRect = item->boundingRect();
+
+        painter->save();
+        painter->setWorldTransform(item->sceneTransform() * view * base);
+        painter->setOpacity(item->effectiveOpacity());
+        item->paint(painter, &option, 0);
+        painter->restore();
+    }
+
+    painter->restore();
 }
 
 void CrochetTab::renderChart(QPainter* painter, QRectF rect)
@@ -220,6 +253,96 @@ void CrochetTab::colorChanged(QString oldColor, QString newColor)
     emit chartColorChanged();
 }
 
+void CrochetTab::stitchesChanged(QString oldSt, QString newSt, int count)
+{
+    if(count <= 0 || oldSt == newSt)
+        return;
+
+    bool change = false;
+    if (mPatternStitches->contains(oldSt)) {
+        int left = mPatternStitches->value(oldSt) - count;
+        if (left <= 0) {
+            mPatternStitches->remove(oldSt);
+            change = true;
+        } else {
+            mPatternStitches->insert(oldSt, left);
+        }
+    }
+
+    if (!newSt.isEmpty()) {
+        if (!mPatternStitches->contains(newSt)) {
+            mPatternStitches->insert(newSt, count);
+            change = true;
+        } else {
+            mPatternStitches->operator[](newSt) += count;
+        }
+    }
+
+    if(change)
+        emit chartStitchChanged();
+}
+
+void CrochetTab::colorsChanged(QString oldColor, QString newColor, int count)
+{
+    if(count <= 0 || oldColor == newColor)
+        return;
+
+    if (mPatternColors->contains(oldColor)) {
+        mPatternColors->operator[](oldColor)["count"] -= count;
+        if (mPatternColors->operator[](oldColor)["count"] <= 0)
+            mPatternColors->remove(oldColor);
+    }
+
+    if (!mPatternColors->contains(newColor)) {
+        QMap<QString, qint64> properties;
+        properties["added"] = QDateTime::currentDateTime().toMSecsSinceEpoch();
+        properties["count"] = count;
+        mPatternColors->insert(newColor, properties);
+    } else
+        mPatternColors->operator[](newColor)["count"] += count;
+
+    emit chartColorChanged();
+}
+
+void CrochetTab::setPendingChart(const ChartIndexData &chart)
+{
+    mPendingChart = chart;
+
+    foreach(QString st, chart.stitches.keys())
+        stitchesChanged("", st, chart.stitches.value(st));
+    foreach(QString color, chart.colors.keys())
+        colorsChanged("", color, chart.colors.value(color));
+}
+
+void CrochetTab::clearPendingChart()
+{
+    if(!hasPendingChart())
+        return;
+
+    foreach(QString st, mPendingChart.stitches.keys()) {
+        if(!mPatternStitches->contains(st))
+            continue;
+        int left = mPatternStitches->value(st) - mPendingChart.stitches.value(st);
+        if(left <= 0)
+            mPatternStitches->remove(st);
+        else
+            mPatternStitches->insert(st, left);
+    }
+
+    foreach(QString color, mPendingChart.colors.keys()) {
+        if(!mPatternColors->contains(color))
+            continue;
+        mPatternColors->operator[](color)["count"] -= mPendingChart.colors.value(color);
+        if(mPatternColors->operator[](color)["count"] <= 0)
+            mPatternColors->remove(color);
+    }
+
+    mPendingChart = ChartIndexData();
+
+    emit chartStitchChanged();
+    emit chartColorChanged();
+}
+
 void CrochetTab::layersChangedSlot(QList<ChartLayer*>& layers, ChartLayer* selected)
 {
 	emit layersChanged(layers, selected);
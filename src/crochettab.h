@@ -30,6 +30,7 @@
 #include "scene.h"
 
 #include "roweditdialog.h"
+#include "chartdata.h"
 
 class QGraphicsView;
 class TextView;
@@ -45,6 +46,7 @@ class CrochetTab : public QWidget
     friend class FileFactory;
     friend class File_v1;
     friend class File_v2;
+    friend class File_v3;
     friend class ExportUi;
 	friend class ResizeUI;
     friend class PropertiesDock;
@@ -54,6 +56,9 @@ public:
     ~CrochetTab();
 	
     void renderChart(QPainter* painter, QRectF rect = QRectF());
+    /**
+     * Draw the selected items and their children into @rect, the scene isn't changed.
+     */
 	void renderChartSelected(QPainter* painter, QRectF rect = QRectF());
 
     void setPatternStitches(QMap<QString, int>* stitches) { mPatternStitches = stitches; }
@@ -112,6 +117,18 @@ public:
 
     QList<QGraphicsItem*> selectedItems();
 
+    /**
+     * Show a chart whose items are still in the file, its stitches and colors
+     * are counted from the file's index until the items are loaded.
+     */
+    void setPendingChart(const ChartIndexData &chart);
+    bool hasPendingChart() const { return !mPendingChart.sections.isEmpty(); }
+    const ChartIndexData& pendingChart() const { return mPendingChart; }
+    /**
+     * Remove the counts added by setPendingChart(), call after the items are loaded.
+     */
+    void clearPendingChart();
+
 signals:
 	void layersChanged(QList<ChartLayer*>& layers, ChartLayer* selected);
     void chartStitchChanged();
@@ -130,6 +147,8 @@ public slots:
 
     void stitchChanged(QString oldSt, QString newSt = 0);
     void colorChanged(QString oldColor, QString newColor);
+    void stitchesChanged(QString oldSt, QString newSt, int count);
+    void colorsChanged(QString oldColor, QString newColor, int count);
 	void layersChangedSlot(QList<ChartLayer*>& layers, ChartLayer* selected);
 
     QUndoStack* undoStack();
@@ -176,6 +195,8 @@ private:
     
 
     Scene::ChartStyle mChartStyle;
+
+    ChartIndexData mPendingChart;
 };
 
 #endif // CROCHETTAB_H
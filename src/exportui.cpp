@@ -31,9 +31,22 @@
 
 #include <QPrinter> //for pdf
 #include <QSvgGenerator> //for svg
+#include <QPicture>
+#include <QFontDatabase>
+#include <QThread>
+#include <QtConcurrentMap>
 
 #include "crochettab.h"
 #include "scene.h" // for to connect the scene to the view.
+#include "bandwriter.h"
+#include "svgwriter.h"
+#include "pagetiler.h"
+#include "ChartImage.h"
+#include "stitchlibrary.h"
+#include "stitch.h"
+
+//the most memory a band of a tiled image export can use, in bytes.
+#define EXPORT_BAND_BYTES (16 * 1024 * 1024)
 
 ExportUi::ExportUi(QTabWidget* tab, QMap<QString, int>* stitches,
                    QMap<QString, QMap<QString, qint64> >* colors, QWidget* parent)
@@ -147,7 +160,9 @@ void ExportUi::updateColorLegend()
     cl->showTitle = ui->colorTitle->isChecked();
     cl->sortBy = ui->colorSortBy->currentText();
     
-    scene->update();
+    cl->updateLayout();
+    if(cl->scene())
+        scene->setSceneRect(cl->boundingRect());
 }
 
 void ExportUi::updateStitchLegend()
@@ -158,7 +173,9 @@ void ExportUi::updateStitchLegend()
     sl->showDescription = ui->showStitchDescription->isChecked();
     sl->showWrongSide = ui->showStitchWrongSide->isChecked();
     
-    scene->update();
+    sl->updateLayout();
+    if(sl->scene())
+        scene->setSceneRect(sl->boundingRect());
 }
 
 void ExportUi::updateExportOptions(QString expType)
@@ -322,7 +339,15 @@ void ExportUi::exportData()
         return;
 
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+    bool ok = exportFile();
+    QApplication::restoreOverrideCursor();
+
+    if(!ok)
+        QMessageBox::warning(this, tr("Export"), tr("The file %1 could not be written.").arg(fileName));
+}
 
+bool ExportUi::exportFile()
+{
     //we don't want the dotted lines in the image.
 	QList< QList<QGraphicsItem*> > selectedPerTab;
 	for(int i = 0; i < mTabWidget->count(); ++i) {
@@ -332,21 +357,22 @@ void ExportUi::exportData()
 			if(t) t->clearSelection();
 	}
 
+    bool ok;
     if(selection == tr("Stitch Legend") || selection == tr("Color Legend")) {
         if(exportType == "pdf")
-            exportLegendPdf();
+            ok = exportLegendPdf();
         else if (exportType == "svg")
-            exportLegendSvg();
+            ok = exportLegendSvg();
         else
-            exportLegendImg();
+            ok = exportLegendImg();
 
     } else { //charts
         if(exportType == "pdf")
-            exportPdf();
+            ok = exportPdf();
         else if(exportType == "svg")
-            exportSvg();
+            ok = exportSvg();
         else
-            exportImg();
+            ok = exportImg();
     }
 	
 	//restore the selected items
@@ -356,7 +382,7 @@ void ExportUi::exportData()
 		}
 	}
 
-    QApplication::restoreOverrideCursor();
+    return ok;
 }
 
 int ExportUi::exec()
@@ -384,6 +410,7 @@ void ExportUi::setSelection(QString selection)
             scene->removeItem(cl);
         if(!scene->items().contains(sl))
             scene->addItem(sl);
+        scene->setSceneRect(sl->boundingRect());
     } else if(selection == tr("Color Legend")) {
         ui->view->setScene(scene);
         ui->stitchLegendOptions->hide();
@@ -396,6 +423,7 @@ void ExportUi::setSelection(QString selection)
             scene->removeItem(sl);
         if(!scene->items().contains(cl))
             scene->addItem(cl);
+        scene->setSceneRect(cl->boundingRect());
     } else {
 		CrochetTab* tab = 0;
         for(int i = 0; i < mTabWidget->count(); ++i) {
@@ -422,7 +450,7 @@ void ExportUi::setSelection(QString selection)
     updateChartSizeRatio(selection);
 }
 
-void ExportUi::exportLegendPdf()
+bool ExportUi::exportLegendPdf()
 {
     QPainter* p = new QPainter();
 
@@ -435,7 +463,10 @@ void ExportUi::exportLegendPdf()
     if(pageToChartSize)
         printer->setPaperSize(size, QPrinter::Point);
 
-    p->begin(printer);
+    if(!p->begin(printer)) {
+        qWarning() << "Could not export" << fileName;
+        return false;
+    }
 	
 	//we store the height of the header for later
 	int headerSize = 0;
@@ -449,10 +480,10 @@ void ExportUi::exportLegendPdf()
 	
     scene->render(p, QRectF(0, headerSize, p->window().width(), p->window().height() - headerSize - footerSize));
 
-    p->end();
+    return p->end();
 }
 
-void ExportUi::exportLegendSvg()
+bool ExportUi::exportLegendSvg()
 {
     QPainter* p = new QPainter();
     
@@ -465,14 +496,17 @@ void ExportUi::exportLegendSvg()
     gen.setFileName(fileName);
     gen.setSize(scene->sceneRect().size().toSize());
     
-    p->begin(&gen);
+    if(!p->begin(&gen)) {
+        qWarning() << "Could not export" << fileName;
+        return false;
+    }
 	
     scene->render(p);
 
-    p->end();
+    return p->end();
 }
 
-void ExportUi::exportLegendImg()
+bool ExportUi::exportLegendImg()
 {
     if(mColors->count() < 1) {
         QMessageBox msgbox(this);
@@ -482,46 +516,42 @@ void ExportUi::exportLegendImg()
         msgbox.setStandardButtons(QMessageBox::Ok);
         
         msgbox.exec();
-        return;
+        return false;
     }
-    
-    QPainter* p = new QPainter(this);
-	
-	QSize size = scene->sceneRect().size().toSize();
-    QPixmap pix = QPixmap(size);
-
-    p->begin(&pix);
-	
-    scene->render(p);
 
-    p->end();
-    pix.save(fileName);
+    return exportImage(scene->sceneRect().size().toSize());
 }
 
-int ExportUi::renderHeader(QPainter &painter, QString text) 
+int ExportUi::renderHeader(QPainter &painter, QString text, QRect page)
 {
     painter.save();
-    painter.resetTransform();
+    if(page.isNull()) {
+        painter.resetTransform();
+        page = painter.window();
+    }
     painter.setFont(QFont("Courier New", 12));
-    QRect boundingRect = painter.boundingRect(painter.window(), Qt::AlignJustify | Qt::TextWordWrap, text);
+    QRect boundingRect = painter.boundingRect(page, Qt::AlignJustify | Qt::TextWordWrap, text);
     painter.drawText(boundingRect, Qt::AlignJustify | Qt::TextWordWrap, text);
     painter.restore();
     return boundingRect.height();
 }
  
-int ExportUi::renderFooter(QPainter &painter, QString text) 
+int ExportUi::renderFooter(QPainter &painter, QString text, QRect page)
 {
     painter.save();
-    painter.resetTransform();
+    if(page.isNull()) {
+        painter.resetTransform();
+        page = painter.window();
+    }
     painter.setFont(QFont("Courier New", 12));
-    QRect boundingRect = painter.boundingRect(painter.window(), Qt::AlignJustify | Qt::TextWordWrap, text);
-    painter.translate(0, painter.window().height() - boundingRect.height());
+    QRect boundingRect = painter.boundingRect(page, Qt::AlignJustify | Qt::TextWordWrap, text);
+    painter.translate(0, page.height() - boundingRect.height());
     painter.drawText(boundingRect, Qt::AlignJustify | Qt::TextWordWrap, text);
     painter.restore();
     return boundingRect.height();
 }
 
-void ExportUi::exportPdf()
+bool ExportUi::exportPdf()
 {
     int tabCount = mTabWidget->count();
     QPainter* p = new QPainter();
@@ -535,7 +565,10 @@ void ExportUi::exportPdf()
     if(pageToChartSize)
         printer->setPaperSize(size, QPrinter::Point);
     
-    p->begin(printer);
+    if(!p->begin(printer)) {
+        qWarning() << "Could not export" << fileName;
+        return false;
+    }
     
     bool firstPass = true;
     for(int i = 0; i < tabCount; ++i) {
@@ -559,23 +592,36 @@ void ExportUi::exportPdf()
             CrochetTab* tab = qobject_cast<CrochetTab*>(mTabWidget->widget(i));
 			
 			//calculate the position of the drawing, because of the header
-			QRectF renderRect = p->window();
-			renderRect.moveTop(headerSize);
+			QRectF renderRect = QRectF(0, headerSize, p->window().width(), p->window().height() - headerSize - footerSize);
 			
+            if (PageTiler::isEnabled() && !pageToChartSize && !selectionOnly) {
+                //print the chart at a fixed stitch size across as many pages as it needs.
+                PageTiler tiler = PageTiler::fromSettings(printer, tab->scene()->itemsBoundingRect(), renderRect);
+                for(int page = 0; page < tiler.count(); ++page) {
+                    if(page > 0) {
+                        printer->newPage();
+                        if (includeHeaderFooter) {
+                            renderHeader(*p, ui->headerEdit->toPlainText());
+                            renderFooter(*p, ui->footerEdit->toPlainText());
+                        }
+                    }
+                    tiler.renderPage(p, tab->scene(), page);
+                }
             //only render the selection if we must
-			if (selectionOnly)
-				tab->renderChartSelected(p, QRectF(0, headerSize, p->window().width(), p->window().height() - headerSize - footerSize));
-			else
-				tab->renderChart(p, QRectF(0, headerSize, p->window().width(), p->window().height() - headerSize - footerSize));
+            } else if (selectionOnly) {
+				tab->renderChartSelected(p, renderRect);
+            } else {
+				tab->renderChart(p, renderRect);
+            }
             firstPass = false;
             if(selection != tr("All Charts"))
                 break;
         }
     }
-    p->end();
+    return p->end();
 }
 
-void ExportUi::exportSvg()
+bool ExportUi::exportSvg()
 {
     int tabCount = mTabWidget->count();
 
@@ -587,65 +633,232 @@ void ExportUi::exportSvg()
 
         }
     }
-    
-    QRectF rect = tab->scene()->itemsBoundingRect();
 
-    QSvgGenerator gen;
-    gen.setFileName(fileName);
-    gen.setSize(rect.size().toSize());
-    gen.setViewBox(rect);
-
-    gen.setTitle(QFileInfo(fileName).baseName() + " (" + mTabWidget->tabText(mTabWidget->indexOf(tab)) + ")");
-    gen.setDescription(tr("This file was generated by %1").arg(qApp->applicationName()) );
-
-    QPainter p;
-    p.begin(&gen);
-		
-	if (selectionOnly)
-		tab->renderChartSelected(&p, QRectF(QPointF(rect.x(), rect.y()),QSizeF((qreal)width, (qreal)height)));
-	else
-		tab->renderChart(&p, QRectF(QPointF(rect.x(), rect.y()),QSizeF((qreal)width, (qreal)height)));
+    if(!tab)
+        return false;
     
-    p.end();
+    Scene* chartScene = tab->scene();
+    QRectF rect;
+    if (selectionOnly)
+        rect = chartScene->selectedItemsBoundingRect(chartScene->selectedItems());
+    else
+        rect = chartScene->itemsBoundingRect();
+
+    //each stitch is written once as a symbol, the cells only reference it.
+    SvgWriter writer;
+    writer.setTitle(QFileInfo(fileName).baseName() + " (" + mTabWidget->tabText(mTabWidget->indexOf(tab)) + ")");
+    writer.setDescription(tr("This file was generated by %1").arg(qApp->applicationName()) );
 
+    if(!writer.write(fileName, chartScene, rect, selectionOnly)) {
+        qWarning() << "Could not export" << fileName;
+        return false;
+    }
+    return true;
 }
 
-void ExportUi::exportImg()
+bool ExportUi::exportImg()
 {
-    int tabCount = mTabWidget->count();
-    QPainter* p = new QPainter();
+    return exportImage(QSize(width, height));
+}
 
-    double dpm = resolution * (39.3700787);
-    QImage img = QImage(QSize(width, height), QImage::Format_ARGB32);
-    img.setDotsPerMeterX(dpm);
-    img.setDotsPerMeterY(dpm);
+bool ExportUi::exportImage(QSize size)
+{
+    if(BandWriter::canWrite(exportType))
+        return exportTiled(size);
+
+    ExportBand page = recordPage(size);
+    QImage img = QImage(size, QImage::Format_ARGB32);
+    img.setDotsPerMeterX(page.dotsPerMeter);
+    img.setDotsPerMeterY(page.dotsPerMeter);
+
+    int rows = bandRows(size);
+    int threads = qMax(1, QThread::idealThreadCount());
+    for(int y = 0; y < size.height(); y += rows * threads) {
+        int top = y;
+        foreach(const QImage &band, renderBands(page, y, rows, threads)) {
+            for(int r = 0; r < band.height(); ++r)
+                memcpy(img.scanLine(top + r), band.constScanLine(r), band.bytesPerLine());
+            top += band.height();
+        }
+    }
 
-    p->begin(&img);
-    p->fillRect(0, 0, width, height, QColor(Qt::white));
+    if(!img.save(fileName)) {
+        qWarning() << "Could not export" << fileName;
+        return false;
+    }
+    return true;
+}
 
-	//we store the height of the header for later
-	int headerSize = 0;
-	int footerSize = 0;
-	
-	//and print the header
-	if (includeHeaderFooter) {
-		headerSize = renderHeader(*p, ui->headerEdit->toPlainText());
-		footerSize = renderFooter(*p, ui->footerEdit->toPlainText());
-	}
+void ExportUi::renderPageContent(QPainter *p, QSize size, int headerSize, int footerSize)
+{
+    if(selection == tr("Stitch Legend") || selection == tr("Color Legend")) {
+        scene->render(p, QRectF(QPointF(0, 0), size), scene->sceneRect());
+        return;
+    }
 
-    for(int i = 0; i < tabCount; ++i) {
+    QRectF rect(QPointF(0, headerSize), QSizeF((qreal)size.width(), (qreal)size.height() - headerSize - footerSize));
+    for(int i = 0; i < mTabWidget->count(); ++i) {
         if(selection == mTabWidget->tabText(i)) {
             CrochetTab* tab = qobject_cast<CrochetTab*>(mTabWidget->widget(i));
             if (selectionOnly)
-				tab->renderChartSelected(p, QRectF(QPointF(0,headerSize),QSizeF((qreal)width, (qreal)height - headerSize - footerSize)));
+				tab->renderChartSelected(p, rect);
 			else
-				tab->renderChart(p, QRectF(QPointF(0,headerSize),QSizeF((qreal)width, (qreal)height - headerSize - footerSize)));
+				tab->renderChart(p, rect);
         }
     }
-	
-    p->end();
+}
+
+ExportBand ExportUi::recordPage(QSize size)
+{
+    ExportBand page;
+    page.size = size;
+    page.dotsPerMeter = resolution * (39.3700787);
+    page.headerFooter = includeHeaderFooter &&
+            selection != tr("Stitch Legend") && selection != tr("Color Legend");
+    page.header = ui->headerEdit->toPlainText();
+    page.footer = ui->footerEdit->toPlainText();
+    page.pixmaps = pageHasPixmaps();
+
+    //the text size depends on the resolution, measure it on an image like the bands.
+    int headerSize = 0;
+    int footerSize = 0;
+    QImage probe(1, 1, QImage::Format_ARGB32);
+    probe.setDotsPerMeterX(page.dotsPerMeter);
+    probe.setDotsPerMeterY(page.dotsPerMeter);
+
+    QPainter p;
+    p.begin(&probe);
+    renderPageText(&p, page, &headerSize, &footerSize);
+    p.end();
+
+    QPicture picture;
+    p.begin(&picture);
+    renderPageContent(&p, size, headerSize, footerSize);
+    p.end();
+
+    page.picture = QByteArray(picture.data(), picture.size());
+    return page;
+}
+
+bool ExportUi::pageHasPixmaps()
+{
+    if(selection == tr("Color Legend"))
+        return false;
+
+    foreach(QString name, mStitches->keys()) {
+        Stitch *s = StitchLibrary::inst()->findStitch(name);
+        if(s && !s->isSvg())
+            return true;
+    }
+
+    if(selection == tr("Stitch Legend"))
+        return false;
+
+    for(int i = 0; i < mTabWidget->count(); ++i) {
+        if(selection != mTabWidget->tabText(i))
+            continue;
+
+        CrochetTab* tab = qobject_cast<CrochetTab*>(mTabWidget->widget(i));
+        foreach(QGraphicsItem *item, tab->scene()->items()) {
+            if(item->type() == ChartImage::Type)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+void ExportUi::renderPageText(QPainter *p, const ExportBand &page, int *headerSize, int *footerSize)
+{
+    p->fillRect(0, 0, page.size.width(), page.size.height(), QColor(Qt::white));
+
+    *headerSize = 0;
+    *footerSize = 0;
+    if(page.headerFooter) {
+        *headerSize = renderHeader(*p, page.header, QRect(QPoint(0, 0), page.size));
+        *footerSize = renderFooter(*p, page.footer, QRect(QPoint(0, 0), page.size));
+    }
+}
+
+QImage ExportUi::renderBand(const ExportBand &band)
+{
+    QImage img(band.size.width(), band.rows, QImage::Format_ARGB32);
+    img.setDotsPerMeterX(band.dotsPerMeter);
+    img.setDotsPerMeterY(band.dotsPerMeter);
+
+    //QPicture::play() reads from the picture's own buffer, every band needs its own copy.
+    QPicture picture;
+    picture.setData(band.picture.constData(), band.picture.size());
+
+    QPainter p;
+    p.begin(&img);
+    p.translate(0, -band.top);
+    p.setClipRect(QRect(0, band.top, band.size.width(), band.rows));
+
+    int headerSize, footerSize;
+    renderPageText(&p, band, &headerSize, &footerSize);
+    p.drawPicture(0, 0, picture);
+    p.end();
+
+    return img;
+}
+
+QList<QImage> ExportUi::renderBands(const ExportBand &page, int top, int rows, int count)
+{
+    QList<ExportBand> bands;
+    for(int i = 0; i < count; ++i) {
+        ExportBand band = page;
+        band.top = top + i * rows;
+        band.rows = qMin(rows, page.size.height() - band.top);
+        if(band.rows <= 0)
+            break;
+        bands.append(band);
+    }
+
+    //QPixmaps and text without threaded font rendering can only be drawn on the GUI thread,
+    //those pages are drawn one band at a time.
+    if(bands.count() > 1 && !page.pixmaps && QFontDatabase::supportsThreadedFontRendering())
+        return QtConcurrent::blockingMapped<QList<QImage> >(bands, &ExportUi::renderBand);
+
+    QList<QImage> images;
+    foreach(const ExportBand &band, bands)
+        images.append(renderBand(band));
+    return images;
+}
+
+int ExportUi::bandRows(QSize size)
+{
+    return qBound(1, EXPORT_BAND_BYTES / (size.width() * 4), size.height());
+}
+
+bool ExportUi::exportTiled(QSize size)
+{
+    BandWriter *writer = BandWriter::create(exportType);
+    ExportBand page = recordPage(size);
+
+    bool ok = writer->begin(fileName, size, page.dotsPerMeter);
+
+    //draw as many bands at once as there are cores, and write them in order.
+    int rows = bandRows(size);
+    int threads = qMax(1, QThread::idealThreadCount());
+    for(int y = 0; ok && y < size.height(); y += rows * threads) {
+        foreach(const QImage &band, renderBands(page, y, rows, threads)) {
+            ok = writer->writeBand(band);
+            if(!ok)
+                break;
+        }
+    }
+
+    if(ok)
+        ok = writer->finish();
+
+    if(!ok) {
+        qWarning() << "Could not export" << fileName << writer->errorString();
+        QFile::remove(fileName);
+    }
 
-    img.save(fileName);
+    delete writer;
+    return ok;
 }
 
 void ExportUi::updateChartSizeRatio(QString selection)
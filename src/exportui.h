@@ -25,8 +25,30 @@
 #include <QTabWidget>
 #include <QGraphicsScene>
 #include <QMap>
+#include <QImage>
 #include "legends.h"
 
+/**
+ * Everything needed to draw one horizontal band of an exported image.
+ */
+struct ExportBand
+{
+    ExportBand()
+        : dotsPerMeter(0), top(0), rows(0), headerFooter(false), pixmaps(false) {}
+
+    //the recorded page content, see QPicture::data().
+    QByteArray picture;
+    QSize size;
+    int dotsPerMeter;
+    int top;
+    int rows;
+    bool headerFooter;
+    QString header;
+    QString footer;
+    //the picture draws QPixmaps, it can only be played on the GUI thread.
+    bool pixmaps;
+};
+
 namespace Ui {
     class ExportDialog;
 }
@@ -34,6 +56,7 @@ namespace Ui {
 class ExportUi : public QDialog
 {
     Q_OBJECT
+    friend class BatchExporter;
 public:
     ExportUi(QTabWidget* tabWidget, QMap<QString, int>* stitches,
              QMap<QString, QMap<QString, qint64> >* colors, QWidget* parent = 0);
@@ -50,6 +73,18 @@ public:
 	bool selectionOnly;
 	bool includeHeaderFooter;
     QGraphicsScene* scene;
+
+    /**
+     * Write the selection to fileName using the options above.
+     * Returns false if the file could not be written.
+     */
+    bool exportFile();
+
+    /**
+     * Draw the rows of @band, can be called from the thread pool when
+     * QFontDatabase::supportsThreadedFontRendering() is true.
+     */
+    static QImage renderBand(const ExportBand &band);
     
 public slots:
     int exec();
@@ -74,17 +109,48 @@ private:
     void setupStitchLegendOptions();
     void setupChartOptions();
     
-    void exportLegendPdf();
-    void exportLegendSvg();
-    void exportLegendImg();
+    bool exportLegendPdf();
+    bool exportLegendSvg();
+    bool exportLegendImg();
 
-    void exportPdf();
-    void exportSvg();
-    void exportImg();
+    bool exportPdf();
+    bool exportSvg();
+    bool exportImg();
     
-	//returns the height of the rendered text
-	int renderFooter(QPainter &painter, QString text);
-	int renderHeader(QPainter &painter, QString text);
+	//returns the height of the rendered text, @page defaults to the painter's window.
+	static int renderFooter(QPainter &painter, QString text, QRect page = QRect());
+	static int renderHeader(QPainter &painter, QString text, QRect page = QRect());
+
+    /**
+     * Save the selected chart or legend as a png, jpg, etc of @size.
+     */
+    bool exportImage(QSize size);
+    /**
+     * Draw the selected chart or legend, without the background and header/footer.
+     */
+    void renderPageContent(QPainter *p, QSize size, int headerSize, int footerSize);
+    /**
+     * Record the page content into a QPicture so it can be drawn off the GUI thread.
+     */
+    ExportBand recordPage(QSize size);
+    /**
+     * Returns true if the selected chart or legend draws QPixmaps: chart images and stitches that aren't svg.
+     */
+    bool pageHasPixmaps();
+    /**
+     * Draw the background and header/footer, they're drawn straight into each
+     * band so the text matches the image resolution.
+     */
+    static void renderPageText(QPainter *p, const ExportBand &page, int *headerSize, int *footerSize);
+    /**
+     * Draw up to @count bands of @rows starting at @top, on the thread pool when possible.
+     */
+    QList<QImage> renderBands(const ExportBand &page, int top, int rows, int count);
+    static int bandRows(QSize size);
+    /**
+     * Draw the image in bands and stream them to the file, for formats BandWriter can write.
+     */
+    bool exportTiled(QSize size);
 	
     void updateChartSizeRatio(QString selection);
     qreal sceneRatio(QRectF rect);
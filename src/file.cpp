@@ -20,11 +20,31 @@
  \****************************************************************************/
 #include "file.h"
 
+#include <QDataStream>
+
 File::File(MainWindow *mw, FileFactory *parent) :
     mMainWindow(mw),
     mParent(parent),
-    mInternalStitchSet(0)
+    mInternalStitchSet(0),
+    mSnapshotError(FileFactory::No_Error)
 {
     mTabWidget = mMainWindow->tabWidget();
 
 }
+
+void File::snapshot()
+{
+    QDataStream out(&mSnapshot, QIODevice::WriteOnly);
+    mSnapshotError = save(&out);
+}
+
+FileFactory::FileError File::writeSnapshot(QDataStream *stream)
+{
+    if(mSnapshotError != FileFactory::No_Error)
+        return mSnapshotError;
+
+    if(stream->writeRawData(mSnapshot.constData(), mSnapshot.size()) != mSnapshot.size())
+        return FileFactory::Err_SavingFile;
+
+    return FileFactory::No_Error;
+}
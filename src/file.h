@@ -30,15 +30,31 @@ class File
 {
 public:
     File(MainWindow *mw, FileFactory *parent);
+    virtual ~File() {}
 
     virtual FileFactory::FileError load(QDataStream *stream) = 0;
     virtual FileFactory::FileError save(QDataStream *stream) = 0;
 
+    /**
+     * Copy everything that will be saved, called on the GUI thread.
+     *
+     * Formats that can't save from a copy write the whole file here.
+     */
+    virtual void snapshot();
+    /**
+     * Write the copy made by snapshot(), this can run on a worker thread.
+     */
+    virtual FileFactory::FileError writeSnapshot(QDataStream *stream);
+
 protected:
     MainWindow *mMainWindow;
     FileFactory *mParent;
     QTabWidget *mTabWidget;
     StitchSet *mInternalStitchSet;
+
+private:
+    QByteArray mSnapshot;
+    FileFactory::FileError mSnapshotError;
 };
 
 #endif // FILE_H
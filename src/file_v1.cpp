@@ -54,10 +54,8 @@ FileFactory::FileError File_v1::load(QDataStream *stream)
     mInternalStitchSet = new StitchSet();
     mInternalStitchSet->isTemporary = true;
     mInternalStitchSet->stitchSetFileName = StitchLibrary::inst()->nextSetSaveFile();
-    QString dest = mInternalStitchSet->stitchSetFileName;
-    QFileInfo info(dest);
-    QDir(info.path()).mkpath(info.path() + "/" + info.baseName());
 
+    //the icons are kept in the IconStore, not in the set's folder.
     mInternalStitchSet->loadIcons(stream);
 
     QByteArray docData;
@@ -364,7 +362,7 @@ void File_v1::loadCell(CrochetTab *tab, QXmlStreamReader *stream)
             QString colorName = Settings::inst()->value("stitchAlternateColor").toString();
             c->setColor(QColor(colorName));
         }
-        tab->scene()->grid[row].replace(column, c);
+        tab->scene()->setGridCell(row, column, c);
         c->setZValue(100);
     } else {
         c->setStitch(s);
@@ -24,6 +24,7 @@
 
 #include "appinfo.h"
 
+#include <QFile>
 #include <QFileInfo>
 #include <QTextDocument>
 #include <QDir>
@@ -36,77 +37,442 @@
 #include <QStack>
 
 #include "crochettab.h"
+#include "journal.h"
+#include "file_v3.h"
+#include "iconstore.h"
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QProgressDialog>
+#include <QScopedPointer>
+#include <QtConcurrentRun>
+
+//how long the items are created for before the event loop gets to run, in ms.
+#define FILE_V2_LOAD_SLICE 40
 
 File_v2::File_v2(MainWindow *mw, FileFactory *parent)
-    : File(mw, parent)
+    : File(mw, parent),
+      mCompactCells(false)
 {
 
 }
 
 FileFactory::FileError File_v2::load(QDataStream *stream)
 {
+    mCompactCells = Settings::inst()->value("compactCellStorage").toBool();
+
     mInternalStitchSet = new StitchSet();
     mInternalStitchSet->isTemporary = true;
     mInternalStitchSet->stitchSetFileName = StitchLibrary::inst()->nextSetSaveFile();
-    QString dest = mInternalStitchSet->stitchSetFileName;
-
-    QFileInfo info(dest);
-    QDir(info.path()).mkpath(info.path() + "/" + info.baseName());
 
+    //the icons are kept in the IconStore, not in the set's folder.
     mInternalStitchSet->loadIcons(stream);
 
-    QByteArray docData;
-    *stream >> docData;
+    QByteArray header, charts;
+    readDocument(stream, &header, &charts);
 
-    QXmlStreamReader xmlStream(docData);
+    mCharts.clear();
+    mStitches.clear();
 
-    if(xmlStream.hasError()) {
-        qWarning() << "Error loading saved file: " << xmlStream.errorString();
-        return FileFactory::Err_GettingFileContents;
+    //the event loop runs while the file loads, the dialog is shown right away so it
+    //blocks the window before the user can edit or close the half loaded document.
+    QScopedPointer<QProgressDialog> progress;
+    if(!mMainWindow->isHeadless()) {
+        progress.reset(new QProgressDialog(QObject::tr("Loading charts..."), QObject::tr("Cancel"), 0, 0, mMainWindow));
+        progress->setWindowModality(Qt::ApplicationModal);
+        progress->setMinimumDuration(0);
+        progress->show();
     }
 
-    while (!xmlStream.atEnd() && !xmlStream.hasError()) {
+    //parse the charts on a worker thread while the stitches and colors are loaded here.
+    QFutureWatcher<bool> watcher;
+    QEventLoop loop;
+    QObject::connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    if(progress)
+        QObject::connect(progress.data(), SIGNAL(canceled()), &loop, SLOT(quit()));
+    watcher.setFuture(QtConcurrent::run(this, &File_v2::parseCharts, charts));
+
+    loadHeader(header);
+
+    if(!progress)
+        watcher.waitForFinished();
+    else if(!watcher.isFinished())
+        loop.exec();
+
+    if(progress && progress->wasCanceled()) {
+        mParser.cancel();
+        watcher.waitForFinished();
+        cancelLoad(QList<CrochetTab*>());
+        return FileFactory::Err_LoadCancelled;
+    }
 
-        xmlStream.readNext();
-        if (xmlStream.isStartElement()) {
-            QString name = xmlStream.name().toString();
+    //create the items in short slices so the window keeps responding.
+    int total = 0;
+    foreach(const ChartData &chart, mCharts)
+        total += chart.itemCount();
 
-            if(name == "colors") {
-                loadColors(&xmlStream);
+    if(progress) {
+        progress->setRange(0, total);
+        progress->setValue(0);
+    }
 
-            } else if(name == "chart") {
-                loadChart(&xmlStream);
+    QList<CrochetTab*> tabs;
+    bool cancelled = false;
+    int done = 0;
+    mSliceTimer.start();
 
-            } else if(name == "stitch_set") {
-                mInternalStitchSet->loadXmlStitchSet(&xmlStream, true);
-                StitchLibrary::inst()->addStitchSet(mInternalStitchSet);
-            }
+    for(int c = 0; c < mCharts.count() && !cancelled; ++c) {
+        const ChartData &chart = mCharts.at(c);
+        CrochetTab *tab = createChart(chart);
+        tabs.append(tab);
+
+        if(deferChart(tab, c)) {
+            finishChart(tab, chart);
+            continue;
+        }
+
+        //don't update the scene index for every item, it's rebuilt once at the end.
+        QGraphicsScene::ItemIndexMethod indexMethod = tab->scene()->itemIndexMethod();
+        tab->scene()->setItemIndexMethod(QGraphicsScene::NoIndex);
+
+        for(int i = 0; i < chart.cells.count() && !cancelled; ++i) {
+            loadCell(tab, chart.cells.at(i));
+            cancelled = !nextSlice(progress.data(), ++done);
+        }
+
+        for(int i = 0; i < chart.images.count() && !cancelled; ++i) {
+            loadChartImage(tab, chart.images.at(i));
+            cancelled = !nextSlice(progress.data(), ++done);
+        }
+
+        for(int i = 0; i < chart.indicators.count() && !cancelled; ++i) {
+            loadIndicator(tab, chart.indicators.at(i));
+            cancelled = !nextSlice(progress.data(), ++done);
         }
+
+        tab->scene()->setItemIndexMethod(indexMethod);
+        if(!cancelled)
+            finishChart(tab, chart);
+    }
+
+    if(cancelled) {
+        cancelLoad(tabs);
+        return FileFactory::Err_LoadCancelled;
     }
 
+    mCharts.clear();
+    mStitches.clear();
+
     return FileFactory::No_Error;
 }
 
 FileFactory::FileError File_v2::save(QDataStream *stream)
 {
+    snapshot();
+    return writeSnapshot(stream);
+}
 
-    *stream << (qint32)FileFactory::Version_1_2;
-    stream->setVersion(QDataStream::Qt_4_7);
+void File_v2::snapshot()
+{
+    //the set only collects the stitches to write, it isn't added to the library
+    //so every save and checkpoint doesn't leave another set behind.
+    bool ownsSet = !mInternalStitchSet;
+    if(ownsSet)
+        mInternalStitchSet = new StitchSet();
+    else
+        mInternalStitchSet->clearStitches();
 
-    if(!mInternalStitchSet) {
+    mPattern = PatternData();
+
+    //create the StitchSet then copy the stitches.
+    collectCustomStitches();
+
+    mPattern.stitchSetName = mInternalStitchSet->name();
+    mPattern.author = mInternalStitchSet->author();
+    mPattern.email = mInternalStitchSet->email();
+    mPattern.org = mInternalStitchSet->org();
+    mPattern.url = mInternalStitchSet->url();
+
+    foreach(Stitch *s, mInternalStitchSet->stitches()) {
+        StitchData st;
+        st.name = s->name();
+        st.description = s->description();
+        st.category = s->category();
+        st.wrongSide = s->wrongSide();
+
+        if(!s->file().startsWith(":/")) {
+            st.icon = QFileInfo(s->file()).fileName();
+            mPattern.iconFiles.insert(st.icon, s->file());
+        } else {
+            st.icon = s->file();
+        }
 
-        mInternalStitchSet = new StitchSet();
-        mInternalStitchSet->isTemporary = true;
-        mInternalStitchSet->stitchSetFileName = StitchLibrary::inst()->nextSetSaveFile();
-        StitchLibrary::inst()->addStitchSet(mInternalStitchSet);
+        mPattern.stitches.append(st);
+    }
 
-    } else {
-        mInternalStitchSet->clearStitches();
+    if(ownsSet) {
+        delete mInternalStitchSet;
+        mInternalStitchSet = 0;
     }
 
-    //start xml save...
-    QString *data = new QString();
-    QXmlStreamWriter xmlStream(data);
+    QMap<QString, QMap<QString, qint64> > colors = mMainWindow->patternColors();
+    foreach(QString key, colors.keys())
+        mPattern.colors.insert(key, colors.value(key).value("added"));
+
+    for(int i = 0; i < mTabWidget->count(); ++i) {
+        if(qobject_cast<CrochetTab*>(mTabWidget->widget(i)))
+            mPattern.charts.append(chartData(i));
+    }
+}
+
+ChartData File_v2::chartHeader(CrochetTab *tab)
+{
+    Scene *scene = tab->scene();
+    ChartData chart;
+
+    chart.style = tab->mChartStyle;
+    chart.hasDefaultSt = true;
+    chart.defaultSt = scene->mDefaultStitch;
+
+    chart.hasSize = true;
+    chart.size = scene->sceneRect();
+
+    if(scene->showChartCenter()) {
+        chart.hasCenter = true;
+        chart.center = scene->mCenterSymbol->scenePos();
+    }
+
+    Guidelines guidelines = scene->guidelines();
+    if(guidelines.type() != "None") {
+        chart.hasGuidelines = true;
+        chart.guidelineType = guidelines.type();
+        chart.guidelineRows = guidelines.rows();
+        chart.guidelineColumns = guidelines.columns();
+        chart.guidelineCellWidth = guidelines.cellWidth();
+        chart.guidelineCellHeight = guidelines.cellHeight();
+    }
+
+    chart.hasRowSpacing = true;
+    chart.rowSpacing = scene->mDefaultSize;
+
+    if(scene->rowCount() >= 1 && scene->maxColumnCount() >= 1) {
+        for(int i = 0; i < scene->rowCount(); ++i)
+            chart.gridRows.append(scene->columnCount(i));
+    }
+
+    foreach(ChartLayer* l, scene->layers()) {
+        LayerData layer;
+        layer.name = l->name();
+        layer.uid = l->uid();
+        layer.visible = l->visible();
+        chart.layers.append(layer);
+    }
+
+    chart.groupCount = scene->mGroups.count();
+
+    return chart;
+}
+
+ChartData File_v2::chartData(int index)
+{
+    CrochetTab *tab = qobject_cast<CrochetTab*>(mTabWidget->widget(index));
+    Scene *scene = tab->scene();
+
+    ChartData chart = chartHeader(tab);
+    chart.name = mTabWidget->tabText(index);
+
+    //the items of a chart that wasn't shown yet are still in the file it was opened from,
+    //they're only read when they have to be written in another format.
+    if(tab->hasPendingChart()) {
+        chart.sections = tab->pendingChart().sections;
+        chart.sectionStitches = tab->pendingChart().stitches;
+        chart.sectionColors = tab->pendingChart().colors;
+        return chart;
+    }
+
+    //first, block al qt signals for performance
+    scene->blockSignals(true);
+
+    foreach(QGraphicsItem *item, scene->items()) {
+
+        Cell *c = qgraphicsitem_cast<Cell*>(item);
+        if(!c)
+            continue;
+
+        CellData cell;
+        cell.id = Journal::itemId(c);
+        cell.stitch = c->stitch()->name();
+        cell.layer = c->layer();
+
+        //if the stitch is on the grid save the grid position.
+        QPoint pt = scene->indexOf(c);
+        if(pt != QPoint(-1, -1)) {
+            cell.row = pt.y();
+            cell.column = pt.x();
+        }
+
+        bool isGrouped = c->parentItem() ? true : false;
+        ItemGroup *g = 0;
+        QList<QGraphicsItem*> ungroupstack;
+
+        if(isGrouped) {
+            g = qgraphicsitem_cast<ItemGroup*>(c->parentItem());
+            cell.group = scene->mGroups.indexOf(g);
+
+            //ungroup this and all possible childs
+            ungroupstack.append(c);
+            while (ungroupstack.last()->parentItem()
+                && ungroupstack.last()->parentItem()->type() == ItemGroup::Type) {
+                ungroupstack.append(ungroupstack.last()->parentItem());
+            }
+
+            //ungroup the items so that we can
+            //take an acurate position of each stitch.
+            for (int i = ungroupstack.count() - 1 ; i >= 2 ; i--) {
+                ItemGroup* ig = qgraphicsitem_cast<ItemGroup*>(ungroupstack[i]);
+                scene->ungroup(ig);
+            }
+
+            g->removeFromGroup(c);
+            ChartItemTools::recalculateTransformations(c);
+        }
+
+        cell.position = c->pos();
+        cell.scaleX = ChartItemTools::getScaleX(c);
+        cell.scaleY = ChartItemTools::getScaleY(c);
+        cell.pivotScale = ChartItemTools::getScalePivot(c);
+        cell.rotation = ChartItemTools::getRotation(c);
+        cell.pivotRotation = ChartItemTools::getRotationPivot(c);
+
+        //in case we haven't closed the
+        //application we need to regroup the items.
+        if(isGrouped)
+            g->addToGroup(c);
+
+        cell.color = c->color().name();
+        cell.bgColor = c->bgColor().name();
+        cell.pivotPoint = c->transformOriginPoint();
+
+        chart.cells.append(cell);
+    }
+
+    //the stored cells are saved with their full transformation.
+    CellStore *store = scene->cellStore();
+    for(int i = 0; i < store->count(); ++i) {
+        //the journal removes a stored cell by its id when it becomes a Cell.
+        if(!store->id(i))
+            store->setId(i, Journal::newItemId());
+
+        CellData cell;
+        cell.id = store->id(i);
+        cell.stitch = store->stitch(i)->name();
+        cell.layer = store->layer(i);
+        cell.position = store->pos(i);
+        cell.transform = store->transform(i);
+        cell.color = store->color(i).name();
+        cell.bgColor = store->bgColor(i).name();
+        cell.row = store->row(i);
+        cell.column = store->column(i);
+        if(store->group(i))
+            cell.group = scene->mGroups.indexOf(store->group(i));
+        chart.cells.append(cell);
+    }
+
+    foreach(QGraphicsItem *item, scene->items()) {
+        ChartImage* c = qgraphicsitem_cast<ChartImage*>(item);
+        if (!c)
+            continue;
+
+        ChartImageData image;
+        image.id = Journal::itemId(c);
+        image.layer = c->layer();
+        image.filename = c->filename();
+
+        bool isGrouped = c->parentItem() ? true : false;
+        ItemGroup *g = 0;
+        if(isGrouped) {
+            g = qgraphicsitem_cast<ItemGroup*>(c->parentItem());
+            image.group = scene->mGroups.indexOf(g);
+
+            //ungroup the items so that we can
+            //take an acurate position of each stitch.
+            g->removeFromGroup(c);
+        }
+
+        image.position = c->pos();
+        image.scaleX = ChartItemTools::getScaleX(c);
+        image.scaleY = ChartItemTools::getScaleY(c);
+        image.pivotScale = ChartItemTools::getScalePivot(c);
+        image.rotation = ChartItemTools::getRotation(c);
+        image.pivotRotation = ChartItemTools::getRotationPivot(c);
+
+        //in case we haven't closed the
+        //application we need to regroup the items.
+        if(isGrouped)
+            g->addToGroup(c);
+
+        image.pivotPoint = c->transformOriginPoint();
+        chart.images.append(image);
+    }
+
+    foreach(Indicator *i, scene->indicators()) {
+        IndicatorData indicator;
+        indicator.id = Journal::itemId(i);
+        indicator.position = i->scenePos();
+        indicator.text = i->text();
+        indicator.textColor = i->textColor().name();
+        indicator.bgColor = i->bgColor().name();
+        indicator.style = i->style();
+        indicator.fontName = i->font().toString();
+        indicator.fontSize = i->font().pointSize();
+        indicator.fontUsed = true;
+        indicator.layer = i->layer();
+
+        bool isGrouped = i->parentItem() ? true : false;
+        ItemGroup *g = 0;
+        if(isGrouped) {
+            g = qgraphicsitem_cast<ItemGroup*>(i->parentItem());
+            indicator.group = scene->mGroups.indexOf(g);
+
+            //ungroup the items so that we can
+            //take an acurate position of each stitch.
+            g->removeFromGroup(i);
+        }
+
+        indicator.scaleX = ChartItemTools::getScaleX(i);
+        indicator.scaleY = ChartItemTools::getScaleY(i);
+        indicator.pivotScale = ChartItemTools::getScalePivot(i);
+        indicator.rotation = ChartItemTools::getRotation(i);
+        indicator.pivotRotation = ChartItemTools::getRotationPivot(i);
+
+        //in case we haven't closed the
+        //application we need to regroup the items.
+        if(isGrouped)
+            g->addToGroup(i);
+
+        chart.indicators.append(indicator);
+    }
+
+    //and resume signals
+    scene->blockSignals(false);
+
+    return chart;
+}
+
+FileFactory::FileError File_v2::writeSnapshot(QDataStream *stream)
+{
+    *stream << (qint32)FileFactory::Version_1_2;
+    stream->setVersion(QDataStream::Qt_4_7);
+
+    writeIcons(stream, mPattern);
+
+    //the xml is written straight into the file as one QByteArray.
+    qint64 start = beginSection(stream);
+    if(start < 0)
+        return FileFactory::Err_SavingFile;
+
+    QXmlStreamWriter xmlStream(stream->device());
     xmlStream.setAutoFormatting(true);
     xmlStream.writeStartDocument();
 
@@ -114,26 +480,48 @@ FileFactory::FileError File_v2::save(QDataStream *stream)
     //TODO: dont need to set the version when saving into a binary file.
     xmlStream.writeAttribute("version", QString::number(FileFactory::Version_1_2));
 
-    //create the StitchSet then save the icons.
-    saveCustomStitches(&xmlStream);
-    mInternalStitchSet->saveIcons(stream);
-
-    saveColors(&xmlStream);
+    writeStitchSet(&xmlStream, mPattern);
+    writeColors(&xmlStream, mPattern);
 
-    saveCharts(&xmlStream);
+    foreach(ChartData chart, mPattern.charts) {
+        if(!chart.sections.isEmpty() && !File_v3::pendingItems(&chart))
+            WARN("the items of chart " + chart.name + " could not be read from the original file");
+        writeChart(&xmlStream, chart);
+    }
     xmlStream.writeEndElement();
 
     xmlStream.writeEndDocument();
 
-    //put xml into binary file.
-    *stream << data->toUtf8();
+    if(xmlStream.hasError() || !endSection(stream, start))
+        return FileFactory::Err_SavingFile;
 
-    delete data;
-    data = 0;
-	
 	return FileFactory::No_Error;
 }
 
+qint64 File_v2::beginSection(QDataStream *stream)
+{
+    QIODevice *device = stream->device();
+    if(!device || device->isSequential())
+        return -1;
+
+    qint64 start = device->pos();
+    *stream << (quint32)0;
+
+    return start;
+}
+
+bool File_v2::endSection(QDataStream *stream, qint64 start)
+{
+    QIODevice *device = stream->device();
+    qint64 end = device->pos();
+
+    if(!device->seek(start))
+        return false;
+    *stream << (quint32)(end - start - sizeof(quint32));
+
+    return device->seek(end) && stream->status() == QDataStream::Ok;
+}
+
 void File_v2::loadColors(QXmlStreamReader *stream)
 {
 
@@ -155,110 +543,170 @@ void File_v2::loadColors(QXmlStreamReader *stream)
 
 }
 
-void File_v2::loadChart(QXmlStreamReader *stream)
+void File_v2::loadHeader(const QByteArray &data)
+{
+    QXmlStreamReader xmlStream(data);
+
+    while (!xmlStream.atEnd() && !xmlStream.hasError()) {
+
+        xmlStream.readNext();
+        if (xmlStream.isStartElement()) {
+            QString name = xmlStream.name().toString();
+
+            if(name == "colors") {
+                loadColors(&xmlStream);
+
+            } else if(name == "stitch_set") {
+                mInternalStitchSet->loadXmlStitchSet(&xmlStream, true);
+                StitchLibrary::inst()->addStitchSet(mInternalStitchSet);
+
+            } else if(name == "chart") {
+                //save() writes the stitches and colors before the charts,
+                //the charts are read by parseCharts().
+                break;
+            }
+        }
+    }
+
+    if(xmlStream.hasError())
+        qWarning() << "Error loading saved file: " << xmlStream.errorString();
+}
+
+bool File_v2::nextSlice(QProgressDialog *progress, int done)
+{
+    //without a dialog nothing can cancel the load or needs to be redrawn.
+    if(!progress || mSliceTimer.elapsed() < FILE_V2_LOAD_SLICE)
+        return true;
+
+    progress->setValue(done);
+    QCoreApplication::processEvents();
+    mSliceTimer.restart();
+
+    return !progress->wasCanceled();
+}
+
+void File_v2::cancelLoad(QList<CrochetTab*> tabs)
+{
+    foreach(CrochetTab *tab, tabs) {
+        mParent->mTabWidget->removeTab(mParent->mTabWidget->indexOf(tab));
+        delete tab;
+    }
+
+    mCharts.clear();
+    mStitches.clear();
+
+    mMainWindow->mPatternColors.clear();
+    mMainWindow->mPatternStitches.clear();
+
+    cleanUp();
+}
+
+Stitch* File_v2::findStitch(const QString &name)
+{
+    QHash<QString, Stitch*>::const_iterator it = mStitches.constFind(name);
+    if(it != mStitches.constEnd())
+        return it.value();
+
+    Stitch *s = StitchLibrary::inst()->findStitch(name, true);
+    mStitches.insert(name, s);
+    return s;
+}
+
+void File_v2::readDocument(QDataStream *stream, QByteArray *header, QByteArray *charts)
+{
+    QByteArray docData;
+    *stream >> docData;
+
+    //the stitches, colors and charts are all in one xml document.
+    *header = docData;
+    *charts = docData;
+}
+
+bool File_v2::parseCharts(QByteArray data)
+{
+    bool ok = mParser.parse(data, &mCharts);
+    if(!ok)
+        qWarning() << "Error loading saved file: " << mParser.errorString();
+    return ok;
+}
+
+bool File_v2::deferChart(CrochetTab *tab, int index)
+{
+    Q_UNUSED(tab);
+    Q_UNUSED(index);
+    return false;
+}
+
+CrochetTab* File_v2::createChart(const ChartData &chart)
 {
     MainWindow *mw = mMainWindow;
-    CrochetTab *tab = 0;
-    QString tabName = "", defaultSt = "";
 
-    while(!(stream->isEndElement() && stream->name() == "chart")) {
-        stream->readNext();
-        QString tag = stream->name().toString();
+    Scene::ChartStyle style = (chart.style < 0) ? Scene::Blank : (Scene::ChartStyle)chart.style;
+    CrochetTab *tab = mw->createTab(style);
 
-        if(tag == "name") {
-            tabName = stream->readElementText();
+    mParent->mTabWidget->addTab(tab, "");
+    mParent->mTabWidget->widget(mParent->mTabWidget->indexOf(tab))->hide();
 
-        } else if(tag == "style") {
-            int style = stream->readElementText().toInt();
-            tab = mw->createTab((Scene::ChartStyle)style);
+    Scene *scene = tab->scene();
 
-            mParent->mTabWidget->addTab(tab, "");
-            mParent->mTabWidget->widget(mParent->mTabWidget->indexOf(tab))->hide();
-        } else if(tag == "defaultSt") {
-            defaultSt = stream->readElementText();
-            tab->scene()->mDefaultStitch = defaultSt;
+    if(chart.hasDefaultSt)
+        scene->mDefaultStitch = chart.defaultSt;
 
-        } else if(tag == "chartCenter") {
-            qreal x = stream->attributes().value("x").toString().toDouble();
-            qreal y = stream->attributes().value("y").toString().toDouble();
+    if(chart.hasSize)
+        scene->setSceneRect(chart.size);
 
-            stream->readElementText();
-            tab->blockSignals(true);
-            tab->setShowChartCenter(true);
-            tab->scene()->mCenterSymbol->setPos(x, y);
-            tab->blockSignals(false);
+    if(chart.hasCenter) {
+        tab->blockSignals(true);
+        tab->setShowChartCenter(true);
+        scene->mCenterSymbol->setPos(chart.center);
+        tab->blockSignals(false);
+    }
 
-        } else if(tag == "grid") {
-            loadGrid(stream, tab->scene());
+    if(chart.hasGuidelines) {
+        scene->mGuidelines.setType(chart.guidelineType);
+        scene->mGuidelines.setColumns(chart.guidelineColumns);
+        scene->mGuidelines.setRows(chart.guidelineRows);
+        scene->mGuidelines.setCellWidth(chart.guidelineCellWidth);
+        scene->mGuidelines.setCellHeight(chart.guidelineCellHeight);
 
-        } else if(tag == "rowSpacing") {
-            qreal width = stream->attributes().value("width").toString().toDouble();
-            qreal height = stream->attributes().value("height").toString().toDouble();
-            tab->scene()->mDefaultSize.setHeight(height);
-            tab->scene()->mDefaultSize.setWidth(width);
+        scene->updateGuidelines();
+        emit tab->updateGuidelines(scene->guidelines());
+    }
 
-            stream->readElementText(); //move to the next tag.
-        } else if(tag == "cell") {
-            loadCell(tab, stream);
+    if(chart.hasRowSpacing)
+        scene->mDefaultSize = chart.rowSpacing;
 
-        } else if(tag == "indicator") {
-            loadIndicator(tab, stream);
-		
-        } else if(tag == "chartimage") {
-            loadChartImage(tab, stream);
-		
-        } else if(tag == "group") {
-            stream->readElementText().toInt();
-            //create an empty group for future use.
-            QList<QGraphicsItem*> items;
-            tab->scene()->group(items);
-
-        } else if(tag == "guidelines") {
-            QString type = stream->attributes().value("type").toString();
-            int rows = stream->attributes().value("rows").toString().toInt();
-            int columns = stream->attributes().value("columns").toString().toInt();
-            int cellHeight = stream->attributes().value("cellHeight").toString().toInt();
-            int cellWidth = stream->attributes().value("cellWidth").toString().toInt();
-
-            tab->scene()->mGuidelines.setType(type);
-            tab->scene()->mGuidelines.setColumns(columns);
-            tab->scene()->mGuidelines.setRows(rows);
-            tab->scene()->mGuidelines.setCellWidth(cellWidth);
-            tab->scene()->mGuidelines.setCellHeight(cellHeight);
-
-            stream->readElementText(); //move to the next tag
-            tab->scene()->updateGuidelines();
-            emit tab->updateGuidelines(tab->scene()->guidelines());
-
-        } else if (tag == "chartLayer") {
-			QString name = stream->attributes().value("name").toString();
-			unsigned int uid = stream->attributes().value("uid").toString().toUInt();
-			bool visible = stream->attributes().value("visible").toString().toInt();
-			tab->scene()->addLayer(name, uid);
-			tab->scene()->getLayer(uid)->setVisible(visible);
-			tab->scene()->selectLayer(uid);
-            stream->readElementText(); //move to the next tag.
-		} else if (tag == "size") {
-			qreal x = stream->attributes().value("x").toString().toDouble();
-			qreal y = stream->attributes().value("y").toString().toDouble();
-			qreal width = stream->attributes().value("width").toString().toDouble();
-			qreal height = stream->attributes().value("height").toString().toDouble();
-			
-			QRectF size = QRectF(x, y, width, height);
-			tab->scene()->setSceneRect(size);
-			
-			stream->readElementText();
-		} else {
-            qWarning() << "loadChart Unknown tag:" << tag;
+    foreach(int cols, chart.gridRows) {
+        QList<Cell*> row;
+        for(int i = 0; i < cols; ++i) {
+            row.append(0);
         }
+        scene->grid.append(row);
     }
-	
+
+    foreach(const LayerData &layer, chart.layers) {
+        scene->addLayer(layer.name, layer.uid);
+        scene->getLayer(layer.uid)->setVisible(layer.visible);
+        scene->selectLayer(layer.uid);
+    }
+
+    for(int i = 0; i < chart.groupCount; ++i) {
+        //create an empty group for future use.
+        QList<QGraphicsItem*> items;
+        scene->group(items);
+    }
+
+    return tab;
+}
+
+void File_v2::finishChart(CrochetTab *tab, const ChartData &chart)
+{
 	//refresh the layers so the visibility and selectability of items is correct
 	tab->scene()->refreshLayers();
 		
     tab->updateRows();
     int index = mParent->mTabWidget->indexOf(tab);
-    mParent->mTabWidget->setTabText(index, tabName);
+    mParent->mTabWidget->setTabText(index, chart.name);
     mParent->mTabWidget->widget(mParent->mTabWidget->indexOf(tab))->show();
     tab->scene()->updateSceneRect();
     if(tab->scene()->hasChartCenter()) {
@@ -268,118 +716,34 @@ void File_v2::loadChart(QXmlStreamReader *stream)
     }
 }
 
-void File_v2::loadGrid(QXmlStreamReader *stream, Scene *scene)
-{
-    while(!(stream->isEndElement() && stream->name() == "grid")) {
-        stream->readNext();
-        QString tag = stream->name().toString();
-
-        if(tag == "row") {
-            int cols = stream->readElementText().toInt();
-            QList<Cell*> row;
-            for(int i = 0; i < cols; ++i) {
-                row.append(0);
-            }
-            scene->grid.append(row);
-        }
-    }
-}
-
-void File_v2::loadIndicator(CrochetTab *tab, QXmlStreamReader *stream)
+void File_v2::loadIndicator(CrochetTab *tab, const IndicatorData &data)
 {
     Indicator *i = new Indicator();
 
-    qreal x = 0, y = 0;
-	bool fontused = false;
-	int fontsize;
-    QString textColor, bgColor, fontname;
-    QString text, style;
-	QPointF pivotScale, pivotRotation;
-	QTransform transform;
-    qreal   m11 = 1, m12 = 0, m13 = 0,
-            m21 = 0, m22 = 1, m23 = 0,
-            m31 = 0, m32 = 0, m33 = 1;
-			
-	qreal rotation = 0, scaleX = 1, scaleY = 1;
-    int group = -1;
-	unsigned int layer = 0;
-    while(!(stream->isEndElement() && stream->name() == "indicator")) {
-        stream->readNext();
-        QString tag = stream->name().toString();
+	//the text might be html formatted in old saves, so we need to strip it. A regex could work,
+	//but is hard to make performant with inline css, and wouldn't work well with text that has
+	//brackets in it.
+	QTextDocument doc;
+	doc.setHtml(data.text);
+	QString text = doc.toPlainText();
 
-        if(tag == "x") {
-            x = stream->readElementText().toDouble();
-        } else if(tag == "y") {
-            y = stream->readElementText().toDouble();
-        } else if(tag == "text") {
-            text = stream->readElementText();
-			//the text might be html formatted in old saves, so we need to strip it. A regex could work,
-			//but is hard to make performant with inline css, and wouldn't work well with text that has
-			//brackets in it.
-			QTextDocument doc;
-			doc.setHtml( text );
-			text = doc.toPlainText();
-        } else if(tag == "textColor") {
-            textColor = stream->readElementText();
-        } else if(tag == "bgColor") {
-            bgColor = stream->readElementText();
-        } else if(tag == "style") {
-            style = stream->readElementText();
-        } else if(tag == "group") {
-            group = stream->readElementText().toInt();
-        } else if (tag == "fontname") {
-			fontname = stream->readElementText();
-			fontused = true;
-		} else if (tag == "fontsize") {
-			fontsize = stream->readElementText().toInt();
-			fontused = true;
-		} else if (tag == "layer") {
-			layer = stream->readElementText().toUInt();
-			
-		} else if (tag == "newscale") {
-			scaleX = stream->attributes().value("scaleX").toString().toDouble();
-			scaleY = stream->attributes().value("scaleY").toString().toDouble();
-			pivotScale.rx() = stream->attributes().value("pivotX").toString().toDouble();
-			pivotScale.ry() = stream->attributes().value("pivotY").toString().toDouble();
-			stream->readElementText();
-			
-		} else if (tag == "rotation") {
-			rotation = stream->attributes().value("rotation").toString().toDouble();
-			pivotRotation.rx() = stream->attributes().value("pivotX").toString().toDouble();
-			pivotRotation.ry() = stream->attributes().value("pivotY").toString().toDouble();
-			stream->readElementText();
-			
-		}  else if(tag == "transformation") {
-            m11 = stream->attributes().value("m11").toString().toDouble();
-            m12 = stream->attributes().value("m12").toString().toDouble();
-            m13 = stream->attributes().value("m13").toString().toDouble();
-            m21 = stream->attributes().value("m21").toString().toDouble();
-            m22 = stream->attributes().value("m22").toString().toDouble();
-            m23 = stream->attributes().value("m23").toString().toDouble();
-            m31 = stream->attributes().value("m31").toString().toDouble();
-            m32 = stream->attributes().value("m32").toString().toDouble();
-            m33 = stream->attributes().value("m33").toString().toDouble();
-            stream->readElementText();
-        } 
-    }
+    QString style = data.style;
 	DEBUG("Style is: ");
 	DEBUG(style);
-	transform.setMatrix(m11, m12, m13, m21, m22, m23, m31, m32, m33);
     tab->scene()->addItem(i);
-    i->setTransform(transform);
-	ChartItemTools::setRotation(i, rotation);
-	ChartItemTools::setScaleX(i, scaleX);
-	ChartItemTools::setScaleY(i, scaleY);
-	ChartItemTools::setRotationPivot(i, pivotRotation, false);
-	ChartItemTools::setScalePivot(i, pivotScale, false);
-    i->setPos(x,y);
+    i->setTransform(data.transform);
+	ChartItemTools::setRotation(i, data.rotation);
+	ChartItemTools::setScaleX(i, data.scaleX);
+	ChartItemTools::setScaleY(i, data.scaleY);
+	ChartItemTools::setRotationPivot(i, data.pivotRotation, false);
+	ChartItemTools::setScalePivot(i, data.pivotScale, false);
+    i->setPos(data.position);
 	i->setText(text);
-	qDebug() << "loading text " << text;
-    i->setTextColor(textColor);
-    i->setBgColor(bgColor);
-	i->setLayer(layer);
-	if (fontused)
-		i->setFont(QFont(fontname, fontsize));
+    i->setTextColor(data.textColor);
+    i->setBgColor(data.bgColor);
+	i->setLayer(data.layer);
+	if (data.fontUsed)
+		i->setFont(QFont(data.fontName, data.fontSize));
 	
 	ChartItemTools::recalculateTransformations(i);
 	
@@ -389,235 +753,102 @@ void File_v2::loadIndicator(CrochetTab *tab, QXmlStreamReader *stream)
         style = Settings::inst()->value("chartRowIndicator").toString();
     i->setStyle(style);
 
-    if(group != -1) {
-        tab->scene()->addToGroup(group, i);
-		tab->scene()->getGroup(group)->setLayer(layer);
+    if(data.group != -1) {
+        tab->scene()->addToGroup(data.group, i);
+		tab->scene()->getGroup(data.group)->setLayer(data.layer);
 	}
 }
 
-void File_v2::loadChartImage(CrochetTab* tab, QXmlStreamReader* stream)
+void File_v2::loadChartImage(CrochetTab* tab, const ChartImageData &data)
 {
-    int group = -1;
-    QPointF position(0.0,0.0);
-    QPointF pivotPoint;
-	QPointF pivotScale, pivotRotation;
-	qreal rotation = 0, scaleX = 1, scaleY = 1;
-	 QPointF scale = QPointF(1.0,1.0);
-	unsigned int layer = 0;
-    QTransform transform;
-	qreal angle = 0.0;
-    qreal   m11 = 1, m12 = 0, m13 = 0,
-            m21 = 0, m22 = 1, m23 = 0,
-            m31 = 0, m32 = 0, m33 = 1;
-	QString filename;
-
-    while(!(stream->isEndElement() && stream->name() == "chartimage")) {
-        stream->readNext();
-        QString tag = stream->name().toString();
-		
-		if(tag == "position") {
-            position.rx() = stream->attributes().value("x").toString().toDouble();
-            position.ry() = stream->attributes().value("y").toString().toDouble();
-            stream->readElementText();
-
-        } else if(tag == "angle") {
-            angle = stream->readElementText().toDouble();
-			
-		} else if(tag == "scale") {
-            scale.rx() = stream->attributes().value("x").toString().toDouble();
-            scale.ry() = stream->attributes().value("y").toString().toDouble();
-            stream->readElementText();
-			
-        } else if (tag == "newscale") {
-			scaleX = stream->attributes().value("scaleX").toString().toDouble();
-			scaleY = stream->attributes().value("scaleY").toString().toDouble();
-			pivotScale.rx() = stream->attributes().value("pivotX").toString().toDouble();
-			pivotScale.ry() = stream->attributes().value("pivotY").toString().toDouble();
-			stream->readElementText();
-			
-		} else if (tag == "rotation") {
-			rotation = stream->attributes().value("rotation").toString().toDouble();
-			pivotRotation.rx() = stream->attributes().value("pivotX").toString().toDouble();
-			pivotRotation.ry() = stream->attributes().value("pivotY").toString().toDouble();
-			stream->readElementText();
-			
-		} else if(tag == "pivotPoint") {
-            pivotPoint.rx() = stream->attributes().value("x").toString().toDouble();
-            pivotPoint.ry() = stream->attributes().value("y").toString().toDouble();
-            stream->readElementText();
-
-        } else if(tag == "group") {
-            group = stream->readElementText().toInt();
-
-        } else if (tag == "layer") {
-			layer = stream->readElementText().toUInt();
-		} else if (tag == "filename") {
-			filename = stream->readElementText();
-		}  else if(tag == "transformation") {
-            m11 = stream->attributes().value("m11").toString().toDouble();
-            m12 = stream->attributes().value("m12").toString().toDouble();
-            m13 = stream->attributes().value("m13").toString().toDouble();
-            m21 = stream->attributes().value("m21").toString().toDouble();
-            m22 = stream->attributes().value("m22").toString().toDouble();
-            m23 = stream->attributes().value("m23").toString().toDouble();
-            m31 = stream->attributes().value("m31").toString().toDouble();
-            m32 = stream->attributes().value("m32").toString().toDouble();
-            m33 = stream->attributes().value("m33").toString().toDouble();
-            stream->readElementText();
-		}
-    }
-    ChartImage *c = new ChartImage(filename);
+    ChartImage *c = new ChartImage(data.filename);
 	
-
     tab->scene()->addItem(c);
 
-	transform.setMatrix(m11, m12, m13, m21, m22, m23, m31, m32, m33);
-	c->setTransform(transform);
-	c->setLayer(layer);
+	c->setTransform(data.transform);
+	c->setLayer(data.layer);
     c->setZValue(10);
-	c->setPos(position);
-    c->setTransformOriginPoint(pivotPoint);
-    c->setRotation(angle);
+	c->setPos(data.position);
+    c->setTransformOriginPoint(data.pivotPoint);
+    c->setRotation(data.angle);
 	
-	ChartItemTools::setRotation(c, rotation);
-	ChartItemTools::setScaleX(c, scaleX);
-	ChartItemTools::setScaleY(c, scaleY);
-	ChartItemTools::setRotationPivot(c, pivotRotation, false);
-	ChartItemTools::setScalePivot(c, pivotScale, false);
+	ChartItemTools::setRotation(c, data.rotation);
+	ChartItemTools::setScaleX(c, data.scaleX);
+	ChartItemTools::setScaleY(c, data.scaleY);
+	ChartItemTools::setRotationPivot(c, data.pivotRotation, false);
+	ChartItemTools::setScalePivot(c, data.pivotScale, false);
 	ChartItemTools::recalculateTransformations(c);
-    if(group != -1) {
-        tab->scene()->addToGroup(group, c);
-		tab->scene()->getGroup(group)->setLayer(layer);
+    if(data.group != -1) {
+        tab->scene()->addToGroup(data.group, c);
+		tab->scene()->getGroup(data.group)->setLayer(data.layer);
 	}
 }
 
-void File_v2::loadCell(CrochetTab *tab, QXmlStreamReader *stream)
+void File_v2::loadCell(CrochetTab *tab, const CellData &data)
 {
-
-    Cell *c = new Cell();
     Stitch *s = 0;
-    int row = -1, column = -1;
-    int group = -1;
-    QString bgColor, color;
-    QPointF position(0.0,0.0);
-    QPointF pivotPoint;
-	unsigned int layer = 0;
-	QPointF pivotScale, pivotRotation;
-	qreal rotation = 0, scaleX = 1, scaleY = 1;
-	qreal angle = 0.0;
-    QPointF scale = QPointF(1.0,1.0);
-    QTransform transform;
-    qreal   m11 = 1, m12 = 0, m13 = 0,
-            m21 = 0, m22 = 1, m23 = 0,
-            m31 = 0, m32 = 0, m33 = 1;
-			
-    while(!(stream->isEndElement() && stream->name() == "cell")) {
-        stream->readNext();
-        QString tag = stream->name().toString();
-
-        if(tag == "stitch") {
-            QString st = stream->readElementText();
-            s = StitchLibrary::inst()->findStitch(st, true);
-
-        } else if(tag == "grid") {
-            row = stream->attributes().value("row").toString().toDouble();
-            column = stream->attributes().value("column").toString().toDouble();
-            stream->readElementText();
-
-        } else if(tag == "color") {
-            color = stream->readElementText();
-
-        } else if(tag == "bgColor") {
-            bgColor = stream->readElementText();
-
-        } else if(tag == "position") {
-            position.rx() = stream->attributes().value("x").toString().toDouble();
-            position.ry() = stream->attributes().value("y").toString().toDouble();
-            stream->readElementText();
-
-		} else if(tag == "angle") {
-            angle = stream->readElementText().toDouble();
-
-        } else if(tag == "scale") {
-            scale.rx() = stream->attributes().value("x").toString().toDouble();
-            scale.ry() = stream->attributes().value("y").toString().toDouble();
-            stream->readElementText();
-
-
-        } else if(tag == "pivotPoint") {
-            pivotPoint.rx() = stream->attributes().value("x").toString().toDouble();
-            pivotPoint.ry() = stream->attributes().value("y").toString().toDouble();
-            stream->readElementText();
-
-        } else if(tag == "group") {
-            group = stream->readElementText().toInt();
-
-        } else if (tag == "layer") {
-			layer = stream->readElementText().toUInt();
-			
-		} else if(tag == "group") {
-            group = stream->readElementText().toInt();
-
-        } else if (tag == "newscale") {
-			scaleX = stream->attributes().value("scaleX").toString().toDouble();
-			scaleY = stream->attributes().value("scaleY").toString().toDouble();
-			pivotScale.rx() = stream->attributes().value("pivotX").toString().toDouble();
-			pivotScale.ry() = stream->attributes().value("pivotY").toString().toDouble();
-			stream->readElementText();
-			
-		} else if (tag == "rotation") {
-			rotation = stream->attributes().value("rotation").toString().toDouble();
-			pivotRotation.rx() = stream->attributes().value("pivotX").toString().toDouble();
-			pivotRotation.ry() = stream->attributes().value("pivotY").toString().toDouble();
-			stream->readElementText();
-		} else if(tag == "transformation") {
-            m11 = stream->attributes().value("m11").toString().toDouble();
-            m12 = stream->attributes().value("m12").toString().toDouble();
-            m13 = stream->attributes().value("m13").toString().toDouble();
-            m21 = stream->attributes().value("m21").toString().toDouble();
-            m22 = stream->attributes().value("m22").toString().toDouble();
-            m23 = stream->attributes().value("m23").toString().toDouble();
-            m31 = stream->attributes().value("m31").toString().toDouble();
-            m32 = stream->attributes().value("m32").toString().toDouble();
-            m33 = stream->attributes().value("m33").toString().toDouble();
-            stream->readElementText();
-        } 
+    if(!data.stitch.isEmpty())
+        s = findStitch(data.stitch);
+
+    //the grid and group of a stored stitch are restored when it becomes a Cell.
+    if(mCompactCells && s) {
+        CellRecord r;
+        r.stitch = s;
+        if(!data.color.isEmpty())
+            r.color = QColor(data.color);
+        if(!data.bgColor.isEmpty())
+            r.bgColor = QColor(data.bgColor);
+        r.layer = data.layer;
+        r.pos = data.position;
+        r.transform = CellStore::itemTransform(data.transform, data.angle, data.pivotPoint,
+                                               data.rotation, data.pivotRotation,
+                                               data.scaleX, data.scaleY, data.pivotScale);
+        if(data.row > -1 && data.column > -1) {
+            r.row = data.row;
+            r.column = data.column;
+        }
+        if(data.group != -1) {
+            r.group = tab->scene()->getGroup(data.group);
+            r.group->setLayer(data.layer);
+        }
+        tab->scene()->addCellRecord(r);
+        return;
     }
-	
-	transform.setMatrix(m11, m12, m13, m21, m22, m23, m31, m32, m33);
-	c->setLayer(layer);
+
+    Cell *c = new Cell();
+	c->setLayer(data.layer);
 
     tab->scene()->addItem(c);
 
-    if(row > -1 && column > -1) {
+    if(data.row > -1 && data.column > -1) {
         c->setStitch(s);
-        tab->scene()->grid[row].replace(column, c);
+        tab->scene()->setGridCell(data.row, data.column, c);
         c->setZValue(100);
     } else {
         c->setStitch(s);
         c->setZValue(10);
     }
 
-    c->setTransform(transform);
-    c->setRotation(angle);
-    c->setPos(position);
-    c->setBgColor(QColor(bgColor));
-    c->setColor(QColor(color));
-    c->setTransformOriginPoint(pivotPoint);
+    c->setTransform(data.transform);
+    c->setRotation(data.angle);
+    c->setPos(data.position);
+    c->setBgColor(QColor(data.bgColor));
+    c->setColor(QColor(data.color));
+    c->setTransformOriginPoint(data.pivotPoint);
 	
-	ChartItemTools::setRotation(c, rotation);
-	ChartItemTools::setScaleX(c, scaleX);
-	ChartItemTools::setScaleY(c, scaleY);
-	ChartItemTools::setRotationPivot(c, pivotRotation, false);
-	ChartItemTools::setScalePivot(c, pivotScale, false);
+	ChartItemTools::setRotation(c, data.rotation);
+	ChartItemTools::setScaleX(c, data.scaleX);
+	ChartItemTools::setScaleY(c, data.scaleY);
+	ChartItemTools::setRotationPivot(c, data.pivotRotation, false);
+	ChartItemTools::setScalePivot(c, data.pivotScale, false);
 	ChartItemTools::recalculateTransformations(c);
-    if(group != -1) {
-        tab->scene()->addToGroup(group, c);
-		tab->scene()->getGroup(group)->setLayer(layer);
+    if(data.group != -1) {
+        tab->scene()->addToGroup(data.group, c);
+		tab->scene()->getGroup(data.group)->setLayer(data.layer);
 	}
 }
 			
-void File_v2::saveCustomStitches(QXmlStreamWriter *stream)
+void File_v2::collectCustomStitches()
 {
     CrochetTab *tab = qobject_cast<CrochetTab*>(mTabWidget->widget(0));
 
@@ -630,290 +861,217 @@ void File_v2::saveCustomStitches(QXmlStreamWriter *stream)
         if(s)
             mInternalStitchSet->addStitch(s);
     }
+}
 
-    mInternalStitchSet->saveXmlStitchSet(stream, true);
+void File_v2::writeIcons(QDataStream *stream, const PatternData &pattern)
+{
+    //the same layout as StitchSet::saveIcons().
+    QMap<QString, QByteArray> icons;
+    foreach(QString icon, pattern.iconFiles.keys())
+        icons.insert(icon, IconStore::inst()->iconData(pattern.iconFiles.value(icon)));
+    *stream << icons;
 }
 
-bool File_v2::saveCharts(QXmlStreamWriter *stream)
+void File_v2::writeStitchSet(QXmlStreamWriter *stream, const PatternData &pattern)
 {
-    int tabCount = mTabWidget->count();
+    //the same layout as StitchSet::saveXmlStitchSet().
+    stream->writeStartElement("stitch_set");
+    stream->writeTextElement("name", pattern.stitchSetName);
+    stream->writeTextElement("author", pattern.author);
+    stream->writeTextElement("email", pattern.email);
+    stream->writeTextElement("org", pattern.org);
+    stream->writeTextElement("url", pattern.url);
+
+    foreach(const StitchData &s, pattern.stitches) {
+        stream->writeStartElement("stitch");
+
+        stream->writeTextElement("name", s.name);
+        stream->writeTextElement("icon", s.icon);
+        stream->writeTextElement("description", s.description);
+        stream->writeTextElement("category", s.category);
+        stream->writeTextElement("ws", s.wrongSide);
+
+        stream->writeEndElement(); //stitch
+    }
 
-    for(int i = 0; i < tabCount; ++i) {
-        CrochetTab *tab = qobject_cast<CrochetTab*>(mTabWidget->widget(i));
-        if(!tab)
-            continue;
+    stream->writeEndElement(); // stitch_set
+}
 
-	
-		//first, block al qt signals for performance
-		tab->scene()->blockSignals(true);
-	
-        stream->writeStartElement("chart"); //start chart
+void File_v2::writeColors(QXmlStreamWriter *stream, const PatternData &pattern)
+{
+    stream->writeStartElement("colors"); //start colors
 
-        stream->writeTextElement("name", mTabWidget->tabText(i));
+    foreach(QString key, pattern.colors.keys()) {
+        stream->writeStartElement("color");
+        stream->writeAttribute("added", QString::number(pattern.colors.value(key)));
+        stream->writeCharacters(key);
+        stream->writeEndElement(); //end color
+    }
 
-        stream->writeTextElement("style", QString::number(tab->mChartStyle));
-        stream->writeTextElement("defaultSt", tab->scene()->mDefaultStitch);
+    stream->writeEndElement(); // end colors
+}
 
-		//write the chart size 
-		stream->writeStartElement("size");
-		stream->writeAttribute("x", QString::number(tab->scene()->sceneRect().x()));
-		stream->writeAttribute("y", QString::number(tab->scene()->sceneRect().y()));
-		stream->writeAttribute("width", QString::number(tab->scene()->sceneRect().width()));
-		stream->writeAttribute("height", QString::number(tab->scene()->sceneRect().height()));
-		stream->writeEndElement();
-	
-        bool showCenter = tab->scene()->showChartCenter();
-        if(showCenter) {
-            stream->writeStartElement("chartCenter");
-            stream->writeAttribute("x", QString::number(tab->scene()->mCenterSymbol->scenePos().x()));
-            stream->writeAttribute("y", QString::number(tab->scene()->mCenterSymbol->scenePos().y()));
-            stream->writeEndElement(); //end chart center
+static void writeNewScale(QXmlStreamWriter *stream, const ItemData &item)
+{
+    stream->writeStartElement("newscale");
+    stream->writeAttribute("scaleX", QString::number(item.scaleX));
+    stream->writeAttribute("scaleY", QString::number(item.scaleY));
+    stream->writeAttribute("pivotX", QString::number(item.pivotScale.x()));
+    stream->writeAttribute("pivotY", QString::number(item.pivotScale.y()));
+    stream->writeEndElement();
+
+    stream->writeStartElement("rotation");
+    stream->writeAttribute("rotation", QString::number(item.rotation));
+    stream->writeAttribute("pivotX", QString::number(item.pivotRotation.x()));
+    stream->writeAttribute("pivotY", QString::number(item.pivotRotation.y()));
+    stream->writeEndElement();
+}
 
-        }
+static void writePoint(QXmlStreamWriter *stream, const QString &name, const QPointF &pt)
+{
+    stream->writeStartElement(name);
+    stream->writeAttribute("x", QString::number(pt.x()));
+    stream->writeAttribute("y", QString::number(pt.y()));
+    stream->writeEndElement();
+}
 
-        Guidelines guidelines = tab->scene()->guidelines();
-        if(guidelines.type() != "None") {
-            stream->writeStartElement("guidelines");
-            stream->writeAttribute("type", guidelines.type());
+void File_v2::writeChart(QXmlStreamWriter *stream, const ChartData &chart)
+{
+    stream->writeStartElement("chart"); //start chart
 
-            stream->writeAttribute("rows", QString::number(guidelines.rows()));
-            stream->writeAttribute("columns", QString::number(guidelines.columns()));
-            stream->writeAttribute("cellWidth", QString::number(guidelines.cellWidth()));
-            stream->writeAttribute("cellHeight", QString::number(guidelines.cellHeight()));
-            stream->writeEndElement();
-        }
+    stream->writeTextElement("name", chart.name);
 
-        stream->writeStartElement("rowSpacing");
-        stream->writeAttribute("width", QString::number(tab->scene()->mDefaultSize.width()));
-        stream->writeAttribute("height", QString::number(tab->scene()->mDefaultSize.height()));
-        stream->writeEndElement(); //row spacing
+    stream->writeTextElement("style", QString::number(chart.style));
+    stream->writeTextElement("defaultSt", chart.defaultSt);
 
-        if(tab->scene()->rowCount() >= 1 && tab->scene()->maxColumnCount() >= 1) {
-            stream->writeStartElement("grid");
-            int rowCount = tab->scene()->rowCount();
-            for(int i = 0; i < rowCount; ++i) {
-                int colCount = tab->scene()->columnCount(i);
-                stream->writeTextElement("row", QString::number(colCount)); //row, columns.
-            }
-            stream->writeEndElement(); //end grid.
-        }
-		
-		foreach(ChartLayer* l, tab->scene()->layers()) {
-			stream->writeStartElement("chartLayer");
-			stream->writeAttribute("name", l->name());
-			stream->writeAttribute("uid", QString::number(l->uid()));
-			stream->writeAttribute("visible", QString::number(l->visible()));
-			
-			stream->writeEndElement();
-		}
+    //write the chart size
+    stream->writeStartElement("size");
+    stream->writeAttribute("x", QString::number(chart.size.x()));
+    stream->writeAttribute("y", QString::number(chart.size.y()));
+    stream->writeAttribute("width", QString::number(chart.size.width()));
+    stream->writeAttribute("height", QString::number(chart.size.height()));
+    stream->writeEndElement();
 
-        foreach(ItemGroup *g, tab->scene()->mGroups) {
-            stream->writeTextElement("group", QString::number(tab->scene()->mGroups.indexOf(g)));
-        }
+    if(chart.hasCenter)
+        writePoint(stream, "chartCenter", chart.center);
 
-        foreach(QGraphicsItem *item, tab->scene()->items()) {
+    if(chart.hasGuidelines) {
+        stream->writeStartElement("guidelines");
+        stream->writeAttribute("type", chart.guidelineType);
 
-            Cell *c = qgraphicsitem_cast<Cell*>(item);
-            if(!c)
-                continue;
+        stream->writeAttribute("rows", QString::number(chart.guidelineRows));
+        stream->writeAttribute("columns", QString::number(chart.guidelineColumns));
+        stream->writeAttribute("cellWidth", QString::number(chart.guidelineCellWidth));
+        stream->writeAttribute("cellHeight", QString::number(chart.guidelineCellHeight));
+        stream->writeEndElement();
+    }
 
-            stream->writeStartElement("cell"); //start cell
-            stream->writeTextElement("stitch", c->stitch()->name());
-			stream->writeTextElement("layer", QString::number(c->layer()));
+    stream->writeStartElement("rowSpacing");
+    stream->writeAttribute("width", QString::number(chart.rowSpacing.width()));
+    stream->writeAttribute("height", QString::number(chart.rowSpacing.height()));
+    stream->writeEndElement(); //row spacing
 
-            //if the stitch is on the grid save the grid position.
-            QPoint pt = tab->scene()->indexOf(c);
-            if(pt != QPoint(-1, -1)) {
-                stream->writeStartElement("grid");
-                stream->writeAttribute("row", QString::number(pt.y()));
-                stream->writeAttribute("column", QString::number(pt.x()));
-                stream->writeEndElement(); //grid
-            }
+    if(!chart.gridRows.isEmpty()) {
+        stream->writeStartElement("grid");
+        foreach(int cols, chart.gridRows)
+            stream->writeTextElement("row", QString::number(cols)); //row, columns.
+        stream->writeEndElement(); //end grid.
+    }
 
-            bool isGrouped = c->parentItem() ? true : false;
-            ItemGroup *g = 0;
-			QList<QGraphicsItem*> ungroupstack;
-			
-            if(isGrouped) {
-                g = qgraphicsitem_cast<ItemGroup*>(c->parentItem());
-                int groupNum = tab->scene()->mGroups.indexOf(g);
-                stream->writeTextElement("group", QString::number(groupNum));
-
-				//ungroup this and all possible childs
-				ungroupstack.append(c);
-				while (ungroupstack.last()->parentItem()
-					&& ungroupstack.last()->parentItem()->type() == ItemGroup::Type) {
-					ungroupstack.append(ungroupstack.last()->parentItem());
-				}
-				
-                //ungroup the items so that we can
-                //take an acurate position of each stitch.
-				//TODO this destroys all groups 
-				for (int i = ungroupstack.count() - 1 ; i >= 2 ; i--) {
-					ItemGroup* ig = qgraphicsitem_cast<ItemGroup*>(ungroupstack[i]);
-					tab->scene()->ungroup(ig);
-				}
-
-				g->removeFromGroup(c);
-				ChartItemTools::recalculateTransformations(c);
-            }
+    foreach(const LayerData &layer, chart.layers) {
+        stream->writeStartElement("chartLayer");
+        stream->writeAttribute("name", layer.name);
+        stream->writeAttribute("uid", QString::number(layer.uid));
+        stream->writeAttribute("visible", QString::number(layer.visible));
+        stream->writeEndElement();
+    }
 
-            stream->writeStartElement("position");
-            stream->writeAttribute("x", QString::number(c->pos().x()));
-            stream->writeAttribute("y", QString::number(c->pos().y()));
-            stream->writeEndElement(); //position
-
-			stream->writeStartElement("newscale");
-			stream->writeAttribute("scaleX", QString::number(ChartItemTools::getScaleX(c)));
-			stream->writeAttribute("scaleY", QString::number(ChartItemTools::getScaleY(c)));
-			stream->writeAttribute("pivotX", QString::number(ChartItemTools::getScalePivot(c).x()));
-			stream->writeAttribute("pivotY", QString::number(ChartItemTools::getScalePivot(c).y()));
-			stream->writeEndElement();
-			
-			stream->writeStartElement("rotation");
-			stream->writeAttribute("rotation", QString::number(ChartItemTools::getRotation(c)));
-			stream->writeAttribute("pivotX", QString::number(ChartItemTools::getRotationPivot(c).x()));
-			stream->writeAttribute("pivotY", QString::number(ChartItemTools::getRotationPivot(c).y()));
-			stream->writeEndElement();
- 
-            //in case we haven't closed the
-            //application we need to regroup the items.
-            if(isGrouped) {
-				g->addToGroup(c);
-			}
-
-            stream->writeTextElement("color", c->color().name());
-            stream->writeTextElement("bgColor", c->bgColor().name());
-
-            stream->writeStartElement("pivotPoint");
-            stream->writeAttribute("x", QString::number(c->transformOriginPoint().x()));
-            stream->writeAttribute("y", QString::number(c->transformOriginPoint().y()));
-            stream->writeEndElement(); //end pivotPoint
-
-            stream->writeEndElement(); //end cell
+    for(int i = 0; i < chart.groupCount; ++i)
+        stream->writeTextElement("group", QString::number(i));
+
+    foreach(const CellData &c, chart.cells) {
+        stream->writeStartElement("cell"); //start cell
+        stream->writeTextElement("stitch", c.stitch);
+        stream->writeTextElement("layer", QString::number(c.layer));
+
+        //if the stitch is on the grid save the grid position.
+        if(c.row >= 0 && c.column >= 0) {
+            stream->writeStartElement("grid");
+            stream->writeAttribute("row", QString::number(c.row));
+            stream->writeAttribute("column", QString::number(c.column));
+            stream->writeEndElement(); //grid
         }
-		foreach(QGraphicsItem *item, tab->scene()->items()) {
-				ChartImage* c = qgraphicsitem_cast<ChartImage*>(item);
-				if (!c)
-					continue;
-				
-				stream->writeStartElement("chartimage"); //start cell
-				stream->writeTextElement("layer", QString::number(c->layer()));
-				stream->writeTextElement("filename", c->filename());
-				bool isGrouped = c->parentItem() ? true : false;
-				ItemGroup *g = 0;
-				if(isGrouped) {
-					g = qgraphicsitem_cast<ItemGroup*>(c->parentItem());
-					int groupNum = tab->scene()->mGroups.indexOf(g);
-					stream->writeTextElement("group", QString::number(groupNum));
-
-					//ungroup the items so that we can
-					//take an acurate position of each stitch.
-					g->removeFromGroup(c);
-				}
-				
-				stream->writeStartElement("position");
-				stream->writeAttribute("x", QString::number(c->pos().x()));
-				stream->writeAttribute("y", QString::number(c->pos().y()));
-				stream->writeEndElement(); //position
-
-				stream->writeStartElement("newscale");
-				stream->writeAttribute("scaleX", QString::number(ChartItemTools::getScaleX(c)));
-				stream->writeAttribute("scaleY", QString::number(ChartItemTools::getScaleY(c)));
-				stream->writeAttribute("pivotX", QString::number(ChartItemTools::getScalePivot(c).x()));
-				stream->writeAttribute("pivotY", QString::number(ChartItemTools::getScalePivot(c).y()));
-				stream->writeEndElement();
-				
-				stream->writeStartElement("rotation");
-				stream->writeAttribute("rotation", QString::number(ChartItemTools::getRotation(c)));
-				stream->writeAttribute("pivotX", QString::number(ChartItemTools::getRotationPivot(c).x()));
-				stream->writeAttribute("pivotY", QString::number(ChartItemTools::getRotationPivot(c).y()));
-				stream->writeEndElement();
-
-				//in case we haven't closed the
-				//application we need to regroup the items.
-				if(isGrouped)
-					g->addToGroup(c);
-				
-				stream->writeStartElement("pivotPoint");
-				stream->writeAttribute("x", QString::number(c->transformOriginPoint().x()));
-				stream->writeAttribute("y", QString::number(c->transformOriginPoint().y()));
-				stream->writeEndElement(); //end pivotPoint
-
-				stream->writeEndElement(); //end indicator
-		}
-        foreach(Indicator *i, tab->scene()->indicators()) {
-            stream->writeStartElement("indicator");
-
-                stream->writeTextElement("x", QString::number(i->scenePos().x()));
-                stream->writeTextElement("y", QString::number(i->scenePos().y()));
-                stream->writeTextElement("text", i->text());
-                stream->writeTextElement("textColor", i->textColor().name());
-                stream->writeTextElement("bgColor", i->bgColor().name());
-                stream->writeTextElement("style", i->style());
-				stream->writeTextElement("fontname", i->font().toString());
-				stream->writeTextElement("fontsize", QString::number(i->font().pointSize()));
-				stream->writeTextElement("layer", QString::number(i->layer()));
-                bool isGrouped = i->parentItem() ? true : false;
-                ItemGroup *g = 0;
-                if(isGrouped) {
-                    g = qgraphicsitem_cast<ItemGroup*>(i->parentItem());
-                    int groupNum = tab->scene()->mGroups.indexOf(g);
-                    stream->writeTextElement("group", QString::number(groupNum));
-
-                    //ungroup the items so that we can
-                    //take an acurate position of each stitch.
-                    g->removeFromGroup(i);
-                }
-				
-				stream->writeStartElement("newscale");
-				stream->writeAttribute("scaleX", QString::number(ChartItemTools::getScaleX(i)));
-				stream->writeAttribute("scaleY", QString::number(ChartItemTools::getScaleY(i)));
-				stream->writeAttribute("pivotX", QString::number(ChartItemTools::getScalePivot(i).x()));
-				stream->writeAttribute("pivotY", QString::number(ChartItemTools::getScalePivot(i).y()));
-				stream->writeEndElement();
-				
-				stream->writeStartElement("rotation");
-				stream->writeAttribute("rotation", QString::number(ChartItemTools::getRotation(i)));
-				stream->writeAttribute("pivotX", QString::number(ChartItemTools::getRotationPivot(i).x()));
-				stream->writeAttribute("pivotY", QString::number(ChartItemTools::getRotationPivot(i).y()));
-				stream->writeEndElement();
-				
-                //in case we haven't closed the
-                //application we need to regroup the items.
-                if(isGrouped)
-                    g->addToGroup(i);
-                
-            stream->writeEndElement(); //end indicator
+
+        if(c.group >= 0)
+            stream->writeTextElement("group", QString::number(c.group));
+
+        writePoint(stream, "position", c.position);
+
+        //the stored cells are saved with their full transformation so any version can load them.
+        bool hasTransform = !c.transform.isIdentity();
+        if(hasTransform) {
+            const QTransform &t = c.transform;
+            stream->writeStartElement("transformation");
+            stream->writeAttribute("m11", QString::number(t.m11()));
+            stream->writeAttribute("m12", QString::number(t.m12()));
+            stream->writeAttribute("m13", QString::number(t.m13()));
+            stream->writeAttribute("m21", QString::number(t.m21()));
+            stream->writeAttribute("m22", QString::number(t.m22()));
+            stream->writeAttribute("m23", QString::number(t.m23()));
+            stream->writeAttribute("m31", QString::number(t.m31()));
+            stream->writeAttribute("m32", QString::number(t.m32()));
+            stream->writeAttribute("m33", QString::number(t.m33()));
+            stream->writeEndElement(); //transformation
+        } else {
+            writeNewScale(stream, c);
         }
 
-        stream->writeEndElement(); // end chart
-		
-		//and resume signals
-		tab->scene()->blockSignals(false);
+        stream->writeTextElement("color", c.color);
+        stream->writeTextElement("bgColor", c.bgColor);
+
+        if(!hasTransform)
+            writePoint(stream, "pivotPoint", c.pivotPoint);
+
+        stream->writeEndElement(); //end cell
     }
 
-    return true;
-}
+    foreach(const ChartImageData &c, chart.images) {
+        stream->writeStartElement("chartimage");
+        stream->writeTextElement("layer", QString::number(c.layer));
+        stream->writeTextElement("filename", c.filename);
+        if(c.group >= 0)
+            stream->writeTextElement("group", QString::number(c.group));
 
-void File_v2::saveColors(QXmlStreamWriter *stream)
-{
-    stream->writeStartElement("colors"); //start colors
-    MainWindow *mw = static_cast<MainWindow*>(mParent->mParent);
+        writePoint(stream, "position", c.position);
+        writeNewScale(stream, c);
+        writePoint(stream, "pivotPoint", c.pivotPoint);
 
-    QStringList keys = mw->patternColors().keys();
+        stream->writeEndElement(); //end chartimage
+    }
 
-    foreach(QString key, keys) {
-        stream->writeStartElement("color");
-        stream->writeAttribute("added", QString::number(mw->patternColors().value(key).value("added")));
-        stream->writeCharacters(key);
-        stream->writeEndElement(); //end color
+    foreach(const IndicatorData &i, chart.indicators) {
+        stream->writeStartElement("indicator");
+
+        stream->writeTextElement("x", QString::number(i.position.x()));
+        stream->writeTextElement("y", QString::number(i.position.y()));
+        stream->writeTextElement("text", i.text);
+        stream->writeTextElement("textColor", i.textColor);
+        stream->writeTextElement("bgColor", i.bgColor);
+        stream->writeTextElement("style", i.style);
+        stream->writeTextElement("fontname", i.fontName);
+        stream->writeTextElement("fontsize", QString::number(i.fontSize));
+        stream->writeTextElement("layer", QString::number(i.layer));
+        if(i.group >= 0)
+            stream->writeTextElement("group", QString::number(i.group));
+
+        writeNewScale(stream, i);
+
+        stream->writeEndElement(); //end indicator
     }
 
-    stream->writeEndElement(); // end colors
+    stream->writeEndElement(); // end chart
 }
 
-
 void File_v2::cleanUp()
 {
     if(mInternalStitchSet)
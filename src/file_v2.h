@@ -22,37 +22,118 @@
 #define FINE_V2_H
 
 #include "file.h"
+#include "chartparser.h"
 
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
+#include <QElapsedTimer>
+#include <QHash>
 
 class QDataStream;
+class QProgressDialog;
 class CrochetTab;
 class Scene;
+class Stitch;
 
+/**
+ * Loads files in two stages: a ChartParser reads the xml into ChartData on a
+ * worker thread, then the items are created on the GUI thread a few at a time
+ * with a progress dialog that can cancel the load.
+ *
+ * Saving works the other way around, snapshot() copies the document into
+ * PatternData and writeSnapshot() writes it without touching the scene.
+ */
 class File_v2 : public File
 {
+    friend class Journal;
 public:
     File_v2(MainWindow *mw, FileFactory* parent);
 
     FileFactory::FileError load(QDataStream *stream);
     FileFactory::FileError save(QDataStream *stream);
 
+    void snapshot();
+    FileFactory::FileError writeSnapshot(QDataStream *stream);
+
 protected:
     void cleanUp();
 
+    /**
+     * Read the xml with the stitch set and colors into @header,
+     * and the data parseCharts() reads into @charts.
+     */
+    virtual void readDocument(QDataStream* stream, QByteArray* header, QByteArray* charts);
+    /**
+     * Fill mCharts from @data, runs on a worker thread so don't touch any QObjects here.
+     */
+    virtual bool parseCharts(QByteArray data);
+    /**
+     * Return true if the items of chart @index should be loaded later,
+     * the tab is set up to load them when it's first shown.
+     */
+    virtual bool deferChart(CrochetTab* tab, int index);
+
+    void finishChart(CrochetTab* tab, const ChartData &chart);
+    void loadCell(CrochetTab* tab, const CellData &data);
+    void loadIndicator(CrochetTab* tab, const IndicatorData &data);
+    void loadChartImage(CrochetTab* tab, const ChartImageData &data);
+
+    /**
+     * Add the stitches used by the pattern to the internal stitch set.
+     */
+    void collectCustomStitches();
+    /**
+     * Copy the values to save from the scene.
+     */
+    ChartData chartData(int index);
+    /**
+     * The chart settings, layers, grid and groups without any items or name.
+     */
+    static ChartData chartHeader(CrochetTab* tab);
+
+    static void writeIcons(QDataStream* stream, const PatternData &pattern);
+    static void writeStitchSet(QXmlStreamWriter* stream, const PatternData &pattern);
+    static void writeColors(QXmlStreamWriter* stream, const PatternData &pattern);
+    static void writeChart(QXmlStreamWriter* stream, const ChartData &chart);
+
+    /**
+     * Write a QByteArray to @stream whose contents are written straight to the device.
+     *
+     * beginSection() writes a placeholder length and returns where it is,
+     * endSection() goes back and fills it in. The device must be seekable.
+     */
+    static qint64 beginSection(QDataStream* stream);
+    static bool endSection(QDataStream* stream, qint64 start);
+
+    QList<ChartData> mCharts;
+    //the document being saved, filled in by snapshot().
+    PatternData mPattern;
+
+    //load free standing stitches into the scene's CellStore instead of creating Cells.
+    bool mCompactCells;
+
 private:
+    /**
+     * Load the stitch set and colors, stops at the first chart.
+     */
+    void loadHeader(const QByteArray &data);
     void loadColors(QXmlStreamReader* stream);
-    void loadChart(QXmlStreamReader* stream);
 
-    void loadCell(CrochetTab* tab, QXmlStreamReader* stream);
-    void loadGrid(QXmlStreamReader* stream, Scene* scene);
-    void loadIndicator(CrochetTab* tab, QXmlStreamReader* stream);
-	void loadChartImage(CrochetTab* tab, QXmlStreamReader* stream);
+    CrochetTab* createChart(const ChartData &chart);
+    Stitch* findStitch(const QString &name);
 
-    void saveCustomStitches(QXmlStreamWriter* stream);
-    void saveColors(QXmlStreamWriter* stream);
-    bool saveCharts(QXmlStreamWriter* stream);
+    /**
+     * Let the event loop run once the current slice is used up.
+     * Returns false if the user canceled the load.
+     */
+    bool nextSlice(QProgressDialog* progress, int done);
+    /**
+     * Remove everything a canceled load has added.
+     */
+    void cancelLoad(QList<CrochetTab*> tabs);
 
+    ChartParser mParser;
+    QHash<QString, Stitch*> mStitches;
+    QElapsedTimer mSliceTimer;
 };
 #endif // FINE_V2_H
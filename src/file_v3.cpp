@@ -0,0 +1,850 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "file_v3.h"
+
+#include "crochettab.h"
+#include "settings.h"
+#include "debug.h"
+
+#include <QDataStream>
+#include <QTabWidget>
+#include <QXmlStreamWriter>
+
+//sections smaller than this aren't worth compressing, in bytes.
+#define FILE_V3_COMPRESS_SIZE 256
+//the version written in the header of every section.
+#define FILE_V3_SECTION_VERSION 1
+
+//the values every item has, in the order the columns are saved.
+enum ItemField {
+    Field_PosX, Field_PosY,
+    Field_PivotX, Field_PivotY,
+    Field_Angle,
+    Field_ScaleX, Field_ScaleY,
+    Field_Rotation, Field_RotationPivotX, Field_RotationPivotY,
+    Field_NewScaleX, Field_NewScaleY, Field_ScalePivotX, Field_ScalePivotY,
+    Field_M11, Field_M12, Field_M13,
+    Field_M21, Field_M22, Field_M23,
+    Field_M31, Field_M32, Field_M33,
+    Field_Count
+};
+
+static double itemField(const ItemData *item, int field)
+{
+    switch(field) {
+        case Field_PosX:            return item->position.x();
+        case Field_PosY:            return item->position.y();
+        case Field_PivotX:          return item->pivotPoint.x();
+        case Field_PivotY:          return item->pivotPoint.y();
+        case Field_Angle:           return item->angle;
+        case Field_ScaleX:          return item->scale.x();
+        case Field_ScaleY:          return item->scale.y();
+        case Field_Rotation:        return item->rotation;
+        case Field_RotationPivotX:  return item->pivotRotation.x();
+        case Field_RotationPivotY:  return item->pivotRotation.y();
+        case Field_NewScaleX:       return item->scaleX;
+        case Field_NewScaleY:       return item->scaleY;
+        case Field_ScalePivotX:     return item->pivotScale.x();
+        case Field_ScalePivotY:     return item->pivotScale.y();
+        case Field_M11:             return item->transform.m11();
+        case Field_M12:             return item->transform.m12();
+        case Field_M13:             return item->transform.m13();
+        case Field_M21:             return item->transform.m21();
+        case Field_M22:             return item->transform.m22();
+        case Field_M23:             return item->transform.m23();
+        case Field_M31:             return item->transform.m31();
+        case Field_M32:             return item->transform.m32();
+        case Field_M33:             return item->transform.m33();
+        default:                    return 0;
+    }
+}
+
+static void setItemFields(ItemData *item, const double *v)
+{
+    item->position = QPointF(v[Field_PosX], v[Field_PosY]);
+    item->pivotPoint = QPointF(v[Field_PivotX], v[Field_PivotY]);
+    item->angle = v[Field_Angle];
+    item->scale = QPointF(v[Field_ScaleX], v[Field_ScaleY]);
+    item->rotation = v[Field_Rotation];
+    item->pivotRotation = QPointF(v[Field_RotationPivotX], v[Field_RotationPivotY]);
+    item->scaleX = v[Field_NewScaleX];
+    item->scaleY = v[Field_NewScaleY];
+    item->pivotScale = QPointF(v[Field_ScalePivotX], v[Field_ScalePivotY]);
+    item->transform.setMatrix(v[Field_M11], v[Field_M12], v[Field_M13],
+                              v[Field_M21], v[Field_M22], v[Field_M23],
+                              v[Field_M31], v[Field_M32], v[Field_M33]);
+}
+
+static quint32 dictionaryId(const QString &str, QStringList *dictionary, QHash<QString, quint32> *ids)
+{
+    QHash<QString, quint32>::const_iterator it = ids->constFind(str);
+    if(it != ids->constEnd())
+        return it.value();
+
+    quint32 id = dictionary->count();
+    dictionary->append(str);
+    ids->insert(str, id);
+    return id;
+}
+
+File_v3::File_v3(MainWindow *mw, FileFactory *parent)
+    : File_v2(mw, parent)
+{
+}
+
+void File_v3::readDocument(QDataStream *stream, QByteArray *header, QByteArray *charts)
+{
+    *stream >> *header;
+    *stream >> *charts;
+}
+
+FileFactory::FileError File_v3::load(QDataStream *stream)
+{
+    FileFactory::FileError err = File_v2::load(stream);
+
+    //the tabs keep the sections of the charts they haven't loaded yet.
+    mIndex.clear();
+    return err;
+}
+
+bool File_v3::parseCharts(QByteArray data)
+{
+    mIndex.clear();
+
+    //without an index every chart is loaded now.
+    if(!readIndex(data, &mIndex)) {
+        mIndex.clear();
+        bool ok = readCharts(data, &mCharts);
+        if(!ok)
+            qWarning() << "Error loading saved file: the chart data is damaged or from a newer version";
+        return ok;
+    }
+
+    for(int i = 0; i < mIndex.count(); ++i) {
+        ChartIndexData &entry = mIndex[i];
+        entry.sections = data.mid(entry.offset, entry.size);
+
+        bool ok;
+        if(i == 0) {
+            //the first tab is shown right away so it's loaded with the document.
+            ok = readCharts(entry.sections, &mCharts) && mCharts.count() == 1;
+            entry.sections.clear();
+        } else {
+            ChartData chart;
+            ok = readChartHeader(entry.sections, &chart);
+            mCharts.append(chart);
+        }
+
+        if(!ok) {
+            qWarning() << "Error loading saved file: the chart data is damaged or from a newer version";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool File_v3::deferChart(CrochetTab *tab, int index)
+{
+    if(index >= mIndex.count() || mIndex.at(index).sections.isEmpty())
+        return false;
+
+    tab->setPendingChart(mIndex.at(index));
+    return true;
+}
+
+FileFactory::FileError File_v3::loadChart(CrochetTab *tab)
+{
+    QList<ChartData> charts;
+    if(!readCharts(tab->pendingChart().sections, &charts) || charts.count() != 1) {
+        qWarning() << "Error loading chart: the chart data is damaged or from a newer version";
+        return FileFactory::Err_LoadingFile;
+    }
+
+    mCompactCells = Settings::inst()->value("compactCellStorage").toBool();
+
+    ChartData chart = charts.first();
+    //the tab may have been renamed since the file was opened.
+    chart.name = mTabWidget->tabText(mTabWidget->indexOf(tab));
+
+    QGraphicsScene::ItemIndexMethod indexMethod = tab->scene()->itemIndexMethod();
+    tab->scene()->setItemIndexMethod(QGraphicsScene::NoIndex);
+
+    foreach(const CellData &c, chart.cells)
+        loadCell(tab, c);
+    foreach(const ChartImageData &c, chart.images)
+        loadChartImage(tab, c);
+    foreach(const IndicatorData &i, chart.indicators)
+        loadIndicator(tab, i);
+
+    tab->scene()->setItemIndexMethod(indexMethod);
+
+    //the loaded cells have counted their stitches and colors again.
+    tab->clearPendingChart();
+    finishChart(tab, chart);
+
+    return FileFactory::No_Error;
+}
+
+bool File_v3::pendingItems(ChartData *chart)
+{
+    QList<ChartData> charts;
+    if(!readCharts(chart->sections, &charts) || charts.count() != 1)
+        return false;
+
+    chart->cells = charts.first().cells;
+    chart->images = charts.first().images;
+    chart->indicators = charts.first().indicators;
+
+    //the journal hasn't seen these items, they get ids when they're loaded.
+    for(int c = 0; c < chart->cells.count(); ++c)
+        chart->cells[c].id = 0;
+    for(int c = 0; c < chart->images.count(); ++c)
+        chart->images[c].id = 0;
+    for(int c = 0; c < chart->indicators.count(); ++c)
+        chart->indicators[c].id = 0;
+
+    return true;
+}
+
+void File_v3::chartCounts(const ChartData &chart, QMap<QString, int> *stitches, QMap<QString, int> *colors)
+{
+    foreach(const CellData &c, chart.cells) {
+        if(!c.stitch.isEmpty())
+            (*stitches)[c.stitch]++;
+        if(!c.bgColor.isEmpty() && c.bgColor != "#ffffff")
+            (*colors)[c.bgColor]++;
+        if(!c.color.isEmpty())
+            (*colors)[c.color]++;
+    }
+}
+
+FileFactory::FileError File_v3::writeSnapshot(QDataStream *stream)
+{
+    *stream << (qint32)FileFactory::Version_1_3;
+    stream->setVersion(QDataStream::Qt_4_7);
+
+    writeIcons(stream, mPattern);
+
+    //the stitches and colors are saved as xml, the same as version 1.2.
+    QByteArray header;
+    QXmlStreamWriter xmlStream(&header);
+    xmlStream.writeStartDocument();
+
+    xmlStream.writeStartElement("pattern"); //start pattern
+    xmlStream.writeAttribute("version", QString::number(FileFactory::Version_1_3));
+
+    writeStitchSet(&xmlStream, mPattern);
+    writeColors(&xmlStream, mPattern);
+    xmlStream.writeEndElement();
+
+    xmlStream.writeEndDocument();
+
+    *stream << header;
+
+    //the charts are written straight into the file as one QByteArray.
+    qint64 start = beginSection(stream);
+    if(start < 0)
+        return FileFactory::Err_SavingFile;
+
+    writeCharts(*stream, mPattern.charts);
+
+    if(!endSection(stream, start))
+        return FileFactory::Err_SavingFile;
+
+    return FileFactory::No_Error;
+}
+
+void File_v3::writeSection(QDataStream &out, quint32 id, const QByteArray &payload)
+{
+    quint8 flags = 0;
+    QByteArray data = payload;
+
+    if(payload.size() >= FILE_V3_COMPRESS_SIZE) {
+        QByteArray compressed = qCompress(payload);
+        if(compressed.size() < payload.size()) {
+            data = compressed;
+            flags |= Section_Compressed;
+        }
+    }
+
+    out << id << (quint16)FILE_V3_SECTION_VERSION << flags << data;
+}
+
+QByteArray File_v3::writeCharts(const QList<ChartData> &charts)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_7);
+
+    writeCharts(out, charts);
+
+    return data;
+}
+
+void File_v3::writeCharts(QDataStream &out, const QList<ChartData> &charts)
+{
+    qint64 start = out.device()->pos();
+    QList<ChartIndexData> index;
+
+    foreach(const ChartData &chart, charts) {
+        ChartIndexData entry;
+        entry.offset = out.device()->pos() - start;
+        entry.name = chart.name;
+
+        if(!chart.sections.isEmpty()) {
+            entry.stitches = chart.sectionStitches;
+            entry.colors = chart.sectionColors;
+            copySections(out, chart);
+
+            entry.size = out.device()->pos() - start - entry.offset;
+            index.append(entry);
+            continue;
+        }
+
+        chartCounts(chart, &entry.stitches, &entry.colors);
+
+        QStringList dictionary;
+        QByteArray cells = writeCells(chart.cells, &dictionary);
+
+        writeSection(out, Section_Chart, writeChart(chart));
+
+        QByteArray dict;
+        QDataStream dictStream(&dict, QIODevice::WriteOnly);
+        dictStream.setVersion(QDataStream::Qt_4_7);
+        dictStream << dictionary;
+        writeSection(out, Section_Dictionary, dict);
+
+        writeSection(out, Section_Cells, cells);
+        writeSection(out, Section_Images, writeImages(chart.images));
+        writeSection(out, Section_Indicators, writeIndicators(chart.indicators));
+
+        QByteArray ids = writeItemIds(chart);
+        if(!ids.isEmpty())
+            writeSection(out, Section_ItemIds, ids);
+
+        entry.size = out.device()->pos() - start - entry.offset;
+        index.append(entry);
+    }
+
+    //a single chart is always loaded with the document.
+    if(index.count() > 1)
+        writeSection(out, Section_Index, writeIndex(index));
+}
+
+void File_v3::copySections(QDataStream &out, const ChartData &chart)
+{
+    QDataStream in(chart.sections);
+    in.setVersion(QDataStream::Qt_4_7);
+
+    quint32 id;
+    quint16 version;
+    quint8 flags;
+    QByteArray payload;
+    in >> id >> version >> flags >> payload;
+
+    //the tab may have been renamed, the rest of the chart is written as it was read.
+    ChartData header;
+    if(in.status() == QDataStream::Ok && id == Section_Chart && readChartHeader(chart.sections, &header)) {
+        header.name = chart.name;
+        writeSection(out, Section_Chart, writeChart(header));
+    } else {
+        in.device()->seek(0);
+    }
+
+    qint64 pos = in.device()->pos();
+    out.writeRawData(chart.sections.constData() + pos, chart.sections.size() - pos);
+}
+
+QByteArray File_v3::writeIndex(const QList<ChartIndexData> &index)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_7);
+
+    out << (quint32)index.count();
+    foreach(const ChartIndexData &entry, index)
+        out << entry.offset << entry.size << entry.name << entry.stitches << entry.colors;
+
+    return data;
+}
+
+bool File_v3::readIndex(const QByteArray &data, QList<ChartIndexData> *index)
+{
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_4_7);
+
+    //only read the section headers until the index is found.
+    while(!in.atEnd()) {
+        quint32 id, size;
+        quint16 version;
+        quint8 flags;
+
+        in >> id >> version >> flags >> size;
+        if(in.status() != QDataStream::Ok)
+            return false;
+
+        //an empty QByteArray is written as 0xffffffff.
+        if(size == 0xffffffff)
+            size = 0;
+
+        if(id != Section_Index) {
+            if(in.skipRawData(size) != (int)size)
+                return false;
+            continue;
+        }
+
+        if(version > FILE_V3_SECTION_VERSION)
+            return false;
+
+        QByteArray payload(size, 0);
+        if(in.readRawData(payload.data(), size) != (int)size)
+            return false;
+        if(flags & Section_Compressed)
+            payload = qUncompress(payload);
+
+        QDataStream section(payload);
+        section.setVersion(QDataStream::Qt_4_7);
+
+        quint32 count;
+        section >> count;
+        for(quint32 i = 0; i < count && section.status() == QDataStream::Ok; ++i) {
+            ChartIndexData entry;
+            section >> entry.offset >> entry.size >> entry.name >> entry.stitches >> entry.colors;
+
+            if((qint64)entry.offset + entry.size > data.size())
+                return false;
+            index->append(entry);
+        }
+
+        return (section.status() == QDataStream::Ok && !index->isEmpty());
+    }
+
+    return false;
+}
+
+bool File_v3::readChartHeader(const QByteArray &data, ChartData *chart)
+{
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_4_7);
+
+    quint32 id;
+    quint16 version;
+    quint8 flags;
+    QByteArray payload;
+
+    in >> id >> version >> flags >> payload;
+    if(in.status() != QDataStream::Ok || id != Section_Chart || version > FILE_V3_SECTION_VERSION)
+        return false;
+
+    if(flags & Section_Compressed)
+        payload = qUncompress(payload);
+
+    QDataStream section(payload);
+    section.setVersion(QDataStream::Qt_4_7);
+    readChart(section, chart);
+
+    return (section.status() == QDataStream::Ok);
+}
+
+bool File_v3::readCharts(const QByteArray &data, QList<ChartData> *charts)
+{
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_4_7);
+
+    ChartData *chart = 0;
+    QStringList dictionary;
+
+    while(!in.atEnd()) {
+        quint32 id;
+        quint16 version;
+        quint8 flags;
+        QByteArray payload;
+
+        in >> id >> version >> flags >> payload;
+        if(in.status() != QDataStream::Ok)
+            return false;
+
+        if(flags & Section_Compressed)
+            payload = qUncompress(payload);
+
+        bool known = (id == Section_Chart || id == Section_Dictionary || id == Section_Cells ||
+                      id == Section_Images || id == Section_Indicators || id == Section_ItemIds);
+
+        //skip sections added by newer versions, but not newer versions of the sections we need.
+        if(!known)
+            continue;
+        if(version > FILE_V3_SECTION_VERSION)
+            return false;
+
+        QDataStream section(payload);
+        section.setVersion(QDataStream::Qt_4_7);
+
+        if(id == Section_Chart) {
+            charts->append(ChartData());
+            chart = &charts->last();
+            dictionary.clear();
+            readChart(section, chart);
+            continue;
+        }
+
+        //everything else belongs to the last chart.
+        if(!chart)
+            return false;
+
+        switch(id) {
+            case Section_Dictionary:
+                section >> dictionary;
+                break;
+            case Section_Cells:
+                readCells(section, &chart->cells, dictionary);
+                break;
+            case Section_Images:
+                readImages(section, &chart->images);
+                break;
+            case Section_Indicators:
+                readIndicators(section, &chart->indicators);
+                break;
+            case Section_ItemIds:
+                readItemIds(section, chart);
+                break;
+            default:
+                break;
+        }
+
+        if(section.status() != QDataStream::Ok)
+            return false;
+    }
+
+    return true;
+}
+
+QByteArray File_v3::writeChart(const ChartData &chart)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_7);
+
+    out << chart.name << (qint32)chart.style;
+    out << chart.hasDefaultSt << chart.defaultSt;
+    out << chart.hasSize << chart.size;
+    out << chart.hasCenter << chart.center;
+    out << chart.hasGuidelines << chart.guidelineType
+        << (qint32)chart.guidelineRows << (qint32)chart.guidelineColumns
+        << (qint32)chart.guidelineCellWidth << (qint32)chart.guidelineCellHeight;
+    out << chart.hasRowSpacing << chart.rowSpacing;
+
+    out << (quint32)chart.gridRows.count();
+    foreach(int cols, chart.gridRows)
+        out << (qint32)cols;
+
+    out << (quint32)chart.layers.count();
+    foreach(const LayerData &layer, chart.layers)
+        out << layer.name << (quint32)layer.uid << layer.visible;
+
+    out << (qint32)chart.groupCount;
+
+    return data;
+}
+
+void File_v3::readChart(QDataStream &in, ChartData *chart)
+{
+    qint32 style, rows, columns, cellWidth, cellHeight, groupCount;
+    quint32 count;
+
+    in >> chart->name >> style;
+    in >> chart->hasDefaultSt >> chart->defaultSt;
+    in >> chart->hasSize >> chart->size;
+    in >> chart->hasCenter >> chart->center;
+    in >> chart->hasGuidelines >> chart->guidelineType
+       >> rows >> columns >> cellWidth >> cellHeight;
+    in >> chart->hasRowSpacing >> chart->rowSpacing;
+
+    chart->style = style;
+    chart->guidelineRows = rows;
+    chart->guidelineColumns = columns;
+    chart->guidelineCellWidth = cellWidth;
+    chart->guidelineCellHeight = cellHeight;
+
+    in >> count;
+    for(quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint32 cols;
+        in >> cols;
+        chart->gridRows.append(cols);
+    }
+
+    in >> count;
+    for(quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        LayerData layer;
+        quint32 uid;
+        in >> layer.name >> uid >> layer.visible;
+        layer.uid = uid;
+        chart->layers.append(layer);
+    }
+
+    in >> groupCount;
+    chart->groupCount = groupCount;
+}
+
+void File_v3::writeItemColumns(QDataStream &out, const QList<const ItemData*> &items)
+{
+    foreach(const ItemData *item, items)
+        out << (quint32)item->layer;
+    foreach(const ItemData *item, items)
+        out << (qint32)item->group;
+
+    for(int field = 0; field < Field_Count; ++field) {
+        foreach(const ItemData *item, items)
+            out << itemField(item, field);
+    }
+}
+
+void File_v3::readItemColumns(QDataStream &in, const QList<ItemData*> &items)
+{
+    int count = items.count();
+
+    for(int i = 0; i < count; ++i) {
+        quint32 layer;
+        in >> layer;
+        items.at(i)->layer = layer;
+    }
+    for(int i = 0; i < count; ++i) {
+        qint32 group;
+        in >> group;
+        items.at(i)->group = group;
+    }
+
+    QVector<double> columns(count * Field_Count);
+    for(int field = 0; field < Field_Count; ++field) {
+        for(int i = 0; i < count; ++i)
+            in >> columns[field * count + i];
+    }
+
+    double values[Field_Count];
+    for(int i = 0; i < count; ++i) {
+        for(int field = 0; field < Field_Count; ++field)
+            values[field] = columns.at(field * count + i);
+        setItemFields(items.at(i), values);
+    }
+}
+
+QByteArray File_v3::writeCells(const QList<CellData> &cells, QStringList *dictionary)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_7);
+
+    QHash<QString, quint32> ids;
+    QList<const ItemData*> items;
+
+    out << (quint32)cells.count();
+
+    foreach(const CellData &cell, cells)
+        out << dictionaryId(cell.stitch, dictionary, &ids);
+    foreach(const CellData &cell, cells)
+        out << dictionaryId(cell.color, dictionary, &ids);
+    foreach(const CellData &cell, cells)
+        out << dictionaryId(cell.bgColor, dictionary, &ids);
+    foreach(const CellData &cell, cells)
+        out << (qint32)cell.row;
+    foreach(const CellData &cell, cells) {
+        out << (qint32)cell.column;
+        items.append(&cell);
+    }
+
+    writeItemColumns(out, items);
+
+    return data;
+}
+
+void File_v3::readCells(QDataStream &in, QList<CellData> *cells, const QStringList &dictionary)
+{
+    quint32 count;
+    in >> count;
+    if(in.status() != QDataStream::Ok)
+        return;
+
+    //stitch, color and bg color ids, row, column, layer and group then the item fields.
+    const qint64 cellSize = 7 * sizeof(quint32) + Field_Count * sizeof(double);
+    if(count > in.device()->bytesAvailable() / cellSize) {
+        in.setStatus(QDataStream::ReadCorruptData);
+        return;
+    }
+
+    QVector<quint32> ids(count * 3);
+    for(int i = 0; i < ids.count() && in.status() == QDataStream::Ok; ++i)
+        in >> ids[i];
+    if(in.status() != QDataStream::Ok)
+        return;
+
+    int first = cells->count();
+    QList<ItemData*> items;
+    for(quint32 i = 0; i < count; ++i) {
+        cells->append(CellData());
+        items.append(&(*cells)[first + i]);
+    }
+
+    for(quint32 i = 0; i < count; ++i) {
+        CellData &cell = (*cells)[first + i];
+        cell.stitch = dictionary.value(ids.at(i));
+        cell.color = dictionary.value(ids.at(count + i));
+        cell.bgColor = dictionary.value(ids.at(2 * count + i));
+    }
+
+    for(quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint32 row;
+        in >> row;
+        (*cells)[first + i].row = row;
+    }
+    for(quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint32 column;
+        in >> column;
+        (*cells)[first + i].column = column;
+    }
+
+    readItemColumns(in, items);
+}
+
+QByteArray File_v3::writeImages(const QList<ChartImageData> &images)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_7);
+
+    QList<const ItemData*> items;
+
+    out << (quint32)images.count();
+    foreach(const ChartImageData &image, images) {
+        out << image.filename;
+        items.append(&image);
+    }
+
+    writeItemColumns(out, items);
+
+    return data;
+}
+
+void File_v3::readImages(QDataStream &in, QList<ChartImageData> *images)
+{
+    quint32 count;
+    in >> count;
+
+    int first = images->count();
+    QList<ItemData*> items;
+    for(quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        ChartImageData image;
+        in >> image.filename;
+        images->append(image);
+    }
+    for(int i = first; i < images->count(); ++i)
+        items.append(&(*images)[i]);
+
+    readItemColumns(in, items);
+}
+
+QByteArray File_v3::writeIndicators(const QList<IndicatorData> &indicators)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_7);
+
+    QList<const ItemData*> items;
+
+    out << (quint32)indicators.count();
+    foreach(const IndicatorData &i, indicators) {
+        out << i.text << i.textColor << i.bgColor << i.style
+            << i.fontName << (qint32)i.fontSize << i.fontUsed;
+        items.append(&i);
+    }
+
+    writeItemColumns(out, items);
+
+    return data;
+}
+
+void File_v3::readIndicators(QDataStream &in, QList<IndicatorData> *indicators)
+{
+    quint32 count;
+    in >> count;
+
+    int first = indicators->count();
+    QList<ItemData*> items;
+    for(quint32 c = 0; c < count && in.status() == QDataStream::Ok; ++c) {
+        IndicatorData i;
+        qint32 fontSize;
+        in >> i.text >> i.textColor >> i.bgColor >> i.style
+           >> i.fontName >> fontSize >> i.fontUsed;
+        i.fontSize = fontSize;
+        indicators->append(i);
+    }
+    for(int i = first; i < indicators->count(); ++i)
+        items.append(&(*indicators)[i]);
+
+    readItemColumns(in, items);
+}
+
+QByteArray File_v3::writeItemIds(const ChartData &chart)
+{
+    QVector<quint32> ids;
+    bool hasIds = false;
+
+    foreach(const CellData &c, chart.cells)
+        ids.append(c.id);
+    foreach(const ChartImageData &c, chart.images)
+        ids.append(c.id);
+    foreach(const IndicatorData &i, chart.indicators)
+        ids.append(i.id);
+
+    foreach(quint32 id, ids) {
+        if(id != 0) {
+            hasIds = true;
+            break;
+        }
+    }
+
+    if(!hasIds)
+        return QByteArray();
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_7);
+    out << ids;
+
+    return data;
+}
+
+void File_v3::readItemIds(QDataStream &in, ChartData *chart)
+{
+    QVector<quint32> ids;
+    in >> ids;
+
+    //the ids are only useful if they match the items.
+    if(ids.count() != chart->itemCount())
+        return;
+
+    int i = 0;
+    for(int c = 0; c < chart->cells.count(); ++c)
+        chart->cells[c].id = ids.at(i++);
+    for(int c = 0; c < chart->images.count(); ++c)
+        chart->images[c].id = ids.at(i++);
+    for(int c = 0; c < chart->indicators.count(); ++c)
+        chart->indicators[c].id = ids.at(i++);
+}
@@ -0,0 +1,137 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef FILE_V3_H
+#define FILE_V3_H
+
+#include "file_v2.h"
+
+class QDataStream;
+
+/**
+ * The version 1.3 file format.
+ *
+ * The stitch set and colors are kept as xml like version 1.2, the charts
+ * are stored as binary sections. Each section starts with an id, a version
+ * and flags and can be compressed on its own. For each chart there is:
+ *
+ *  Chart       - the chart settings, layers, grid and groups.
+ *  Dictionary  - the stitch names and colors used by the chart.
+ *  Cells       - one array per field for all the cells, strings are
+ *                indexes into the dictionary.
+ *  Images      - the chart images, stored the same way as the cells.
+ *  Indicators  - the indicators, stored the same way as the cells.
+ *  Item ids    - the ids the autosave journal uses for the items above,
+ *                only written when the items have ids.
+ *
+ * Files with more than one chart end with an Index section listing where
+ * each chart's sections are and the stitches and colors it uses. With an
+ * index only the first chart is loaded when the file is opened, the other
+ * tabs load their items when they are first shown (see loadChart()).
+ *
+ * Loading reuses the File_v2 item creation, so both versions load
+ * the same ChartData.
+ */
+class File_v3 : public File_v2
+{
+    friend class Journal;
+public:
+    File_v3(MainWindow *mw, FileFactory* parent);
+
+    FileFactory::FileError load(QDataStream *stream);
+    FileFactory::FileError writeSnapshot(QDataStream *stream);
+
+    /**
+     * Convert charts to and from the binary sections.
+     */
+    static QByteArray writeCharts(const QList<ChartData> &charts);
+    static void writeCharts(QDataStream &out, const QList<ChartData> &charts);
+    static bool readCharts(const QByteArray &data, QList<ChartData> *charts);
+
+    /**
+     * Read the Index section from the charts of a file, returns false if there isn't one.
+     */
+    static bool readIndex(const QByteArray &data, QList<ChartIndexData> *index);
+    /**
+     * Count the stitches and colors used by @chart the same way the loaded cells are counted.
+     */
+    static void chartCounts(const ChartData &chart, QMap<QString, int> *stitches, QMap<QString, int> *colors);
+
+    /**
+     * Create the items of a tab that was opened with a pending chart.
+     */
+    FileFactory::FileError loadChart(CrochetTab* tab);
+    /**
+     * Fill in the items of @chart from the sections of a pending chart without loading them.
+     */
+    static bool pendingItems(ChartData* chart);
+
+protected:
+    void readDocument(QDataStream* stream, QByteArray* header, QByteArray* charts);
+    bool parseCharts(QByteArray data);
+    bool deferChart(CrochetTab* tab, int index);
+
+private:
+    enum SectionId {
+        Section_Chart       = 0x43485254, // CHRT
+        Section_Dictionary  = 0x44494354, // DICT
+        Section_Cells       = 0x43454c4c, // CELL
+        Section_Images      = 0x494d4753, // IMGS
+        Section_Indicators  = 0x494e4453, // INDS
+        Section_ItemIds     = 0x49544944, // ITID
+        Section_Index       = 0x494e4458  // INDX
+    };
+
+    enum SectionFlag { Section_Compressed = 0x01 };
+
+    static void writeSection(QDataStream &out, quint32 id, const QByteArray &payload);
+    /**
+     * Copy the sections of a chart that wasn't loaded, only the Chart section is written again.
+     */
+    static void copySections(QDataStream &out, const ChartData &chart);
+
+    static QByteArray writeChart(const ChartData &chart);
+    static void readChart(QDataStream &in, ChartData *chart);
+
+    static QByteArray writeCells(const QList<CellData> &cells, QStringList *dictionary);
+    static void readCells(QDataStream &in, QList<CellData> *cells, const QStringList &dictionary);
+    static QByteArray writeImages(const QList<ChartImageData> &images);
+    static void readImages(QDataStream &in, QList<ChartImageData> *images);
+    static QByteArray writeIndicators(const QList<IndicatorData> &indicators);
+    static void readIndicators(QDataStream &in, QList<IndicatorData> *indicators);
+    static QByteArray writeItemIds(const ChartData &chart);
+    static void readItemIds(QDataStream &in, ChartData *chart);
+    static QByteArray writeIndex(const QList<ChartIndexData> &index);
+    /**
+     * Read only the Chart section at the start of a chart's sections.
+     */
+    static bool readChartHeader(const QByteArray &data, ChartData *chart);
+
+    /**
+     * Write the values every item has, one column per value.
+     */
+    static void writeItemColumns(QDataStream &out, const QList<const ItemData*> &items);
+    static void readItemColumns(QDataStream &in, const QList<ItemData*> &items);
+
+    //the index of the file being loaded, charts after the first keep their sections.
+    QList<ChartIndexData> mIndex;
+};
+
+#endif // FILE_V3_H
@@ -21,6 +21,8 @@
 #include "filefactory.h"
 #include "file_v1.h"
 #include "file_v2.h"
+#include "file_v3.h"
+#include "crochettab.h"
 
 #include <QObject>
 
@@ -34,6 +36,15 @@
 #include <QXmlStreamWriter>
 
 #include <QTemporaryFile>
+#include <QtConcurrentRun>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <io.h>
+#else
+#include <stdio.h>
+#include <unistd.h>
+#endif
 
 #include "crochettab.h"
 
@@ -47,7 +58,8 @@
 FileFactory::FileFactory(QWidget* parent) :
     isSaved(false),
     fileName(""),
-    mFileVersion(FileFactory::Version_1_2),
+    mCurrentFileVersion(FileFactory::Version_1_3),
+    mFileVersion(FileFactory::Version_1_3),
     mParent(parent)
 {
     mMainWindow = static_cast<MainWindow*>(mParent);
@@ -97,12 +109,60 @@ FileFactory::FileError FileFactory::load()
     } else if(version == FileFactory::Version_1_2) {
         in.setVersion(QDataStream::Qt_4_7);
         fileLoad = new File_v2(mMainWindow, this);
+    } else if(version == FileFactory::Version_1_3) {
+        in.setVersion(QDataStream::Qt_4_7);
+        fileLoad = new File_v3(mMainWindow, this);
     }
 
+    //keep saving newer files in the format they were opened with.
+    if(version >= FileFactory::Version_1_2)
+        mCurrentFileVersion = version;
+
     return fileLoad->load(&in);
 }
 
+FileFactory::FileError FileFactory::loadChart(CrochetTab *tab)
+{
+    if(!tab || !tab->hasPendingChart())
+        return FileFactory::No_Error;
+
+    File_v3 fileLoad(mMainWindow, this);
+    return fileLoad.loadChart(tab);
+}
+
+FileFactory::FileError FileFactory::loadPendingCharts()
+{
+    for(int i = 0; i < mTabWidget->count(); ++i) {
+        FileFactory::FileError err = loadChart(qobject_cast<CrochetTab*>(mTabWidget->widget(i)));
+        if(err != FileFactory::No_Error)
+            return err;
+    }
+
+    return FileFactory::No_Error;
+}
+
 FileFactory::FileError FileFactory::save(FileVersion version)
+{
+    return writeFile(snapshot(version), fileName);
+}
+
+QFuture<FileFactory::FileError> FileFactory::saveInBackground(FileVersion version)
+{
+    return QtConcurrent::run(&FileFactory::writeFile, snapshot(version), fileName);
+}
+
+QFuture<FileFactory::FileError> FileFactory::saveCopy(const QString &copyName)
+{
+    File *saveFile = 0;
+    if(mTabWidget->count() > 0) {
+        saveFile = new File_v3(mMainWindow, this);
+        saveFile->snapshot();
+    }
+
+    return QtConcurrent::run(&FileFactory::writeFile, saveFile, copyName);
+}
+
+File* FileFactory::snapshot(FileVersion version)
 {
     if(version == FileFactory::Version_Auto) {
         version = (FileVersion)mCurrentFileVersion;
@@ -112,18 +172,7 @@ FileFactory::FileError FileFactory::save(FileVersion version)
 
     //Don't save a file without at least 1 tab.
     if(mTabWidget->count() <= 0)
-        return FileFactory::Err_NoTabsToSave;
-
-    QTemporaryFile f;
-    if(!f.open()) {
-        //TODO: some nice dialog to warn the user.
-        qWarning() << "Couldn't open file for writing..." << f.fileName();
-        return FileFactory::Err_OpeningFile;
-    }
-
-    QDataStream out(&f);
-    // Write a header with a "magic number" and a version
-    out << AppInfo::inst()->magicNumber;
+        return 0;
 
     File *saveFile = 0;
 
@@ -133,34 +182,87 @@ FileFactory::FileError FileFactory::save(FileVersion version)
             saveFile = new File_v2(mMainWindow, this);
             break;
 
+        case FileFactory::Version_1_3:
+            saveFile = new File_v3(mMainWindow, this);
+            break;
+
         case FileFactory::Version_1_0:
+            //version 1.0 is written from the scenes.
+            loadPendingCharts();
             saveFile = new File_v1(mMainWindow, this);
             break;
     }
 
-    int error = saveFile->save(&out);
+    saveFile->snapshot();
+    return saveFile;
+}
 
-    f.close();
+FileFactory::FileError FileFactory::writeFile(File *saveFile, QString fileName)
+{
+    if(!saveFile)
+        return FileFactory::Err_NoTabsToSave;
+
+    //write next to the save file so it can be renamed over it.
+    QString target = fileName;
+    QFileInfo info(fileName);
+    if(info.isSymLink())
+        target = info.symLinkTarget();
+
+    QTemporaryFile f(target + ".XXXXXX");
+    if(!f.open()) {
+        //TODO: some nice dialog to warn the user.
+        qWarning() << "Couldn't open file for writing..." << f.fileName();
+        delete saveFile;
+        return FileFactory::Err_OpeningFile;
+    }
+
+    QDataStream out(&f);
+    // Write a header with a "magic number" and a version
+    out << AppInfo::inst()->magicNumber;
+
+    int error = saveFile->writeSnapshot(&out);
+    delete saveFile;
 
     if(error != FileFactory::No_Error)
         return (FileFactory::FileError)error;
 
-    QDir d(QFileInfo(fileName).path());
-    //only try to delete the file if it exists.
-    if(d.exists(fileName)) {
-        if(!d.remove(fileName))
-            return FileFactory::Err_RemovingOrigFile;
-    }
+    if(!f.flush())
+        return FileFactory::Err_SavingFile;
 
-    if(!f.copy(fileName)) {
-        qDebug() << "Could not write final output file." << f.fileName() << fileName;
+    //keep the permissions of the file we're replacing.
+    if(QFileInfo(target).exists())
+        f.setPermissions(QFile::permissions(target));
+
+    if(!replaceFile(&f, target)) {
+        qWarning() << "Could not write final output file." << f.fileName() << target;
         return FileFactory::Err_RenamingTempFile;
     }
 
+    f.setAutoRemove(false);
+
     return FileFactory::No_Error;
 }
 
-void FileFactory::cleanUp()
+bool FileFactory::replaceFile(QFile *file, const QString &target)
 {
-
+#if defined(Q_OS_WIN)
+    QString from = QDir::toNativeSeparators(file->fileName());
+    QString to = QDir::toNativeSeparators(target);
+
+    FlushFileBuffers((HANDLE)_get_osfhandle(file->handle()));
+    file->close();
+
+    return MoveFileExW((wchar_t*)from.utf16(), (wchar_t*)to.utf16(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    QByteArray from = QFile::encodeName(file->fileName());
+    QByteArray to = QFile::encodeName(target);
+
+    //make sure the data is on the disk before the old file is replaced.
+    if(fsync(file->handle()) != 0)
+        return false;
+    file->close();
+
+    return rename(from.constData(), to.constData()) == 0;
+#endif
 }
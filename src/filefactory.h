@@ -32,15 +32,21 @@ class QXmlStreamWriter;
 #endif //Q_WS_MAC
 
 #include <QTableWidget>
+#include <QFuture>
 class MainWindow;
+class CrochetTab;
+class File;
+class QFile;
 
 class FileFactory
 {
 public:
     friend class File_v1;
     friend class File_v2;
+    friend class File_v3;
+    friend class Journal;
 
-    enum FileVersion { Version_1_0 = 100, Version_1_2 = 102, Version_Auto = 255 };
+    enum FileVersion { Version_1_0 = 100, Version_1_2 = 102, Version_1_3 = 103, Version_Auto = 255 };
     enum FileError { No_Error,
                     Err_OpeningFile,         //could not open file for reading or writing
                     Err_WrongFileType,       //magic number doesn't match
@@ -49,14 +55,23 @@ public:
                     Err_GettingFileContents, //get the xml file content
                     Err_NoTabsToSave,        //don't save the file we don't have any tabs
                     Err_RemovingOrigFile,    //couldn't remove the save file
-                    Err_RenamingTempFile,    //couldn't copy temp file to the save file name
+                    Err_RenamingTempFile,    //couldn't rename the temp file to the save file name
                     Err_SavingFile,
-                    Err_LoadingFile
+                    Err_LoadingFile,
+                    Err_LoadCancelled        //the user canceled loading the file
                     };
 
     FileFactory(QWidget *parent);
 
     FileFactory::FileError load();
+    /**
+     * Load the items of a tab that was opened without them.
+     */
+    FileFactory::FileError loadChart(CrochetTab *tab);
+    /**
+     * Load every tab that is still waiting for its items.
+     */
+    FileFactory::FileError loadPendingCharts();
 
     /**
      * @brief save - save the file.
@@ -64,6 +79,16 @@ public:
      * @return
      */
     FileFactory::FileError save(FileVersion saveVersion = FileFactory::Version_Auto);
+    /**
+     * Copy the document and write the copy on a worker thread,
+     * the document can be edited while the file is written.
+     */
+    QFuture<FileFactory::FileError> saveInBackground(FileVersion saveVersion = FileFactory::Version_Auto);
+    /**
+     * Write a version 1.3 copy of the document to @copyName in the background
+     * without changing the file name or the version the document is saved as.
+     */
+    QFuture<FileFactory::FileError> saveCopy(const QString &copyName);
 
     /**
      * @brief isOldFileVersion - tells the software that the file loaded was from a previous savefile version.
@@ -81,6 +106,21 @@ public:
     QString fileName;
 
 private:
+    /**
+     * Create the File for @version and copy the document into it,
+     * returns 0 if there is nothing to save.
+     */
+    File* snapshot(FileVersion version);
+    /**
+     * Write @saveFile's snapshot to @fileName and delete @saveFile, runs on a worker thread.
+     */
+    static FileFactory::FileError writeFile(File *saveFile, QString fileName);
+
+    /**
+     * Flush @file to the disk and rename it over @target in one step,
+     * so there is always a complete save file on the disk.
+     */
+    static bool replaceFile(QFile *file, const QString &target);
 
     //mCurrentFileVersion is the fileVersion of the save file we're working with.
     qint32 mCurrentFileVersion;
@@ -22,11 +22,177 @@
 
 #include <QDebug>
 #include <QGraphicsSceneMouseEvent>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
 
-Guideline::Guideline(const QRectF &rect, QGraphicsItem *parent, QGraphicsScene *scene) :
-    QGraphicsEllipseItem(rect, parent, scene)
+#include <math.h>
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+Guideline::Guideline(QGraphicsItem *parent, QGraphicsScene *scene) :
+    QGraphicsItem(parent, scene),
+    mColumns(0),
+    mRows(0),
+    mSpacingW(0),
+    mSpacingH(0)
 {
     setAcceptedMouseButtons(0);
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    setZValue(-1);
+}
+
+QRectF Guideline::boundingRect() const
+{
+    return mBounds;
+}
+
+void Guideline::setGrid(QString type, int columns, int rows, int spacingW, int spacingH)
+{
+    prepareGeometryChange();
+
+    mType = type;
+    mColumns = qMax(0, columns);
+    mRows = qMax(0, rows);
+    mSpacingW = spacingW;
+    mSpacingH = spacingH;
+
+    if(mType == "Rows") {
+        mBounds = QRectF(0, 0, mSpacingW * mColumns, mSpacingH * mRows);
+    } else if(mType == "Rounds") {
+        qreal radius = mSpacingH * (mRows + 1);
+        mBounds = QRectF(-radius, -radius, 2 * radius, 2 * radius);
+    } else if(mType == "Triangles") {
+        qreal maxX = mRows * mSpacingW / 2;
+        mBounds = QRectF(-maxX, 0, 2 * maxX, mRows * mSpacingH);
+    } else {
+        mBounds = QRectF();
+    }
+
+    //leave room for the pen.
+    mBounds = mBounds.normalized().adjusted(-1, -1, 1, 1);
+    update();
+}
+
+void Guideline::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(widget);
+
+    QRectF exposed = option->exposedRect.intersected(mBounds);
+    if(exposed.isEmpty())
+        return;
+
+    painter->setPen(QPen());
+    painter->setBrush(Qt::NoBrush);
+
+    if(mType == "Rows")
+        paintRows(painter, exposed);
+    else if(mType == "Rounds")
+        paintRounds(painter, exposed);
+    else if(mType == "Triangles")
+        paintTriangles(painter, exposed);
+}
+
+void Guideline::paintRows(QPainter *painter, const QRectF &exposed)
+{
+    if(mSpacingW <= 0 || mSpacingH <= 0)
+        return;
+
+    qreal width = mSpacingW * mColumns;
+    qreal height = mSpacingH * mRows;
+
+    //only the lines that cross the exposed area, clipped to it.
+    int firstCol = qMax(0, (int)ceil(exposed.left() / mSpacingW));
+    int lastCol = qMin(mColumns, (int)floor(exposed.right() / mSpacingW));
+    int firstRow = qMax(0, (int)ceil(exposed.top() / mSpacingH));
+    int lastRow = qMin(mRows, (int)floor(exposed.bottom() / mSpacingH));
+
+    qreal top = qMax(qreal(0), exposed.top());
+    qreal bottom = qMin(height, exposed.bottom());
+    qreal left = qMax(qreal(0), exposed.left());
+    qreal right = qMin(width, exposed.right());
+
+    QVector<QLineF> lines;
+    for(int c = firstCol; c <= lastCol; ++c)
+        lines.append(QLineF(c * mSpacingW, top, c * mSpacingW, bottom));
+    for(int r = firstRow; r <= lastRow; ++r)
+        lines.append(QLineF(left, r * mSpacingH, right, r * mSpacingH));
+
+    painter->drawLines(lines);
+}
+
+void Guideline::paintRounds(QPainter *painter, const QRectF &exposed)
+{
+    if(mSpacingH <= 0)
+        return;
+
+    //dividing lines
+    QVector<QLineF> lines;
+    for(int c = 0; c <= mColumns && mColumns > 0; ++c) {
+        qreal radians = (360.0 / mColumns * c) * M_PI / 180;
+        QLineF line(mSpacingH * sin(radians), mSpacingH * cos(radians),
+                    (mSpacingH * (mRows + 1)) * sin(radians), (mSpacingH * (mRows + 1)) * cos(radians));
+
+        QRectF lineRect = QRectF(line.p1(), line.p2()).normalized().adjusted(-1, -1, 1, 1);
+        if(exposed.intersects(lineRect))
+            lines.append(line);
+    }
+    painter->drawLines(lines);
+
+    //circles, skip the ones that pass entirely inside or outside the exposed area.
+    qreal nearX = qBound(exposed.left(), qreal(0), exposed.right());
+    qreal nearY = qBound(exposed.top(), qreal(0), exposed.bottom());
+    qreal nearest = sqrt(nearX * nearX + nearY * nearY);
+
+    qreal farX = qMax(fabs(exposed.left()), fabs(exposed.right()));
+    qreal farY = qMax(fabs(exposed.top()), fabs(exposed.bottom()));
+    qreal farthest = sqrt(farX * farX + farY * farY);
+
+    int first = qMax(0, (int)floor(nearest / mSpacingH) - 2);
+    int last = qMin(mRows, (int)ceil(farthest / mSpacingH));
+    for(int r = first; r <= last; ++r) {
+        qreal radius = (r + 1) * mSpacingH;
+        painter->drawEllipse(QPointF(0, 0), radius, radius);
+    }
+}
+
+void Guideline::paintTriangles(QPainter *painter, const QRectF &exposed)
+{
+    if(mRows <= 0)
+        return;
+
+    QVector<QLineF> lines;
+
+    //horizontal lines
+    for(int r = 0; r < mRows; ++r) {
+        qreal height = (r + 1) * mSpacingH;
+        if(height < exposed.top() - 1 || height > exposed.bottom() + 1)
+            continue;
+
+        qreal offsetX = (r + 1) * mSpacingW / 2;
+        lines.append(QLineF(-offsetX, height, offsetX, height));
+    }
+
+    //slanted lines
+    qreal maxX = mRows * mSpacingW / 2;
+    qreal maxY = mRows * mSpacingH;
+    for(int c = 0; c < mRows; ++c) {
+        qreal startX = -maxX + (2 * c * (maxX / mRows));
+        qreal startY = maxY;
+        qreal endX = maxX - ((mRows - c) * (maxX / mRows));
+        qreal endY = c * maxY / mRows;
+
+        QLineF left(startX, startY, endX, endY);
+        QLineF right(-startX, startY, -endX, endY);
+
+        if(exposed.intersects(QRectF(left.p1(), left.p2()).normalized().adjusted(-1, -1, 1, 1)))
+            lines.append(left);
+        if(exposed.intersects(QRectF(right.p1(), right.p2()).normalized().adjusted(-1, -1, 1, 1)))
+            lines.append(right);
+    }
+
+    painter->drawLines(lines);
 }
 
 void Guideline::mousePressEvent(QGraphicsSceneMouseEvent *event)
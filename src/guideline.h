@@ -21,21 +21,50 @@
 #ifndef GUIDELINE_H
 #define GUIDELINE_H
 
-#include <QGraphicsEllipseItem>
+#include <QGraphicsItem>
+#include <QString>
 
-class Guideline : public QGraphicsEllipseItem
+/**
+ * Draws the guidelines behind the chart as a single item.
+ *
+ * The lines and circles are computed from the grid values when painting,
+ * with the chart center at (0,0) in item coordinates. Moving the center
+ * only moves the item, and only the lines in the exposed area are drawn.
+ */
+class Guideline : public QGraphicsItem
 {
 public:
-    explicit Guideline(const QRectF &rect, QGraphicsItem *parent = 0, QGraphicsScene *scene = 0);
+    explicit Guideline(QGraphicsItem *parent = 0, QGraphicsScene *scene = 0);
 
     enum { Type = UserType + 5 };
 
     int type () const { return Guideline::Type; }
 
+    QRectF boundingRect() const;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0);
+
+    /**
+     * @type is one of "Rows", "Rounds" or "Triangles".
+     */
+    void setGrid(QString type, int columns, int rows, int spacingW, int spacingH);
+
 protected:
     void mousePressEvent(QGraphicsSceneMouseEvent *event);
     void mouseMoveEvent(QGraphicsSceneMouseEvent *event);
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
+
+private:
+    void paintRows(QPainter *painter, const QRectF &exposed);
+    void paintRounds(QPainter *painter, const QRectF &exposed);
+    void paintTriangles(QPainter *painter, const QRectF &exposed);
+
+    QString mType;
+    int mColumns;
+    int mRows;
+    int mSpacingW;
+    int mSpacingH;
+
+    QRectF mBounds;
 };
 
 #endif // GUIDELINE_H
@@ -0,0 +1,115 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "iconstore.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include "debug.h"
+
+// Global static pointer
+IconStore* IconStore::mInstance = NULL;
+
+// singleton constructor:
+IconStore* IconStore::inst()
+{
+   if (!mInstance)   // Only allow one instance of the icon store.
+      mInstance = new IconStore();
+   return mInstance;
+}
+
+IconStore::IconStore()
+{
+}
+
+IconStore::~IconStore()
+{
+    mIcons.clear();
+}
+
+QString IconStore::addIcon(const QByteArray &data, const QString &fileName)
+{
+    QString key = QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+
+    QMutexLocker locker(&mMutex);
+    if(!mIcons.contains(key))
+        mIcons.insert(key, data);
+
+    return prefix() + key + "/" + QFileInfo(fileName).fileName();
+}
+
+QString IconStore::iconKey(const QString &path)
+{
+    return path.mid(prefix().length()).section('/', 0, 0);
+}
+
+QByteArray IconStore::iconData(const QString &path)
+{
+    if(isStored(path)) {
+        QMutexLocker locker(&mMutex);
+        QHash<QString, QByteArray>::const_iterator it = mIcons.constFind(iconKey(path));
+        if(it != mIcons.constEnd())
+            return it.value();
+
+        WARN("icon not found in the icon store: " + path);
+        return QByteArray();
+    }
+
+    QFile f(path);
+    if(!f.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return f.readAll();
+}
+
+QPixmap IconStore::pixmap(const QString &path)
+{
+    if(!isStored(path))
+        return QPixmap(path);
+
+    QPixmap pix;
+    pix.loadFromData(iconData(path));
+    return pix;
+}
+
+QIcon IconStore::icon(const QString &path)
+{
+    if(!isStored(path))
+        return QIcon(path);
+
+    return QIcon(pixmap(path));
+}
+
+int IconStore::count()
+{
+    QMutexLocker locker(&mMutex);
+    return mIcons.count();
+}
+
+qint64 IconStore::size()
+{
+    QMutexLocker locker(&mMutex);
+    qint64 total = 0;
+    foreach(const QByteArray &data, mIcons)
+        total += data.size();
+    return total;
+}
@@ -0,0 +1,84 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef ICONSTORE_H
+#define ICONSTORE_H
+
+#include <QHash>
+#include <QByteArray>
+#include <QString>
+#include <QMutex>
+#include <QPixmap>
+#include <QIcon>
+
+/**
+ * The IconStore keeps the icons embedded in open documents in memory.
+ *
+ * Icons are keyed by a hash of their contents so the same icon used by
+ * several documents is only stored once. A stored icon is referred to by
+ * a path like "embedded:<hash>/<file name>", which can be used anywhere a
+ * stitch file path is expected as long as the icon is read with iconData()
+ * or pixmap() instead of from disk.
+ *
+ * Icons stay in the store until the program exits, stitches copied from a
+ * document into the library may still use them after the document is closed.
+ *
+ * The store can be read from worker threads while a document is saved.
+ */
+class IconStore
+{
+public:
+    static IconStore* inst();
+    ~IconStore();
+
+    /**
+     * Store @data and return the path to use for it, @fileName is kept
+     * at the end of the path so the file type can still be found.
+     */
+    QString addIcon(const QByteArray &data, const QString &fileName);
+
+    static bool isStored(const QString &path) { return path.startsWith(prefix()); }
+
+    /**
+     * The contents of the icon at @path, from the store or from the file.
+     */
+    QByteArray iconData(const QString &path);
+    QPixmap pixmap(const QString &path);
+    QIcon icon(const QString &path);
+
+    int count();
+    /**
+     * The total size of the stored icons, in bytes.
+     */
+    qint64 size();
+
+private:
+    IconStore();
+
+    static QString prefix() { return QString("embedded:"); }
+    static QString iconKey(const QString &path);
+
+    static IconStore *mInstance;
+
+    QMutex mMutex;
+    QHash<QString, QByteArray> mIcons;
+};
+
+#endif // ICONSTORE_H
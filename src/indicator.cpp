@@ -38,7 +38,8 @@
 
 Indicator::Indicator(QGraphicsItem* parent, QGraphicsScene* scene)
     : QGraphicsTextItem(parent, scene),
-      highlight(false)
+      highlight(false),
+      mLayer(0)
 {
     setFlag(QGraphicsItem::ItemIsMovable);
     setFlag(QGraphicsItem::ItemIsSelectable);
@@ -46,10 +47,27 @@ Indicator::Indicator(QGraphicsItem* parent, QGraphicsScene* scene)
     setZValue(150);
 	
     mStyle = Settings::inst()->value("chartRowIndicator").toString();
+
+    //itemChange isn't called for the scene set in the base class constructor.
+    if(scene)
+        Scene::layerItemChange(this, mLayer, ItemSceneHasChanged);
 }
 
 Indicator::~Indicator()
 {
+    Scene::layerItemChange(this, mLayer, ItemSceneChange);
+}
+
+QVariant Indicator::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    Scene::layerItemChange(this, mLayer, change);
+    return QGraphicsTextItem::itemChange(change, value);
+}
+
+void Indicator::setLayer(unsigned int layer)
+{
+    Scene::layerItemMoved(this, mLayer, layer);
+    mLayer = layer;
 }
 
 QRectF Indicator::boundingRect() const
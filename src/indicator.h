@@ -63,7 +63,7 @@ public:
     bool highlight;
 	
 	unsigned int layer() { return mLayer; }
-	void setLayer(unsigned int layer) { mLayer = layer; }
+	void setLayer(unsigned int layer);
 
 signals:
     void lostFocus(Indicator *item);
@@ -74,6 +74,7 @@ protected:
     void focusOutEvent(QFocusEvent* event);
     void keyReleaseEvent(QKeyEvent* event);
     void mouseReleaseEvent(QGraphicsSceneMouseEvent* event);
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value);
 
 private:
 	//the layer of the indicator
@@ -42,6 +42,8 @@ public:
 
     int id() const { return Id; }
 
+    Indicator* indicator() const { return item; }
+
 private:
     QPointF position;
 
@@ -61,6 +63,8 @@ public:
 
     int id() const { return Id; }
 
+    Indicator* indicator() const { return item; }
+
 private:
     QPointF position;
     Indicator* item;
@@ -81,6 +85,8 @@ public:
 
     int id() const { return Id; }
 
+    Indicator* indicator() const { return i; }
+
 private:
     Indicator* i;
     QString newText;
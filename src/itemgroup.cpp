@@ -23,9 +23,11 @@
 #include <QGraphicsSceneEvent>
 #include "ChartItemTools.h"
 #include "debug.h"
+#include "scene.h"
 
 ItemGroup::ItemGroup(QGraphicsItem *parent, QGraphicsScene *scene)
     : QGraphicsItemGroup( parent, scene),
+    mLayer(0),
     mScale(QPointF(1.0, 1.0))
 {
     setTransform(QTransform(1,0,0,0,1,0,0,0,1));
@@ -36,10 +38,27 @@ ItemGroup::ItemGroup(QGraphicsItem *parent, QGraphicsScene *scene)
     setFlag(QGraphicsItem::ItemIsMovable);
     setFlag(QGraphicsItem::ItemIsSelectable);
     setHandlesChildEvents(true);
+
+    //itemChange isn't called for the scene set in the base class constructor.
+    if(scene)
+        Scene::layerItemChange(this, mLayer, ItemSceneHasChanged);
 }
 
 ItemGroup::~ItemGroup()
 {
+    Scene::layerItemChange(this, mLayer, ItemSceneChange);
+}
+
+QVariant ItemGroup::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    Scene::layerItemChange(this, mLayer, change);
+    return QGraphicsItemGroup::itemChange(change, value);
+}
+
+void ItemGroup::setLayer(unsigned int layer)
+{
+    Scene::layerItemMoved(this, mLayer, layer);
+    mLayer = layer;
 }
 
 QRectF ItemGroup::boundingRect() const
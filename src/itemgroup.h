@@ -42,7 +42,11 @@ public:
     void addToGroup(QGraphicsItem *item);
 	
 	unsigned int layer() { return mLayer; }
-	void setLayer(unsigned int layer) { mLayer = layer; }
+	void setLayer(unsigned int layer);
+
+protected:
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value);
+
 private:
 	//the layer of the group
 	unsigned int mLayer;
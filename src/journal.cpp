@@ -0,0 +1,766 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "journal.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include <QDataStream>
+#include <QTabWidget>
+#include <QGraphicsItem>
+#include <QCoreApplication>
+#include <QHash>
+#include <QSet>
+
+#include "crochettab.h"
+#include "scene.h"
+#include "cell.h"
+#include "stitch.h"
+#include "ChartImage.h"
+#include "indicator.h"
+#include "itemgroup.h"
+#include "ChartItemTools.h"
+#include "crochetchartcommands.h"
+#include "undostack.h"
+#include "file_v3.h"
+#include "settings.h"
+#include "appinfo.h"
+#include "debug.h"
+
+#define JOURNAL_MAGIC 0x434a524e // CJRN
+#define JOURNAL_VERSION 1
+//QGraphicsItem::data() key holding the item id.
+#define JOURNAL_ITEM_KEY 0x4a49
+//a journal that hasn't been written to for this long was left behind by a crash.
+#define JOURNAL_STALE_SECS 180
+//how often an idle journal is touched so it doesn't look abandoned.
+#define JOURNAL_ALIVE_SECS 60
+//write a checkpoint early when the journal grows past this size.
+#define JOURNAL_MAX_SIZE (8 * 1024 * 1024)
+
+static void writeJournalHeader(QIODevice *device)
+{
+    QDataStream out(device);
+    out << (quint32)JOURNAL_MAGIC << (quint16)JOURNAL_VERSION;
+}
+
+void Journal::itemGeometry(Scene *scene, QGraphicsItem *item, ItemData *data)
+{
+    ItemGroup *g = qgraphicsitem_cast<ItemGroup*>(item->parentItem());
+    if(g) {
+        //keep the whole transform, the same as the cell store does.
+        data->group = scene->mGroups.indexOf(g);
+        data->position = item->scenePos();
+        data->transform = item->sceneTransform() * QTransform::fromTranslate(-data->position.x(), -data->position.y());
+        return;
+    }
+
+    data->position = item->pos();
+    data->scaleX = ChartItemTools::getScaleX(item);
+    data->scaleY = ChartItemTools::getScaleY(item);
+    data->pivotScale = ChartItemTools::getScalePivot(item);
+    data->rotation = ChartItemTools::getRotation(item);
+    data->pivotRotation = ChartItemTools::getRotationPivot(item);
+    data->pivotPoint = item->transformOriginPoint();
+}
+
+CellData Journal::cellData(Scene *scene, Cell *c)
+{
+    CellData cell;
+    cell.id = itemId(c);
+    cell.stitch = c->stitch() ? c->stitch()->name() : QString();
+    cell.layer = c->layer();
+
+    QPoint pt = scene->indexOf(c);
+    if(pt != QPoint(-1, -1)) {
+        cell.row = pt.y();
+        cell.column = pt.x();
+    }
+
+    itemGeometry(scene, c, &cell);
+    cell.color = c->color().name();
+    cell.bgColor = c->bgColor().name();
+    return cell;
+}
+
+ChartImageData Journal::imageData(Scene *scene, ChartImage *c)
+{
+    ChartImageData image;
+    image.id = itemId(c);
+    image.layer = c->layer();
+    image.filename = c->filename();
+    itemGeometry(scene, c, &image);
+    return image;
+}
+
+IndicatorData Journal::indicatorData(Scene *scene, Indicator *i)
+{
+    IndicatorData indicator;
+    indicator.id = itemId(i);
+    indicator.text = i->text();
+    indicator.textColor = i->textColor().name();
+    indicator.bgColor = i->bgColor().name();
+    indicator.style = i->style();
+    indicator.fontName = i->font().toString();
+    indicator.fontSize = i->font().pointSize();
+    indicator.fontUsed = true;
+    indicator.layer = i->layer();
+    itemGeometry(scene, i, &indicator);
+    return indicator;
+}
+
+/**
+ * Where each tracked item of a chart is while the journal is replayed.
+ */
+struct ChartIndex
+{
+    QHash<quint32, int> cells;
+    QHash<quint32, int> images;
+    QHash<quint32, int> indicators;
+    QSet<quint32> removed;
+};
+
+template<class T>
+static void indexItems(const QList<T> &list, QHash<quint32, int> *index)
+{
+    for(int i = 0; i < list.count(); ++i) {
+        if(list.at(i).id != 0)
+            index->insert(list.at(i).id, i);
+    }
+}
+
+template<class T>
+static void updateItems(QList<T> *list, QHash<quint32, int> *index, QSet<quint32> *removed, const QList<T> &items)
+{
+    foreach(const T &item, items) {
+        if(item.id == 0)
+            continue;
+
+        removed->remove(item.id);
+        QHash<quint32, int>::const_iterator it = index->constFind(item.id);
+        if(it != index->constEnd()) {
+            (*list)[it.value()] = item;
+        } else {
+            index->insert(item.id, list->count());
+            list->append(item);
+        }
+    }
+}
+
+template<class T>
+static void dropItems(QList<T> *list, const QSet<quint32> &removed, int groupCount)
+{
+    QList<T> kept;
+    foreach(T item, *list) {
+        if(item.id != 0 && removed.contains(item.id))
+            continue;
+        //the groups are only changed by checkpoints, but don't trust a damaged journal.
+        if(item.group >= groupCount)
+            item.group = -1;
+        kept.append(item);
+    }
+    *list = kept;
+}
+
+Journal::Journal(FileFactory *file, QTabWidget *tabWidget, QObject *parent)
+    : QObject(parent),
+      mFile(file),
+      mTabWidget(tabWidget),
+      mSeq(0),
+      mHasCheckpoint(false),
+      mCheckpointPending(false),
+      mCheckpointSeq(0),
+      mCheckpointOffset(-1)
+{
+    static int count = 0;
+    mKey = QString("%1-%2").arg(QCoreApplication::applicationPid()).arg(++count);
+    mJournal.setFileName(folder() + mKey + ".journal");
+
+    connect(&mTimer, SIGNAL(timeout()), SLOT(flush()));
+    connect(&mWatcher, SIGNAL(finished()), SLOT(checkpointFinished()));
+
+    if(isEnabled())
+        mTimer.start(Settings::inst()->value("autosaveInterval").toInt() * 1000);
+}
+
+Journal::~Journal()
+{
+    mWatcher.waitForFinished();
+    if(mHasCheckpoint)
+        writeBuffer();
+    mJournal.close();
+}
+
+bool Journal::isEnabled() const
+{
+    return Settings::inst()->value("autosaveInterval").toInt() > 0;
+}
+
+QString Journal::folder()
+{
+    return Settings::inst()->userSettingsFolder() + "autosave/";
+}
+
+quint32 Journal::newItemId()
+{
+    static quint32 nextId = 1;
+    return nextId++;
+}
+
+quint32 Journal::itemId(QGraphicsItem *item)
+{
+    QVariant id = item->data(JOURNAL_ITEM_KEY);
+    if(id.isValid())
+        return id.toUInt();
+
+    quint32 newId = newItemId();
+    item->setData(JOURNAL_ITEM_KEY, newId);
+    return newId;
+}
+
+void Journal::addTab(CrochetTab *tab)
+{
+    connect(tab->scene()->undoStack(), SIGNAL(commandDone(const QUndoCommand*)),
+            SLOT(commandDone(const QUndoCommand*)));
+}
+
+int Journal::tabIndex(QObject *undoStack) const
+{
+    for(int i = 0; i < mTabWidget->count(); ++i) {
+        CrochetTab *tab = qobject_cast<CrochetTab*>(mTabWidget->widget(i));
+        if(tab && tab->scene()->undoStack() == undoStack)
+            return i;
+    }
+    return -1;
+}
+
+void Journal::commandDone(const QUndoCommand *cmd)
+{
+    //the next checkpoint will have this change.
+    if(!isEnabled() || mCheckpointPending)
+        return;
+
+    int index = tabIndex(sender());
+    if(index < 0)
+        return;
+
+    //the records are changes to a checkpoint, so start with one.
+    if(!mHasCheckpoint || tabsChanged()) {
+        checkpoint();
+        return;
+    }
+
+    Scene *scene = mTabs.at(index).tab->scene();
+    QList<QGraphicsItem*> items;
+    if(!undoCommandItems(cmd, &items) || scene->cellStore()->count() > mTabs.at(index).storedCells) {
+        checkpoint();
+        return;
+    }
+
+    recordItems(index, items);
+    recordHeader(index);
+}
+
+void Journal::recordItems(int index, const QList<QGraphicsItem*> &items)
+{
+    Scene *scene = mTabs.at(index).tab->scene();
+
+    ChartData chart;
+    QVector<quint32> removed;
+    QSet<QGraphicsItem*> done;
+
+    //the stored cells that became Cells are removed by their store id and added again as Cells.
+    typedef QPair<quint32, QPointer<Cell> > MaterializedCell;
+    QList<QGraphicsItem*> all = items;
+    foreach(const MaterializedCell &m, scene->takeMaterializedCells()) {
+        removed.append(m.first);
+        if(m.second)
+            all.append(m.second.data());
+    }
+    mTabs[index].storedCells = scene->cellStore()->count();
+
+    foreach(QGraphicsItem *item, all) {
+        if(done.contains(item))
+            continue;
+        done.insert(item);
+
+        if(item->scene() != scene) {
+            removed.append(itemId(item));
+            continue;
+        }
+
+        if(Cell *c = qgraphicsitem_cast<Cell*>(item))
+            chart.cells.append(cellData(scene, c));
+        else if(ChartImage *ci = qgraphicsitem_cast<ChartImage*>(item))
+            chart.images.append(imageData(scene, ci));
+        else if(Indicator *i = qgraphicsitem_cast<Indicator*>(item))
+            chart.indicators.append(indicatorData(scene, i));
+    }
+
+    if(chart.itemCount() > 0) {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_4_7);
+        out << (quint16)index << File_v3::writeCharts(QList<ChartData>() << chart);
+        append(Op_Items, data);
+    }
+
+    if(!removed.isEmpty()) {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_4_7);
+        out << (quint16)index << removed;
+        append(Op_Remove, data);
+    }
+}
+
+QByteArray Journal::chartHeader(int index) const
+{
+    CrochetTab *tab = qobject_cast<CrochetTab*>(mTabWidget->widget(index));
+    if(!tab)
+        return QByteArray();
+
+    ChartData chart = File_v2::chartHeader(tab);
+    chart.name = mTabWidget->tabText(index);
+    return File_v3::writeCharts(QList<ChartData>() << chart);
+}
+
+void Journal::recordHeader(int index)
+{
+    QByteArray header = chartHeader(index);
+    if(header == mTabs.at(index).header)
+        return;
+
+    mTabs[index].header = header;
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_7);
+    out << (quint16)index << header;
+    append(Op_Chart, data);
+}
+
+bool Journal::tabsChanged() const
+{
+    if(mTabs.count() != mTabWidget->count())
+        return true;
+
+    for(int i = 0; i < mTabs.count(); ++i) {
+        if(mTabs.at(i).tab.data() != mTabWidget->widget(i) || mTabs.at(i).name != mTabWidget->tabText(i))
+            return true;
+        if(mTabs.at(i).tab && mTabs.at(i).pending != mTabs.at(i).tab->hasPendingChart())
+            return true;
+    }
+    return false;
+}
+
+void Journal::rememberTabs()
+{
+    mTabs.clear();
+    for(int i = 0; i < mTabWidget->count(); ++i) {
+        TabState state;
+        state.tab = qobject_cast<CrochetTab*>(mTabWidget->widget(i));
+        state.name = mTabWidget->tabText(i);
+        state.header = chartHeader(i);
+        state.storedCells = state.tab ? state.tab->scene()->cellStore()->count() : 0;
+        //the checkpoint has the Cells the stored cells became.
+        if(state.tab)
+            state.tab->scene()->takeMaterializedCells();
+        state.pending = state.tab ? state.tab->hasPendingChart() : false;
+        mTabs.append(state);
+    }
+}
+
+void Journal::append(Op op, const QByteArray &data)
+{
+    mBuffer.append(frame(++mSeq, op, data));
+}
+
+QByteArray Journal::frame(quint64 seq, quint8 op, const QByteArray &data)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_7);
+    out << seq << op;
+    out.writeRawData(data.constData(), data.size());
+
+    //the checksum finds a record that was only partly written when the program stopped.
+    QByteArray record;
+    QDataStream header(&record, QIODevice::WriteOnly);
+    header << (quint32)payload.size() << qChecksum(payload.constData(), payload.size());
+    record.append(payload);
+    return record;
+}
+
+bool Journal::openJournal()
+{
+    if(mJournal.isOpen())
+        return true;
+
+    QDir().mkpath(folder());
+    if(!mJournal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        WARN("Couldn't open the autosave journal " + mJournal.fileName());
+        return false;
+    }
+
+    if(mJournal.size() == 0)
+        writeJournalHeader(&mJournal);
+    return true;
+}
+
+bool Journal::writeBuffer()
+{
+    if(mBuffer.isEmpty())
+        return true;
+
+    if(!openJournal())
+        return false;
+
+    bool ok = (mJournal.write(mBuffer) == mBuffer.size()) && mJournal.flush();
+    if(!ok)
+        WARN("Couldn't write the autosave journal " + mJournal.fileName());
+
+    mBuffer.clear();
+    mLastWrite = QDateTime::currentDateTime();
+    return ok;
+}
+
+void Journal::flush()
+{
+    if(!isEnabled() || !mHasCheckpoint)
+        return;
+
+    //new, closed, moved or renamed tabs aren't recorded.
+    if(tabsChanged()) {
+        checkpoint();
+        return;
+    }
+
+    //pick up chart changes that don't go through the undo stack.
+    if(!mCheckpointPending) {
+        for(int i = 0; i < mTabs.count(); ++i)
+            recordHeader(i);
+    }
+
+    if(mFileName != mFile->fileName) {
+        mFileName = mFile->fileName;
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_4_7);
+        out << mFileName;
+        append(Op_FileName, data);
+    }
+
+    QDateTime now = QDateTime::currentDateTime();
+    if(mBuffer.isEmpty() && mLastWrite.secsTo(now) >= JOURNAL_ALIVE_SECS)
+        mBuffer.append(frame(mSeq, Op_Alive, QByteArray()));
+
+    writeBuffer();
+
+    int interval = Settings::inst()->value("autosaveCheckpointInterval").toInt() * 60;
+    bool changed = (mSeq > mCheckpointSeq);
+    if(changed && (mLastCheckpoint.secsTo(now) >= interval || mJournal.size() > JOURNAL_MAX_SIZE))
+        checkpoint();
+}
+
+void Journal::checkpoint()
+{
+    if(!isEnabled() || mTabWidget->count() <= 0)
+        return;
+
+    if(mWatcher.isRunning()) {
+        mCheckpointPending = true;
+        return;
+    }
+    mCheckpointPending = false;
+
+    //don't copy the whole document on every edit while the disk is full.
+    if(mLastFailure.isValid() && mLastFailure.secsTo(QDateTime::currentDateTime()) < JOURNAL_ALIVE_SECS)
+        return;
+
+    if(!writeBuffer() || !openJournal())
+        return;
+
+    //everything up to here is in the checkpoint.
+    mCheckpointSeq = mSeq;
+    mCheckpointOffset = mJournal.size();
+    rememberTabs();
+
+    //the file name has to be in the records the journal keeps.
+    mFileName = mFile->fileName;
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_7);
+    out << mFileName;
+    append(Op_FileName, data);
+
+    QString copyName = folder() + QString("%1-%2.pattern").arg(mKey).arg(mCheckpointSeq);
+    mWatcher.setFuture(mFile->saveCopy(copyName));
+    mLastCheckpoint = QDateTime::currentDateTime();
+}
+
+void Journal::checkpointFinished()
+{
+    //the document was saved or closed while the checkpoint was written.
+    if(mCheckpointOffset < 0) {
+        remove(mJournal.fileName());
+        return;
+    }
+
+    if(mWatcher.result() != FileFactory::No_Error) {
+        WARN("Couldn't write the autosave checkpoint.");
+        mLastFailure = QDateTime::currentDateTime();
+        mCheckpointPending = false;
+        return;
+    }
+    mLastFailure = QDateTime();
+    mHasCheckpoint = true;
+
+    //keep only the records that came after the checkpoint.
+    writeBuffer();
+    mJournal.close();
+
+    QFile old(mJournal.fileName());
+    QByteArray tail;
+    if(old.open(QIODevice::ReadOnly) && old.seek(mCheckpointOffset))
+        tail = old.readAll();
+    old.close();
+
+    QTemporaryFile f(mJournal.fileName() + ".XXXXXX");
+    if(f.open()) {
+        writeJournalHeader(&f);
+        f.write(tail);
+        if(f.flush() && FileFactory::replaceFile(&f, mJournal.fileName()))
+            f.setAutoRemove(false);
+    }
+
+    removeCheckpoints(mCheckpointSeq);
+
+    if(mCheckpointPending)
+        checkpoint();
+}
+
+void Journal::removeCheckpoints(quint64 keep)
+{
+    QString current = QString("%1-%2.pattern").arg(mKey).arg(keep);
+    QDir dir(folder());
+    foreach(QString file, dir.entryList(QStringList() << mKey + "-*.pattern", QDir::Files)) {
+        if(file != current)
+            dir.remove(file);
+    }
+}
+
+void Journal::discard()
+{
+    mWatcher.waitForFinished();
+
+    mJournal.close();
+    remove(mJournal.fileName());
+
+    mBuffer.clear();
+    mTabs.clear();
+    mHasCheckpoint = false;
+    mCheckpointPending = false;
+    mCheckpointOffset = -1;
+}
+
+QStringList Journal::orphans()
+{
+    QStringList journals;
+    QString own = QString("%1-").arg(QCoreApplication::applicationPid());
+    QDateTime now = QDateTime::currentDateTime();
+
+    QDir dir(folder());
+    foreach(QFileInfo info, dir.entryInfoList(QStringList() << "*.journal", QDir::Files)) {
+        if(info.fileName().startsWith(own))
+            continue;
+        //another copy of the program is still using it.
+        if(info.lastModified().secsTo(now) < JOURNAL_STALE_SECS)
+            continue;
+        journals.append(info.absoluteFilePath());
+    }
+
+    return journals;
+}
+
+void Journal::remove(const QString &journal)
+{
+    QFileInfo info(journal);
+    QDir dir(info.absolutePath());
+    foreach(QString file, dir.entryList(QStringList() << info.completeBaseName() + "-*.pattern", QDir::Files))
+        dir.remove(file);
+    QFile::remove(journal);
+}
+
+QString Journal::checkpointFile(const QString &journal, quint64 *seq)
+{
+    QFileInfo info(journal);
+    QString prefix = info.completeBaseName() + "-";
+    QDir dir(info.absolutePath());
+
+    QString latest;
+    foreach(QString file, dir.entryList(QStringList() << prefix + "*.pattern", QDir::Files)) {
+        bool ok = false;
+        quint64 fileSeq = QFileInfo(file).completeBaseName().mid(prefix.length()).toULongLong(&ok);
+        if(ok && (latest.isEmpty() || fileSeq > *seq)) {
+            latest = dir.absoluteFilePath(file);
+            *seq = fileSeq;
+        }
+    }
+
+    return latest;
+}
+
+bool Journal::recover(const QString &journal, const QString &fileName, QString *originalName)
+{
+    quint64 seq = 0;
+    QString checkpoint = checkpointFile(journal, &seq);
+    if(checkpoint.isEmpty())
+        return false;
+
+    QFile in(checkpoint);
+    if(!in.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&in);
+    quint32 magicNumber;
+    qint32 version;
+    stream >> magicNumber >> version;
+    if(magicNumber != AppInfo::inst()->magicNumber || version != FileFactory::Version_1_3)
+        return false;
+
+    stream.setVersion(QDataStream::Qt_4_7);
+    QMap<QString, QByteArray> icons;
+    QByteArray header, chartData;
+    stream >> icons >> header >> chartData;
+    if(stream.status() != QDataStream::Ok)
+        return false;
+
+    QList<ChartData> charts;
+    if(!File_v3::readCharts(chartData, &charts))
+        return false;
+
+    QFile records(journal);
+    if(!records.open(QIODevice::ReadOnly) || !replay(records.readAll(), seq, &charts, originalName))
+        return false;
+
+    QFile out(fileName);
+    if(!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    QDataStream outStream(&out);
+    outStream << magicNumber << (qint32)FileFactory::Version_1_3;
+    outStream.setVersion(QDataStream::Qt_4_7);
+    outStream << icons << header << File_v3::writeCharts(charts);
+
+    return outStream.status() == QDataStream::Ok && out.flush();
+}
+
+bool Journal::replay(const QByteArray &journal, quint64 fromSeq, QList<ChartData> *charts, QString *fileName)
+{
+    QDataStream in(journal);
+    in.setVersion(QDataStream::Qt_4_7);
+
+    quint32 magic;
+    quint16 version;
+    in >> magic >> version;
+    if(in.status() != QDataStream::Ok || magic != JOURNAL_MAGIC || version > JOURNAL_VERSION)
+        return false;
+
+    QList<ChartIndex> index;
+    foreach(const ChartData &chart, *charts) {
+        ChartIndex i;
+        indexItems(chart.cells, &i.cells);
+        indexItems(chart.images, &i.images);
+        indexItems(chart.indicators, &i.indicators);
+        index.append(i);
+    }
+
+    while(!in.atEnd()) {
+        quint32 size;
+        quint16 checksum;
+        in >> size >> checksum;
+        if(in.status() != QDataStream::Ok || size > (quint32)(journal.size() - in.device()->pos()))
+            break;
+
+        //a record that wasn't finished ends the journal.
+        QByteArray payload(size, 0);
+        in.readRawData(payload.data(), size);
+        if(qChecksum(payload.constData(), size) != checksum)
+            break;
+
+        QDataStream record(payload);
+        record.setVersion(QDataStream::Qt_4_7);
+        quint64 seq;
+        quint8 op;
+        record >> seq >> op;
+
+        if(op == Op_FileName) {
+            record >> *fileName;
+            continue;
+        }
+
+        if(seq <= fromSeq)
+            continue;
+
+        quint16 chart = 0;
+        if(op == Op_Chart || op == Op_Items || op == Op_Remove)
+            record >> chart;
+        if(chart >= charts->count())
+            continue;
+
+        if(op == Op_Chart || op == Op_Items) {
+            QByteArray data;
+            record >> data;
+            QList<ChartData> loaded;
+            if(!File_v3::readCharts(data, &loaded) || loaded.count() != 1)
+                continue;
+
+            ChartData &c = (*charts)[chart];
+            ChartIndex &i = index[chart];
+            if(op == Op_Chart) {
+                ChartData h = loaded.first();
+                h.cells = c.cells;
+                h.images = c.images;
+                h.indicators = c.indicators;
+                c = h;
+            } else {
+                updateItems(&c.cells, &i.cells, &i.removed, loaded.first().cells);
+                updateItems(&c.images, &i.images, &i.removed, loaded.first().images);
+                updateItems(&c.indicators, &i.indicators, &i.removed, loaded.first().indicators);
+            }
+        } else if(op == Op_Remove) {
+            QVector<quint32> ids;
+            record >> ids;
+            foreach(quint32 id, ids)
+                index[chart].removed.insert(id);
+        }
+    }
+
+    for(int i = 0; i < charts->count(); ++i) {
+        ChartData &c = (*charts)[i];
+        dropItems(&c.cells, index.at(i).removed, c.groupCount);
+        dropItems(&c.images, index.at(i).removed, c.groupCount);
+        dropItems(&c.indicators, index.at(i).removed, c.groupCount);
+    }
+
+    return true;
+}
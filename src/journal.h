@@ -0,0 +1,187 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+#include <QPointer>
+#include <QDateTime>
+#include <QFutureWatcher>
+#include <QStringList>
+
+#include "chartdata.h"
+#include "filefactory.h"
+
+class QGraphicsItem;
+class QUndoCommand;
+class CrochetTab;
+class Scene;
+class Cell;
+class ChartImage;
+class Indicator;
+
+/**
+ * The autosave journal of an open document.
+ *
+ * Every command done, undone or redone on the tabs' undo stacks is appended
+ * to the journal as a small binary record holding the items it changed, so
+ * the cost of an edit doesn't depend on the size of the chart. Once in a while
+ * a full version 1.3 copy of the document is written as a checkpoint and the
+ * journal is cut down to the records that came after it.
+ *
+ * Edits the journal can't describe (grouping, layers, new tabs) write a new
+ * checkpoint instead of a record.
+ *
+ * The journal is kept in the "autosave" folder of the user settings folder:
+ *  <key>.journal         - the records.
+ *  <key>-<seq>.pattern   - the last checkpoint, <seq> is the last record in it.
+ *
+ * A journal that isn't written to for a few minutes was left behind by a
+ * crash and can be rebuilt with recover().
+ */
+class Journal : public QObject
+{
+    Q_OBJECT
+    friend class TestChartParser;
+public:
+    Journal(FileFactory *file, QTabWidget *tabWidget, QObject *parent = 0);
+    ~Journal();
+
+    /**
+     * Start recording the commands done on @tab.
+     */
+    void addTab(CrochetTab *tab);
+
+    /**
+     * Remove the journal and checkpoint, the document was saved or closed.
+     */
+    void discard();
+
+    /**
+     * The id used for @item in the journal, a new id is given to items that don't have one.
+     */
+    static quint32 itemId(QGraphicsItem *item);
+    /**
+     * A new id for an item or a stored cell.
+     */
+    static quint32 newItemId();
+
+    static QString folder();
+    /**
+     * The journals left behind by sessions that didn't close.
+     */
+    static QStringList orphans();
+    /**
+     * Rebuild the document in @journal from the last checkpoint and the records after it.
+     * The file the document was saved as is returned in @originalName.
+     */
+    static bool recover(const QString &journal, const QString &fileName, QString *originalName);
+    /**
+     * Delete @journal and its checkpoints.
+     */
+    static void remove(const QString &journal);
+
+public slots:
+    /**
+     * Write the records waiting in memory to the disk.
+     */
+    void flush();
+    /**
+     * Write a full copy of the document in the background.
+     */
+    void checkpoint();
+
+private slots:
+    void commandDone(const QUndoCommand *cmd);
+    void checkpointFinished();
+
+private:
+    enum Op {
+        Op_FileName = 1,    //QString - the file the document is saved as.
+        Op_Chart = 2,       //quint16 chart, QByteArray - the chart without any items.
+        Op_Items = 3,       //quint16 chart, QByteArray - the items added or changed.
+        Op_Remove = 4,      //quint16 chart, QVector<quint32> - the ids of the items removed.
+        Op_Alive = 5        //nothing - written when idle so the journal doesn't look abandoned.
+    };
+
+    struct TabState {
+        QPointer<CrochetTab> tab;
+        QString name;
+        QByteArray header;
+        //cells added to the store after this have no ids in the checkpoint.
+        int storedCells;
+        //the items are still in the file, they have no ids in the checkpoint.
+        bool pending;
+    };
+
+    bool isEnabled() const;
+    int tabIndex(QObject *undoStack) const;
+
+    bool openJournal();
+    bool writeBuffer();
+    void append(Op op, const QByteArray &data);
+    bool tabsChanged() const;
+    void rememberTabs();
+    QByteArray chartHeader(int index) const;
+    void recordHeader(int index);
+    void recordItems(int index, const QList<QGraphicsItem*> &items);
+    void removeCheckpoints(quint64 keep);
+
+    /**
+     * The values a save would write for an item, without ungrouping it.
+     */
+    static void itemGeometry(Scene *scene, QGraphicsItem *item, ItemData *data);
+    static CellData cellData(Scene *scene, Cell *c);
+    static ChartImageData imageData(Scene *scene, ChartImage *c);
+    static IndicatorData indicatorData(Scene *scene, Indicator *i);
+
+    static QByteArray frame(quint64 seq, quint8 op, const QByteArray &data);
+    static bool replay(const QByteArray &journal, quint64 fromSeq, QList<ChartData> *charts, QString *fileName);
+    static QString checkpointFile(const QString &journal, quint64 *seq);
+
+    FileFactory *mFile;
+    QTabWidget *mTabWidget;
+
+    QString mKey;
+    QFile mJournal;
+    //records that haven't been written yet.
+    QByteArray mBuffer;
+    quint64 mSeq;
+
+    QList<TabState> mTabs;
+    QString mFileName;
+
+    bool mHasCheckpoint;
+    bool mCheckpointPending;
+    //the last record in the checkpoint being written, and where the records after it start.
+    quint64 mCheckpointSeq;
+    qint64 mCheckpointOffset;
+    QDateTime mLastCheckpoint;
+    QDateTime mLastFailure;
+    QDateTime mLastWrite;
+
+    QTimer mTimer;
+    QFutureWatcher<FileFactory::FileError> mWatcher;
+};
+
+#endif // JOURNAL_H
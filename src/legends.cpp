@@ -32,16 +32,14 @@
 
 #include <math.h>
 
-QPixmap Legend::drawColorBox(QColor color, QSize size)
+void Legend::drawColorBox(QPainter* painter, QRect rect, QColor color)
 {
-    QPixmap pix = QPixmap(size);
-    QPainter p;
-    p.begin(&pix);
-    p.fillRect(QRect(QPoint(0, 0), size), QColor(color));
-    p.drawRect(0, 0, size.width() - 1, size.height() - 1);
-    p.end();
-
-    return pix;
+    painter->save();
+    painter->setPen(QPen());
+    painter->setBrush(Qt::NoBrush);
+    painter->fillRect(rect, color);
+    painter->drawRect(rect.adjusted(0, 0, -1, -1));
+    painter->restore();
 }
 
 
@@ -64,17 +62,36 @@ ColorLegend::ColorLegend(QMap<QString, QMap<QString, qint64> >* colors, QGraphic
     prefix = Settings::inst()->value("colorPrefix").toString();
     sortBy = Settings::inst()->value("colorLegendSortBy").toString();
     
+    updateLayout();
 }
 
 ColorLegend::~ColorLegend()
 {
 }
 
+void ColorLegend::updateLayout()
+{
+    mPicture = QPicture();
+
+    QPainter p;
+    p.begin(&mPicture);
+    QSize size = draw(&p);
+    p.end();
+
+    resize(size);
+    update();
+}
+
 void ColorLegend::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
 {
     Q_UNUSED(option);
     Q_UNUSED(widget);
 
+    painter->drawPicture(0, 0, mPicture);
+}
+
+QSize ColorLegend::draw(QPainter* painter)
+{
     QFont originalFont = painter->font();
     originalFont.setPixelSize(10);
     originalFont.setBold(false);
@@ -101,6 +118,7 @@ void ColorLegend::paint(QPainter* painter, const QStyleOptionGraphicsItem* optio
 
     //if we have more columns then items don't draw a really large white space.
     int cols = (sortedKeys.count() < columnCount) ? sortedKeys.count() : columnCount;
+    cols = qMax(1, cols);
     
     int itemsPerCol = ceil(double(sortedKeys.count()) / double(cols));
 
@@ -140,7 +158,7 @@ void ColorLegend::paint(QPainter* painter, const QStyleOptionGraphicsItem* optio
         int x = Legend::margin + ceil(i/itemsPerCol + 0.0) * colWidth;
         int y = Legend::margin + ((Legend::margin + Legend::iconHeight) * (i%itemsPerCol)) + titleHeight;
         
-        painter->drawPixmap(x, y, Legend::drawColorBox(QColor(hex), QSize(Legend::iconWidth, Legend::iconHeight)));
+        Legend::drawColorBox(painter, QRect(x, y, Legend::iconWidth, Legend::iconHeight), QColor(hex));
         x += Legend::iconWidth + Legend::margin;
         y +=  + (.5 * (Legend::iconHeight + textHeight));
         painter->drawText(x, y, prefix + QString::number(i + 1));
@@ -154,7 +172,7 @@ void ColorLegend::paint(QPainter* painter, const QStyleOptionGraphicsItem* optio
     if(showBorder)
         painter->drawRect(0, 0, imageWidth - 1, imageHeight - 1);
 
-    scene()->setSceneRect(0, 0, imageWidth, imageHeight);
+    return QSize(imageWidth, imageHeight);
 }
 
 
@@ -172,17 +190,36 @@ StitchLegend::StitchLegend(QMap<QString, int>* stitches, QGraphicsItem* parent)
     showWrongSide = Settings::inst()->value("showStitchWrongSide").toBool();
     columnCount = Settings::inst()->value("stitchLegendColumnCount").toInt();
     
+    updateLayout();
 }
 
 StitchLegend::~StitchLegend()
 {
 }
 
+void StitchLegend::updateLayout()
+{
+    mPicture = QPicture();
+
+    QPainter p;
+    p.begin(&mPicture);
+    QSize size = draw(&p);
+    p.end();
+
+    resize(size);
+    update();
+}
+
 void StitchLegend::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
 {
     Q_UNUSED(option);
     Q_UNUSED(widget);
 
+    painter->drawPicture(0, 0, mPicture);
+}
+
+QSize StitchLegend::draw(QPainter* painter)
+{
     QFont originalFont = painter->font();
     originalFont.setPixelSize(10);
     originalFont.setBold(false);
@@ -228,6 +265,7 @@ void StitchLegend::paint(QPainter* painter, const QStyleOptionGraphicsItem* opti
 
     //if we have more columns then items don't draw a really large white space.
     int items = (keys.count() < columnCount) ? keys.count() : columnCount;
+    items = qMax(1, items);
 
     int avgColHeight = ceil(totalHeight / items);
 
@@ -355,7 +393,7 @@ void StitchLegend::paint(QPainter* painter, const QStyleOptionGraphicsItem* opti
     if(showBorder)
         painter->drawRect(0, 0, imageWidth -1, imageHeight -1);
     
-    scene()->setSceneRect(0,0, imageWidth, imageHeight);
+    return QSize(imageWidth, imageHeight);
 }
 
 
@@ -23,6 +23,7 @@
 
 #include <QGraphicsWidget>
 #include <QMap>
+#include <QPicture>
 
 namespace Legend {
     const int margin = 5;
@@ -30,7 +31,7 @@ namespace Legend {
     const int iconHeight = 32;
     const int iconWidth = 32;
 
-    QPixmap drawColorBox(QColor color, QSize size);
+    void drawColorBox(QPainter* painter, QRect rect, QColor color);
     
 }
 
@@ -47,11 +48,23 @@ public:
     int columnCount;
     QString prefix;
     QString sortBy;
+
+    /**
+     * Lay out and record the legend, call after changing the options above.
+     * The legend is resized to fit.
+     */
+    void updateLayout();
     
 protected:
     void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = 0);
     
 private:
+    //draws the whole legend and returns its size.
+    QSize draw(QPainter* painter);
+
+    //the legend as it was drawn by the last updateLayout().
+    QPicture mPicture;
+
 
     QMap<QString, QMap<QString, qint64> >* mPatternColors;
     QMap<qint64, QString> sortedColors;    
@@ -70,11 +83,23 @@ public:
     bool showDescription;
     bool showWrongSide;
     int columnCount;
+
+    /**
+     * Lay out and record the legend, call after changing the options above.
+     * The legend is resized to fit.
+     */
+    void updateLayout();
     
 protected:
     void paint(QPainter* painter, const QStyleOptionGraphicsItem* option,  QWidget* widget = 0);
 
 private:
+    //draws the whole legend and returns its size.
+    QSize draw(QPainter* painter);
+
+    //the legend as it was drawn by the last updateLayout().
+    QPicture mPicture;
+
     QMap<QString, int>* mPatternStitches;
 
 };
@@ -24,6 +24,7 @@
 
 #include <QDebug>
 #include <QDir>
+#include <QTimer>
 
 #include "settings.h"
 
@@ -31,6 +32,7 @@
 #include "updatefunctions.h"
 
 #include "errorhandler.h"
+#include "batchexporter.h"
 
 int main(int argc, char *argv[])
 {
@@ -40,6 +42,13 @@ int main(int argc, char *argv[])
     QStringList arguments = QCoreApplication::arguments();
     arguments.removeFirst(); // remove the application name from the list.
 
+    //export the files and quit without showing a window.
+    if(BatchExporter::isBatchExport(arguments)) {
+        Q_INIT_RESOURCE(crochet);
+        BatchExporter exporter(arguments);
+        return exporter.run();
+    }
+
     MainWindow w(arguments);
     a.setMainWindow(&w);
 
@@ -59,5 +68,8 @@ int main(int argc, char *argv[])
 
     w.showMaximized();
     splash.finish(&w);
+
+    //look for documents left by a crash once the window is up.
+    QTimer::singleShot(0, &w, SLOT(recoverDocuments()));
     return a.exec();
 }
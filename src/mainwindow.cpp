@@ -36,6 +36,9 @@
 
 #include "stitchreplacerui.h"
 #include "colorreplacer.h"
+#include "journal.h"
+#include "iconstore.h"
+#include "pagetiler.h"
 
 #include "debug.h"
 #include <QDialog>
@@ -54,15 +57,23 @@
 #include <QCloseEvent>
 #include <QUndoStack>
 #include <QUndoView>
+#include <QLabel>
+#include <QVBoxLayout>
 #include <QTimer>
+#include <QEventLoop>
+#include <QStatusBar>
 
 #include <QSortFilterProxyModel>
 #include <QDesktopServices>
 
-MainWindow::MainWindow(QStringList fileNames, QWidget* parent)
+MainWindow::MainWindow(QStringList fileNames, QWidget* parent, bool headless)
     : QMainWindow(parent),
     ui(new Ui::MainWindow),
     mUpdater(0),
+    mSaving(false),
+    mSavePending(false),
+    mHeadless(headless),
+    mJournal(0),
 	mResizeUI(0),
     mAlignDock(0),
     mRowsDock(0),
@@ -88,7 +99,7 @@ MainWindow::MainWindow(QStringList fileNames, QWidget* parent)
     
 #ifndef APPLE_APP_STORE
     bool checkForUpdates = Settings::inst()->value("checkForUpdates").toBool();
-    if(checkForUpdates)
+    if(checkForUpdates && !headless)
         checkUpdates();
 #endif
 
@@ -97,6 +108,9 @@ MainWindow::MainWindow(QStringList fileNames, QWidget* parent)
     setupDocks();
     
     mFile = new FileFactory(this);
+    if(!headless)
+        mJournal = new Journal(mFile, ui->tabWidget, this);
+    connect(&mSaveWatcher, SIGNAL(finished()), SLOT(saveFinished()));
     loadFiles(fileNames);
 
 	setAcceptDrops(true);
@@ -406,15 +420,40 @@ void MainWindow::setupLayersDock()
 	connect(ui->layersView, SIGNAL(clicked(const QModelIndex&)), this, SLOT(selectLayer(const QModelIndex&)));
 }
 
+void MainWindow::updateUndoMemory()
+{
+    UndoStack* stack = qobject_cast<UndoStack*>(mUndoGroup.activeStack());
+    if(!stack) {
+        mUndoMemory->clear();
+        return;
+    }
+
+    double used = stack->memoryUsage() / (1024.0 * 1024.0);
+    qint64 limit = stack->memoryLimit();
+    if(limit > 0)
+        mUndoMemory->setText(tr("Memory: %1 of %2 MB").arg(used, 0, 'f', 1).arg(limit / (1024 * 1024)));
+    else
+        mUndoMemory->setText(tr("Memory: %1 MB").arg(used, 0, 'f', 1));
+}
+
 void MainWindow::setupDocks()
 {
     //Undo Dock.
     mUndoDock = new QDockWidget(this);
     mUndoDock->setVisible(false);
     mUndoDock->setObjectName("undoHistory");
-    QUndoView* view = new QUndoView(&mUndoGroup, mUndoDock);
-    mUndoDock->setWidget(view);
+    QWidget* undoWidget = new QWidget(mUndoDock);
+    QVBoxLayout* undoLayout = new QVBoxLayout(undoWidget);
+    undoLayout->setContentsMargins(0, 0, 0, 0);
+    QUndoView* view = new QUndoView(&mUndoGroup, undoWidget);
+    mUndoMemory = new QLabel(undoWidget);
+    undoLayout->addWidget(view);
+    undoLayout->addWidget(mUndoMemory);
+    mUndoDock->setWidget(undoWidget);
     mUndoDock->setWindowTitle(tr("Undo History"));
+    connect(&mUndoGroup, SIGNAL(activeStackChanged(QUndoStack*)), SLOT(updateUndoMemory()));
+    connect(&mUndoGroup, SIGNAL(indexChanged(int)), SLOT(updateUndoMemory()));
+    updateUndoMemory();
     mUndoDock->setFloating(true);
 	
 	//Resize Dock
@@ -712,7 +751,9 @@ void MainWindow::filePrint()
 void MainWindow::print(QPrinter* printer)
 {
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-    
+
+    mFile->loadPendingCharts();
+
     int tabCount = ui->tabWidget->count();
     QPainter* p = new QPainter();
     
@@ -720,10 +761,22 @@ void MainWindow::print(QPrinter* printer)
 
     bool firstPass = true;
     for(int i = 0; i < tabCount; ++i) {
+        CrochetTab* tab = qobject_cast<CrochetTab*>(ui->tabWidget->widget(i));
+
+        if(PageTiler::isEnabled()) {
+            PageTiler tiler = PageTiler::fromSettings(printer, tab->scene()->itemsBoundingRect(), p->window());
+            for(int page = 0; page < tiler.count(); ++page) {
+                if(!firstPass)
+                    printer->newPage();
+                tiler.renderPage(p, tab->scene(), page);
+                firstPass = false;
+            }
+            continue;
+        }
+
         if(!firstPass)
             printer->newPage();
         
-        CrochetTab* tab = qobject_cast<CrochetTab*>(ui->tabWidget->widget(i));
         tab->renderChart(p);
         firstPass = false;
     }
@@ -746,7 +799,10 @@ void MainWindow::fileExport()
 {
     if(!hasTab())
         return;
-    
+
+    //every chart can be exported.
+    mFile->loadPendingCharts();
+
     ExportUi d(ui->tabWidget, &mPatternStitches, &mPatternColors, this);
     d.exec();
 }
@@ -769,6 +825,8 @@ void MainWindow::addColor(QColor color)
 
 void MainWindow::updateDefaultStitchColor(QColor originalColor, QColor newColor)
 {
+    mFile->loadPendingCharts();
+
     for(int i = 0; i < ui->tabWidget->count(); ++i) {
         CrochetTab *tab = qobject_cast<CrochetTab*>(ui->tabWidget->widget(i));
         if(!tab)
@@ -906,6 +964,10 @@ void MainWindow::closeEvent(QCloseEvent* event)
 {
 
     if(safeToClose()) {
+        waitForSave();
+        if(mJournal)
+            mJournal->discard();
+
         Settings::inst()->setValue("geometry", saveGeometry());
         Settings::inst()->setValue("windowState", saveState());
 
@@ -1081,6 +1143,71 @@ void MainWindow::fileOpen()
    
 }
 
+void MainWindow::recoverDocuments()
+{
+    QStringList journals = Journal::orphans();
+    if(journals.isEmpty())
+        return;
+
+    QMessageBox msgbox(this);
+    msgbox.setText(tr("%1 didn't close properly last time and has unsaved changes it can recover.").arg(qAppName()));
+    msgbox.setInformativeText(tr("Do you want to recover the documents?"));
+    msgbox.setIcon(QMessageBox::Question);
+    msgbox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+    bool recover = (msgbox.exec() == QMessageBox::Yes);
+
+    int failed = 0;
+    foreach(QString journal, journals) {
+        if(!recover) {
+            Journal::remove(journal);
+            continue;
+        }
+
+        //the recovered file is named like a checkpoint so it's removed with the journal.
+        QString recovered = Journal::folder() + QFileInfo(journal).completeBaseName() + "-recovered.pattern";
+        QString originalName;
+        if(!Journal::recover(journal, recovered, &originalName)) {
+            failed++;
+            Journal::remove(journal);
+            continue;
+        }
+
+        MainWindow* win = this;
+        if(hasTab()) {
+            win = new MainWindow();
+            win->move(x() + 40, y() + 40);
+            win->show();
+        }
+
+        win->mFile->fileName = recovered;
+        int error = win->mFile->load();
+        Journal::remove(journal);
+
+        if(error != FileFactory::No_Error) {
+            win->showFileError(error);
+            continue;
+        }
+
+        win->ui->newDocument->hide();
+        win->mFile->fileName = originalName;
+        if(!originalName.isEmpty())
+            Settings::inst()->files.insert(originalName.toLower(), win);
+
+        win->setApplicationTitle();
+        win->updateMenuItems();
+        win->documentIsModified(true);
+        if(win->mJournal)
+            win->mJournal->checkpoint();
+    }
+
+    if(failed > 0) {
+        QMessageBox msgbox(this);
+        msgbox.setText(tr("Some of the documents could not be recovered."));
+        msgbox.setIcon(QMessageBox::Warning);
+        msgbox.exec();
+    }
+}
+
 void MainWindow::loadFile(QString fileName)
 {
     
@@ -1136,19 +1263,58 @@ void MainWindow::fileSave()
     
     if(mFile->fileName.isEmpty())
         fileSaveAs();
-    else {
-        QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-        FileFactory::FileError err = mFile->save();
-        if(err != FileFactory::No_Error) {
-            qWarning() << "There was an error saving the file: " << err;
-            QMessageBox msgbox;
-            msgbox.setText(tr("There was an error saving the file."));
-            msgbox.setIcon(QMessageBox::Critical);
-            msgbox.exec();
-        }
+    else if(mSaving)
+        mSavePending = true;
+    else
+        startSave();
+}
 
-        documentIsModified(false);
-        QApplication::restoreOverrideCursor();
+void MainWindow::startSave(FileFactory::FileVersion version)
+{
+    mSaving = true;
+    statusBar()->showMessage(tr("Saving %1...").arg(QFileInfo(mFile->fileName).fileName()));
+
+    //the document is copied before this returns, anything changed after this needs another save.
+    mSaveWatcher.setFuture(mFile->saveInBackground(version));
+    documentIsModified(false);
+}
+
+void MainWindow::saveFinished()
+{
+    mSaving = false;
+    statusBar()->clearMessage();
+
+    FileFactory::FileError err = mSaveWatcher.result();
+    if(err != FileFactory::No_Error) {
+        qWarning() << "There was an error saving the file: " << err;
+        documentIsModified(true);
+        mSavePending = false;
+
+        QMessageBox msgbox;
+        msgbox.setText(tr("There was an error saving the file."));
+        msgbox.setIcon(QMessageBox::Critical);
+        msgbox.exec();
+        return;
+    }
+
+    if(mSavePending) {
+        mSavePending = false;
+        startSave();
+        return;
+    }
+
+    //keep the journal if the document was changed while it was saved.
+    if(!isWindowModified() && mJournal)
+        mJournal->discard();
+}
+
+void MainWindow::waitForSave()
+{
+    //saveFinished() starts the pending save, so keep waiting until it's done too.
+    while(mSaving) {
+        QEventLoop loop;
+        connect(&mSaveWatcher, SIGNAL(finished()), &loop, SLOT(quit()));
+        loop.exec(QEventLoop::ExcludeUserInputEvents);
     }
 }
 
@@ -1157,7 +1323,7 @@ void MainWindow::fileSaveAs()
     QString fileLoc = Settings::inst()->value("fileLocation").toString();
 
     QFileDialog* fd = new QFileDialog(this, tr("Save Pattern File"), fileLoc,
-                                      tr("Pattern v1.2 (*.pattern);;Pattern v1.0/v1.1 (*.pattern)"));
+                                      tr("Pattern v1.3 (*.pattern);;Pattern v1.2 (*.pattern);;Pattern v1.0/v1.1 (*.pattern)"));
     fd->setWindowFlags(Qt::Sheet);
     fd->setObjectName("filesavedialog");
     fd->setViewMode(QFileDialog::List);
@@ -1180,9 +1346,11 @@ void MainWindow::saveFileAs(QString fileName)
 
     QFileDialog *fd = qobject_cast<QFileDialog*>(sender());
 
-    FileFactory::FileVersion fver = FileFactory::Version_1_2;
+    FileFactory::FileVersion fver = FileFactory::Version_1_3;
     if(fd->selectedNameFilter() == "Pattern v1.0/v1.1 (*.pattern)")
         fver = FileFactory::Version_1_0;
+    else if(fd->selectedNameFilter() == "Pattern v1.2 (*.pattern)")
+        fver = FileFactory::Version_1_2;
 
     if(!fileName.endsWith(".pattern", Qt::CaseInsensitive)) {
         fileName += ".pattern";
@@ -1194,17 +1362,27 @@ void MainWindow::saveFileAs(QString fileName)
     Settings::inst()->files.insert(fileName.toLower(), this);
     addToRecentFiles(fileName);
 
+    //finish writing the old file before the name changes.
+    waitForSave();
+
     mFile->fileName = fileName;
-    mFile->save(fver);
+    startSave(fver);
 
     setApplicationTitle();
-    documentIsModified(false);
     QApplication::restoreOverrideCursor();
 }
 
 void MainWindow::showFileError(int error)
 {
     QApplication::restoreOverrideCursor();
+
+    //nothing went wrong, the user stopped the load.
+    if(error == FileFactory::Err_LoadCancelled) {
+        if(!hasTab())
+            ui->newDocument->show();
+        return;
+    }
+
     QMessageBox msgbox;
     msgbox.setText(tr("There was an error loading the file %1.").arg(mFile->fileName));
     msgbox.setIcon(QMessageBox::Critical);
@@ -1448,6 +1626,9 @@ CrochetTab* MainWindow::createTab(Scene::ChartStyle style)
 	connect(tab->scene(), SIGNAL(showPropertiesSignal()), SLOT(viewMakePropertiesVisible()));
 
     mUndoGroup.addStack(tab->undoStack());
+    connect(tab->undoStack(), SIGNAL(memoryUsageChanged(qint64)), SLOT(updateUndoMemory()));
+    if(mJournal)
+        mJournal->addTab(tab);
     
     QApplication::restoreOverrideCursor();
 
@@ -1738,6 +1919,15 @@ void MainWindow::tabChanged(int newTab)
         return;
     
     mUndoGroup.setActiveStack(tab->undoStack());
+
+    //charts after the first one in a file are loaded when they're first shown.
+    if(tab->hasPendingChart()) {
+        QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+        FileFactory::FileError error = mFile->loadChart(tab);
+        QApplication::restoreOverrideCursor();
+        if(error != FileFactory::No_Error)
+            showFileError(error);
+    }
 }
 
 void MainWindow::removeCurrentTab()
@@ -1873,7 +2063,7 @@ void MainWindow::updatePatternStitches()
             Stitch* s = StitchLibrary::inst()->findStitch(i.key(), true);
             QPixmap pix = QPixmap(QSize(32, 32));
 
-            pix.load(s->file());
+            pix = IconStore::inst()->pixmap(s->file());
             QIcon icon = QIcon(pix);
             QListWidgetItem* item = new QListWidgetItem(icon, i.key(), ui->patternStitches);
             ui->patternStitches->addItem(item);
@@ -34,15 +34,18 @@
 #include "propertiesdock.h"
 
 #include <QSortFilterProxyModel>
+#include <QFutureWatcher>
 
 #include <QModelIndex>
 
 #include "scene.h"
 
 class CrochetTab;
+class Journal;
 class QPrinter;
 class QPainter;
 class QActionGroup;
+class QLabel;
 
 namespace Ui {
     class MainWindow;
@@ -55,14 +58,21 @@ class MainWindow : public QMainWindow
     friend class File;
     friend class File_v1;
     friend class File_v2;
+    friend class File_v3;
+    friend class BatchExporter;
 public:
-    explicit MainWindow(QStringList fileNames = QStringList(), QWidget* parent = 0);
+    /**
+     * A @headless window is only used to load a file for exporting, it doesn't
+     * check for updates or keep an autosave journal.
+     */
+    explicit MainWindow(QStringList fileNames = QStringList(), QWidget* parent = 0, bool headless = false);
     ~MainWindow();
 	
 	void dropEvent(QDropEvent *e);
 	void dragEnterEvent(QDragEnterEvent *e);
 
     bool hasTab();
+    bool isHeadless() const { return mHeadless; }
     void setupNewTabDialog();
 
 protected:
@@ -98,6 +108,7 @@ private slots:
     void fileOpen();
     void fileSave();
     void fileSaveAs();
+    void saveFinished();
     void fileExport();
     void filePrint();
     void filePrintPreview();
@@ -174,6 +185,8 @@ private slots:
 
     void documentIsModified(bool isModified);
 
+    void updateUndoMemory();
+
     void selectStitch(QModelIndex index);
     void selectColor(QModelIndex index);
 
@@ -192,6 +205,10 @@ private slots:
 
 public slots:
     void loadFile(QString fileName);
+    /**
+     * Offer to open the documents left in the autosave folder by a crash.
+     */
+    void recoverDocuments();
 private:
     void loadFiles(QStringList fileNames);
     
@@ -214,6 +231,15 @@ private:
     bool safeToClose();
     bool promptToSave();
 
+    /**
+     * Start writing the file on a worker thread, see saveFinished().
+     */
+    void startSave(FileFactory::FileVersion version = FileFactory::Version_Auto);
+    /**
+     * Block until the running save and any save queued behind it are written.
+     */
+    void waitForSave();
+
     void setEditMode(int mode);
 
     void setApplicationTitle();
@@ -225,6 +251,16 @@ private:
     FileFactory* mFile;
     Updater* mUpdater;
 
+    QFutureWatcher<FileFactory::FileError> mSaveWatcher;
+    //a save is being written.
+    bool mSaving;
+    //the user saved again while a save was being written.
+    bool mSavePending;
+    //only used to load files for the batch exporter, see the constructor.
+    bool mHeadless;
+
+    Journal* mJournal;
+
 //for the savefile class:
 protected:
     QMap<QString, int> patternStitches() { return mPatternStitches; }
@@ -266,6 +302,7 @@ private:
     QList<QAction*> mRecentFilesActs;
     
     QDockWidget* mUndoDock;
+    QLabel* mUndoMemory;
     UndoGroup mUndoGroup;
 	
 	ResizeUI* mResizeUI;
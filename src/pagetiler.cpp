@@ -0,0 +1,165 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "pagetiler.h"
+
+#include <QPainter>
+#include <QPaintDevice>
+#include <QGraphicsScene>
+#include <QCoreApplication>
+
+#include <math.h>
+
+#include "settings.h"
+
+//the width of a standard stitch symbol, in scene units.
+#define PAGETILER_STITCH_WIDTH 32.0
+//space around the chart for the registration marks, in mm.
+#define PAGETILER_MARK_MARGIN 5.0
+
+PageTiler::PageTiler(QRectF sceneRect, QRectF area, qreal scale, qreal overlap, qreal margin)
+    : mSceneRect(sceneRect),
+      mArea(area),
+      mScale(scale),
+      mMargin(margin),
+      mColumns(1),
+      mRows(1)
+{
+    QRectF target = targetRect();
+
+    //more than half a page of overlap would print parts of the chart on three pages.
+    mOverlap = QSizeF(qBound(qreal(0), overlap, target.width() / 2),
+                      qBound(qreal(0), overlap, target.height() / 2));
+
+    if(mScale <= 0 || target.isEmpty())
+        return;
+
+    mContent = target.size() / mScale;
+    mStep = QSizeF((target.width() - mOverlap.width()) / mScale,
+                   (target.height() - mOverlap.height()) / mScale);
+
+    //the first page holds a whole page of the chart, every page after it adds one step.
+    mColumns = 1 + (int)ceil(qMax(qreal(0), mSceneRect.width() - mContent.width()) / mStep.width());
+    mRows = 1 + (int)ceil(qMax(qreal(0), mSceneRect.height() - mContent.height()) / mStep.height());
+}
+
+QRectF PageTiler::targetRect() const
+{
+    return mArea.adjusted(mMargin, mMargin, -mMargin, -mMargin);
+}
+
+QRectF PageTiler::sourceRect(int index) const
+{
+    int column = index % mColumns;
+    int row = index / mColumns;
+
+    return QRectF(QPointF(mSceneRect.left() + column * mStep.width(),
+                          mSceneRect.top() + row * mStep.height()), mContent);
+}
+
+void PageTiler::renderPage(QPainter* painter, QGraphicsScene* scene, int index)
+{
+    QRectF target = targetRect();
+
+    //QGraphicsScene::render only paints the items its index finds in the source rect.
+    painter->save();
+    painter->setClipRect(target, Qt::IntersectClip);
+    scene->render(painter, target, sourceRect(index), Qt::IgnoreAspectRatio);
+    painter->restore();
+
+    drawMarks(painter, index);
+}
+
+void PageTiler::drawMarks(QPainter* painter, int index)
+{
+    QRectF target = targetRect();
+    int column = index % mColumns;
+    int row = index / mColumns;
+    qreal size = mMargin * 0.8;
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setPen(QPen(Qt::black, 0));
+    painter->setBrush(Qt::NoBrush);
+
+    QList<QPointF> corners;
+    corners << target.topLeft() << target.topRight() << target.bottomLeft() << target.bottomRight();
+    foreach(QPointF c, corners) {
+        painter->drawLine(QPointF(c.x() - size, c.y()), QPointF(c.x() + size, c.y()));
+        painter->drawLine(QPointF(c.x(), c.y() - size), QPointF(c.x(), c.y() + size));
+        painter->drawEllipse(c, size / 2, size / 2);
+    }
+
+    //ticks in the margin where the neighbouring pages start and end.
+    painter->setPen(QPen(Qt::black, 0, Qt::DashLine));
+    QList<qreal> xs;
+    if(column > 0)
+        xs << target.left() + mOverlap.width();
+    if(column < mColumns - 1)
+        xs << target.right() - mOverlap.width();
+    foreach(qreal x, xs) {
+        painter->drawLine(QPointF(x, target.top() - mMargin), QPointF(x, target.top()));
+        painter->drawLine(QPointF(x, target.bottom()), QPointF(x, target.bottom() + mMargin));
+    }
+
+    QList<qreal> ys;
+    if(row > 0)
+        ys << target.top() + mOverlap.height();
+    if(row < mRows - 1)
+        ys << target.bottom() - mOverlap.height();
+    foreach(qreal y, ys) {
+        painter->drawLine(QPointF(target.left() - mMargin, y), QPointF(target.left(), y));
+        painter->drawLine(QPointF(target.right(), y), QPointF(target.right() + mMargin, y));
+    }
+
+    QFont font = painter->font();
+    font.setPixelSize(qMax(1, (int)(mMargin * 0.5)));
+    painter->setFont(font);
+    painter->setPen(Qt::black);
+    QString label = QCoreApplication::translate("PageTiler", "Page %1 of %2 (row %3, column %4)")
+                        .arg(index + 1).arg(count()).arg(row + 1).arg(column + 1);
+    painter->drawText(QPointF(target.left() + size * 2, target.top() - mMargin * 0.3), label);
+
+    painter->restore();
+}
+
+bool PageTiler::isEnabled()
+{
+    return Settings::inst()->value("printStitchSize").toDouble() > 0;
+}
+
+PageTiler PageTiler::fromSettings(QPaintDevice* device, QRectF sceneRect, QRectF area)
+{
+    qreal stitchSize = Settings::inst()->value("printStitchSize").toDouble();
+    qreal overlap = Settings::inst()->value("printPageOverlap").toDouble();
+
+    return PageTiler(sceneRect, area, stitchScale(device, stitchSize),
+                     mmToDevice(device, overlap), mmToDevice(device, PAGETILER_MARK_MARGIN));
+}
+
+qreal PageTiler::mmToDevice(QPaintDevice* device, qreal mm)
+{
+    return mm * device->logicalDpiX() / 25.4;
+}
+
+qreal PageTiler::stitchScale(QPaintDevice* device, qreal stitchSize)
+{
+    return mmToDevice(device, stitchSize) / PAGETILER_STITCH_WIDTH;
+}
@@ -0,0 +1,95 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef PAGETILER_H
+#define PAGETILER_H
+
+#include <QRectF>
+#include <QSizeF>
+
+class QPainter;
+class QPaintDevice;
+class QGraphicsScene;
+
+/**
+ * Splits a chart across as many pages as it takes to print it at a fixed stitch size.
+ *
+ * Neighbouring pages share @overlap of the chart so they can be lined up, and each
+ * page has registration marks at the corners of the chart area. Only the items in
+ * a page's part of the scene are painted for that page.
+ */
+class PageTiler
+{
+public:
+    /**
+     * @sceneRect is the part of the scene to print, @area the part of each page it's printed on.
+     * @scale is in device units per scene unit, @overlap and @margin are in device units,
+     * the margin around the chart holds the registration marks.
+     */
+    PageTiler(QRectF sceneRect, QRectF area, qreal scale, qreal overlap, qreal margin);
+
+    int columns() const { return mColumns; }
+    int rows() const { return mRows; }
+    int count() const { return mColumns * mRows; }
+
+    /**
+     * The part of the scene printed on page @index, pages go left to right then top to bottom.
+     */
+    QRectF sourceRect(int index) const;
+    /**
+     * Where the chart is drawn on each page.
+     */
+    QRectF targetRect() const;
+
+    void renderPage(QPainter* painter, QGraphicsScene* scene, int index);
+
+    /**
+     * True if charts are printed at the printStitchSize setting instead of one page per chart.
+     */
+    static bool isEnabled();
+    /**
+     * A tiler for @device that uses the printStitchSize and printPageOverlap settings.
+     */
+    static PageTiler fromSettings(QPaintDevice* device, QRectF sceneRect, QRectF area);
+
+    /**
+     * The scale that prints a standard 32 unit wide stitch @stitchSize mm wide on @device.
+     */
+    static qreal stitchScale(QPaintDevice* device, qreal stitchSize);
+    static qreal mmToDevice(QPaintDevice* device, qreal mm);
+
+private:
+    void drawMarks(QPainter* painter, int index);
+
+    QRectF mSceneRect;
+    QRectF mArea;
+    qreal mScale;
+    qreal mMargin;
+
+    //the overlap in device units, and the chart on each page and the distance between pages in scene units.
+    QSizeF mOverlap;
+    QSizeF mContent;
+    QSizeF mStep;
+
+    int mColumns;
+    int mRows;
+};
+
+#endif // PAGETILER_H
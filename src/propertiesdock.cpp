@@ -32,6 +32,7 @@
 #include "ChartItemTools.h"
 #include "crochettab.h"
 #include "stitchlibrary.h"
+#include "iconstore.h"
 #include "stitch.h"
 #include "colorlistwidget.h"
 #include <qcolordialog.h>
@@ -162,7 +163,7 @@ void PropertiesDock::setupStitchCombo()
     //populate the combo box.
     foreach(QString stitch, StitchLibrary::inst()->stitchList()) {
         Stitch *s = StitchLibrary::inst()->findStitch(stitch);
-        ui->st_stitch->addItem(QIcon(s->file()), stitch);
+        ui->st_stitch->addItem(IconStore::inst()->icon(s->file()), stitch);
     }
 
 }
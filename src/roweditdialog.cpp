@@ -163,18 +163,7 @@ void RowEditDialog::updateRowList()
 
 void RowEditDialog::removeEmptyRows()
 {
-    int rows = mScene->grid.count();
-    
-    for(int i = rows - 1 ; i >= 0; i--) {
-        int cols = mScene->grid.at(i).count();
-        for(int j = cols - 1; j >= 0; j--) {
-            if(mScene->grid[i][j] == 0)
-                mScene->grid[i].removeAt(j);
-        }
-        if(mScene->grid[i].count() == 0)
-            mScene->grid.removeAt(i);
-    }
-    
+    mScene->removeGridGaps();
 }
 
 void RowEditDialog::updateRow()
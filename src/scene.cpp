@@ -51,6 +51,14 @@
 #include "ChartItemTools.h"
 
 #include "guideline.h"
+#include "cellstoreitem.h"
+
+//the grid index is checked after every row change in debug builds.
+#ifndef QT_NO_DEBUG
+#define CHECK_GRID_INDEX() checkGridIndex()
+#else
+#define CHECK_GRID_INDEX()
+#endif
 
 #ifndef M_PI
 	# define M_PI	3.14159265358979323846
@@ -159,7 +167,8 @@ Scene::Scene(QObject* parent) :
 	mSelectedLayer(0),
 	mSelectMode(BoxSelect),
 	mSelectionBand(0),
-	mbackgroundIsEnabled(true)
+	mbackgroundIsEnabled(true),
+    mGuideline(0)
 {
     mPivotPt = QPointF(mDefaultSize.width()/2, mDefaultSize.height());
 	
@@ -167,6 +176,13 @@ Scene::Scene(QObject* parent) :
 
 Scene::~Scene()
 {
+    //the store items draw from mCellStore so remove them before it goes away.
+    foreach(CellStoreItem *item, mCellStoreItems) {
+        QGraphicsScene::removeItem(item);
+        delete item;
+    }
+    mCellStoreItems.clear();
+
 	//clean up all layers when destroyed
 	foreach (ChartLayer* layer, mLayers) {
 		delete layer;
@@ -188,6 +204,12 @@ Cell* Scene::cell(int row, int column)
     if(column >= grid[row].count())
         return 0;
 
+    if(!grid[row][column]) {
+        int index = mCellStore.gridCell(row, column);
+        if(index >= 0)
+            return materializeCell(index);
+    }
+
     return grid[row][column];
 }
 
@@ -216,7 +238,8 @@ QList<ChartLayer*> Scene::layers()
 
 QGraphicsItem* Scene::selectableItemAt(const QPointF& pos)
 {
-	foreach (QGraphicsItem* item, items()) {
+	//let the scene's index find the items under pos instead of testing every item.
+	foreach (QGraphicsItem* item, items(pos, Qt::IntersectsItemBoundingRect, Qt::DescendingOrder)) {
 		if (item->sceneBoundingRect().contains(pos) &&
 				(item->flags() & QGraphicsItem::ItemIsSelectable) == QGraphicsItem::ItemIsSelectable)
 			return item;
@@ -270,6 +293,7 @@ void Scene::addItem(QGraphicsItem* item)
             WARN("Unknown type: " + QString::number(item->type()));
             //fall through
 		case ChartImage::Type:
+        case CellStoreItem::Type:
         case Guideline::Type:
         case QGraphicsEllipseItem::Type:
         case QGraphicsLineItem::Type: {
@@ -350,6 +374,7 @@ void Scene::removeItem(QGraphicsItem* item)
         default:
             WARN("Unknown type: " + QString::number(item->type()));
 		case ChartImage::Type:
+        case CellStoreItem::Type:
         case Guideline::Type:
         case QGraphicsEllipseItem::Type:
         case QGraphicsLineItem::Type: {
@@ -362,15 +387,101 @@ void Scene::removeItem(QGraphicsItem* item)
 
 void Scene::removeFromRows(Cell* c)
 {
+    QHash<Cell*, QPoint>::iterator it = mGridIndex.find(c);
+    if(it == mGridIndex.end())
+        return;
+
+    QPoint pt = it.value();
+    mGridIndex.erase(it);
+
+    grid[pt.y()].removeAt(pt.x());
+    if(grid[pt.y()].count() == 0) {
+        grid.removeAt(pt.y());
+        reindexRows(pt.y());
+        mCellStore.shiftRows(pt.y() + 1, -1);
+    } else {
+        reindexColumns(pt.y(), pt.x());
+        mCellStore.shiftColumns(pt.y(), pt.x() + 1, -1);
+    }
+    c->setZValue(10);
+}
+
+void Scene::removeGridGaps()
+{
+    for(int i = grid.count() - 1; i >= 0; --i) {
+        for(int j = grid[i].count() - 1; j >= 0; --j) {
+            if(grid[i][j] || mCellStore.gridCell(i, j) >= 0)
+                continue;
+            grid[i].removeAt(j);
+            mCellStore.shiftColumns(i, j + 1, -1);
+        }
+        if(grid[i].count() == 0) {
+            grid.removeAt(i);
+            mCellStore.shiftRows(i + 1, -1);
+        }
+    }
+    rebuildGridIndex();
+}
+
+void Scene::reindexRows(int first, int last)
+{
+    if(last < 0 || last >= grid.count())
+        last = grid.count() - 1;
+
+    for(int y = first; y <= last; ++y)
+        reindexColumns(y, 0);
+}
+
+void Scene::reindexColumns(int row, int first)
+{
+    const QList<Cell*> &r = grid.at(row);
+    for(int x = first; x < r.count(); ++x) {
+        if(r.at(x))
+            mGridIndex.insert(r.at(x), QPoint(x, row));
+    }
+}
+
+void Scene::rebuildGridIndex()
+{
+    mGridIndex.clear();
+    reindexRows(0);
+}
+
+bool Scene::checkGridIndex()
+{
+    bool ok = true;
+    int cells = 0;
+
     for(int y = 0; y < grid.count(); ++y) {
-        if(grid[y].contains(c)) {
-            grid[y].removeOne(c);
-            if(grid[y].count() == 0)
-                grid.removeAt(y);
-            c->setZValue(10);
-            break;
+        for(int x = 0; x < grid[y].count(); ++x) {
+            Cell *c = grid[y][x];
+            if(!c)
+                continue;
+            cells++;
+            if(mGridIndex.value(c, QPoint(-1, -1)) != QPoint(x, y)) {
+                WARN(QString("grid index is wrong for row %1 column %2").arg(y).arg(x));
+                ok = false;
+            }
         }
     }
+
+    if(cells != mGridIndex.count()) {
+        WARN(QString("grid index has %1 cells, the grid has %2").arg(mGridIndex.count()).arg(cells));
+        ok = false;
+    }
+
+    return ok;
+}
+
+void Scene::setGridCell(int row, int column, Cell *c)
+{
+    Cell *old = grid[row][column];
+    if(old)
+        mGridIndex.remove(old);
+
+    grid[row].replace(column, c);
+    if(c)
+        mGridIndex.insert(c, QPoint(column, row));
 }
 
 void Scene::updateRubberBand(int dx, int dy)
@@ -576,6 +687,18 @@ void Scene::mousePressEvent(QGraphicsSceneMouseEvent *e)
 
     if(mHasSelection && e->modifiers() == Qt::ControlModifier)
         mSelectionPath = selectionArea();
+
+    //stored cells become real cells when the user clicks on them.
+    if(mCellStore.count() > 0 && e->buttons() & Qt::LeftButton && e->modifiers() != Qt::ShiftModifier) {
+        ChartLayer *layer = getCurrentLayer();
+        if(layer->visible()) {
+            int index = mCellStore.cellAt(e->scenePos(), layer->uid());
+            if(index >= 0)
+                materializeCell(index);
+        }
+        //a group is moved as a whole so its stored stitches have to be Cells too.
+        materializeGroups(items(e->scenePos()));
+    }
 	//
     if(e->buttons() & Qt::LeftButton &&(e->modifiers() != Qt::ShiftModifier || selectedItems().count() >= 1))
         QGraphicsScene::mousePressEvent(e);
@@ -750,7 +873,7 @@ void Scene::mouseMoveEvent(QGraphicsSceneMouseEvent *e)
         } else if (mMoving) {
             QGraphicsScene::mouseMoveEvent(e);
             if(selectedItems().contains(mCenterSymbol)) {
-                updateGuidelines();
+                moveGuidelines();
             }
         }
     }
@@ -793,8 +916,13 @@ void Scene::mouseReleaseEvent(QGraphicsSceneMouseEvent *e)
         if(mHasSelection && e->modifiers() == Qt::ControlModifier) {
             path.addPath(mSelectionPath);
         }
+
+        if(mCellStore.count() > 0 && getCurrentLayer()->visible())
+            materializeCells(mCellStore.cellsIn(path, getCurrentLayer()->uid()));
+
 		blockSignals(true);
         setSelectionArea(path);
+        materializeGroups(selectedItems());
 		blockSignals(false);
 		emit selectionChanged();
 		mSelectionBand->hide();
@@ -1335,6 +1463,10 @@ void Scene::rowEditMouseMove(QGraphicsSceneMouseEvent* e)
     if(!mStartCell)
         return;
 
+    //stored stitches are added to the row as the user moves over them.
+    if(mCellStore.count() > 0 && getCurrentLayer()->visible())
+        materializeCell(mCellStore.cellAt(e->scenePos(), getCurrentLayer()->uid()));
+
     QPointF startPt = mRowLine->line().p1();
     
     QGraphicsItem* gi = itemAt(e->scenePos());
@@ -1460,7 +1592,7 @@ void Scene::createRow()
     
     if(selectedItems().count() <= 0)
         return;
-    
+
     QList<Cell*> r;
 
     foreach(QGraphicsItem* i, mRowSelection) {
@@ -1470,6 +1602,8 @@ void Scene::createRow()
         r.append(c);
     }
     grid.append(r);
+    reindexRows(grid.count() - 1);
+    CHECK_GRID_INDEX();
 
 }
 
@@ -1489,26 +1623,24 @@ void Scene::updateRow(int row)
     }
 
     grid.insert(row, r);
+    reindexRows(row);
+    mCellStore.shiftRows(row, 1);
+    CHECK_GRID_INDEX();
     
 }
 
 QPoint Scene::indexOf(Cell* c)
 {
-    for(int y = 0; y < grid.count(); ++y) {
-        if(grid[y].contains(c)) {
-            return QPoint(grid[y].indexOf(c), y);
-        }
-    }
-
-    return QPoint(-1,-1);
+    return mGridIndex.value(c, QPoint(-1,-1));
 }
 
 void Scene::highlightRow(int row)
 {
-
     if(row >= grid.count())
         return;
 
+    materializeRow(row);
+
     clearSelection();
     mRowSelection.clear();
 
@@ -1527,44 +1659,68 @@ void Scene::moveRowDown(int row)
 {
     QList<Cell*> r = grid.takeAt(row);
     grid.insert(row + 1, r);
+    reindexRows(row, row + 1);
+    mCellStore.swapRows(row, row + 1);
+    CHECK_GRID_INDEX();
     updateStitchRenderer();
 }
 
 void Scene::moveRowUp(int row)
 {
-
     QList<Cell*> r = grid.takeAt(row);
     grid.insert(row - 1, r);
+    reindexRows(row - 1, row);
+    mCellStore.swapRows(row - 1, row);
+    CHECK_GRID_INDEX();
     updateStitchRenderer();
     
 }
 
 void Scene::removeRow(int row)
 {
-
     QList<Cell*> r = grid.takeAt(row);
 
     foreach(Cell* c, r) {
+        if(!c)
+            continue;
         c->useAlternateRenderer(false);
+        mGridIndex.remove(c);
     }
 
+    foreach(int index, mCellStore.cellsInRow(row)) {
+        mCellStore.setColor(index, Cell::alternateColor(mCellStore.stitch(index),
+                                                        mCellStore.color(index), false));
+    }
+    mCellStore.removeRow(row);
+    reindexRows(row);
+    CHECK_GRID_INDEX();
+
     updateStitchRenderer();
 
 }
 
 void Scene::updateStitchRenderer()
 {
-
     for(int i = 0; i < grid.count(); ++i) {
-        foreach(Cell* c, grid[i]) {
-            if(!c) {
+        for(int j = 0; j < grid[i].count(); ++j) {
+            Cell *c = grid[i][j];
+            if(c) {
+                c->useAlternateRenderer((i % 2));
+                continue;
+            }
+
+            int index = mCellStore.gridCell(i, j);
+            if(index < 0) {
                 WARN("cell doesn't exist but it's in the grid");
                 continue;
             }
-            c->useAlternateRenderer((i % 2));
+            mCellStore.setColor(index, Cell::alternateColor(mCellStore.stitch(index),
+                                                            mCellStore.color(index), (i % 2)));
         }
     }
 
+    if(mCellStore.gridCellCount() > 0)
+        updateCellStoreItems();
 }
 
 void Scene::render(QPainter *painter, const QRectF &target, const QRectF &source,
@@ -1610,6 +1766,8 @@ void Scene::drawRowLines(int row)
     if(grid.count() <= row)
         return;
 
+    materializeRow(row);
+
     hideRowLines();
 
     QPointF start, end;
@@ -1821,140 +1979,37 @@ void Scene::align(int vertical, int horizontal)
 
 void Scene::updateGuidelines()
 {
-    int columns = mGuidelines.columns();
-    int rows = mGuidelines.rows();
-
-    int spacingW = mGuidelines.cellWidth();
-    int spacingH = mGuidelines.cellHeight();
-
-    QGraphicsItem *i = 0;
-
-    if(mGuidelinesLines.count() > 0) {
-        foreach(QGraphicsItem *item, mGuidelinesLines) {
-            removeItem(item);
-            mGuidelinesLines.removeOne(item);
-            delete item;
+    if(mGuidelines.type() == "None") {
+        if(mGuideline) {
+            removeItem(mGuideline);
+            delete mGuideline;
+            mGuideline = 0;
         }
-    }
-
-    if(mGuidelines.type() == "None")
         return;
-	
-	//get the center position, or make it 0 if centerpos does not exist yet
-	QPointF center;
-	if (mCenterSymbol)
-		center = mCenterSymbol->pos();
-	else
-		center = QPointF(0,0);
-	
-	//create the graphical representation
-	if(mGuidelines.type() == "Rows") {
-		generateGuidelinesRows(spacingW, spacingH, columns, rows, center);
-	} else if (mGuidelines.type() == "Rounds") {
-		generateGuidelinesRounds(spacingW, spacingH, columns, rows, center);
-	} else if (mGuidelines.type() == "Triangles") {
-		generateGuidelinesTriangles(spacingW, spacingH, columns, rows, center);
-	}
-
-    updateSceneRect();
-}
-
-void Scene::generateGuidelinesRows(int spacingW, int spacingH, int columns, int rows, QPointF center)
-{
-    QGraphicsItem *i = 0;
-
-	//generate columns
-	for(int c = 0; c <= columns; c++) {
-		i = addLine(
-			c*spacingW + center.x(),
-			center.y(),
-			c*spacingW + center.x(),
-			spacingH*rows + center.y()
-		);
-		i->setZValue(-1);
-		mGuidelinesLines.append(i);
-    }
-	//generate rows
-    for(int r = 0; r <= rows; r++) {
-		 i = addLine(
-			center.x(),
-			center.y() + r*spacingH,
-			center.x() + spacingW*columns,
-			center.y() + r*spacingH
-		);
-		
-		i->setZValue(-1);
-		mGuidelinesLines.append(i);
     }
-}
-
-void Scene::generateGuidelinesRounds(int spacingW, int spacingH, int columns, int rows, QPointF center)
-{
-    QGraphicsItem *i = 0;
 
-	//generate dividing lines
-	for(int c = 0; c <= columns; c++) {
-        qreal radians = (360.0 / columns * c) * M_PI / 180;
-		qreal outterX = center.x() + (spacingH * (rows + 1)) /*distance*/ * sin(radians);
-		qreal outterY = center.y() + (spacingH * (rows + 1)) /*distance*/ * cos(radians);
+    if(!mGuideline) {
+        mGuideline = new Guideline();
+        addItem(mGuideline);
+    }
 
-		qreal innerX = center.x() + spacingH * sin(radians);
-		qreal innerY = center.y() + spacingH * cos(radians);
+    mGuideline->setGrid(mGuidelines.type(), mGuidelines.columns(), mGuidelines.rows(),
+                        mGuidelines.cellWidth(), mGuidelines.cellHeight());
+    moveGuidelines();
 
-		i = addLine(innerX,innerY,outterX,outterY);
-		i->setZValue(-1);
-		mGuidelinesLines.append(i);
-    }
-	
-	//generate circles
-    for(int r = 0; r <= rows; r++) {
-	   Guideline *g = new Guideline(
-			QRectF(
-				center.x() + -(r+1)*spacingH,
-				center.y() + -(r+1)*spacingH,
-				2*(r+1)*spacingH,
-				2*(r+1)*spacingH)
-			,0
-			,this
-		)
-		;
-		g->setZValue(-1);
-		mGuidelinesLines.append(g);
-    }
+    updateSceneRect();
 }
 
-void Scene::generateGuidelinesTriangles(int spacingW, int spacingH, int columns, int rows, QPointF center)
+void Scene::moveGuidelines()
 {
-	Q_UNUSED(columns);
-    QGraphicsItem *i = 0;
-	
-	//generate the horizontal lines
-	for(int r = 0; r < rows; r++) {
-        qreal height = (r+1) * spacingH;
-		qreal offsetX = (r+1) * spacingW/2;
+    if(!mGuideline)
+        return;
 
-		i = addLine(-offsetX + center.x(),height + center.y(),offsetX + center.x(),height + center.y());
-		i->setZValue(-1);
-		mGuidelinesLines.append(i);
-    }
-	
-	//generate the slanted lines
-	qreal maxX = (rows) * spacingW/2;
-	qreal maxY = (rows) * spacingH;
-	for(int c = 0; c < rows; c++) {
-		
-		qreal startX = -maxX + ( 2 * c * (maxX / rows));
-		qreal startY = maxY;
-		qreal endX = maxX - ( (rows - c) * (maxX / rows));
-		qreal endY = c * maxY / rows;
-        
-		i = addLine(startX + center.x(), startY + center.y(), endX + center.x(), endY + center.y());
-		i->setZValue(-1);
-		mGuidelinesLines.append(i);
-		i = addLine(-startX + center.x(), startY + center.y(), -endX + center.x(), endY + center.y());
-		i->setZValue(-1);
-		mGuidelinesLines.append(i);
-    }
+	//get the center position, or make it 0 if centerpos does not exist yet
+	if (mCenterSymbol)
+		mGuideline->setPos(mCenterSymbol->pos());
+	else
+		mGuideline->setPos(QPointF(0,0));
 }
 
 QList<QGraphicsItem*> Scene::sortItemsHorizontally(QList<QGraphicsItem*> unsortedItems, int sortEdge)
@@ -2254,14 +2309,21 @@ void Scene::arrangeGrid(QSize grd, QSize alignment, QSize spacing, bool useSelec
         //create new cells.
         //TODO: figure out how to deal with spacing.
 
+        //FIXME: use the user selected stitch
+        Stitch *s = lookupStitch(mDefaultStitch);
+        unsigned int layer = getCurrentLayer()->uid();
+
+        //add all the stitches without the scene index and build the index once at the end.
+        ItemIndexMethod indexMethod = itemIndexMethod();
+        setItemIndexMethod(QGraphicsScene::NoIndex);
+
         for(int x = grd.width(); x > 0; --x) {
 
             QList<Cell*> r;
             for(int y = grd.height(); y > 0; --y) {
                 Cell* c = new Cell();
-                //FIXME: use the user selected stitch
-                c->setStitch(mDefaultStitch);
-				c->setLayer(getCurrentLayer()->uid());
+                c->setStitch(s);
+				c->setLayer(layer);
                 addItem(c);
                 r.append(c);
                 
@@ -2271,6 +2333,10 @@ void Scene::arrangeGrid(QSize grd, QSize alignment, QSize spacing, bool useSelec
 
             grid.insert(0, r);
         }
+        setItemIndexMethod(indexMethod);
+        reindexRows(0);
+        mCellStore.shiftRows(0, grd.width());
+        CHECK_GRID_INDEX();
     }
 }
 
@@ -2278,10 +2344,15 @@ void Scene::gridAddRow(QList< Cell*> row, bool append, int before)
 {
     if(append) {
         grid.append(row);
+        reindexRows(grid.count() - 1);
     } else {
-        if(grid.length() >= before)
+        if(grid.length() >= before) {
             grid.insert(before, row);
+            reindexRows(before);
+            mCellStore.shiftRows(before, 1);
+        }
     }
+    CHECK_GRID_INDEX();
 }
 
 void Scene::propertiesUpdate(QString property, QVariant newValue)
@@ -3231,41 +3302,14 @@ void Scene::removeLayerUndoable(unsigned int uid)
 	mUndoStack.beginMacro("remove layer");
 	
 	ChartLayer* layer = mLayers[uid];
+	materializeLayer(uid);
 	
 	//first, remove all items in the layer
 	QList<QGraphicsItem*> toRemove;
-	QList<QGraphicsItem*> itemslist = items();
-	
-	foreach(QGraphicsItem *item, itemslist) {
-		switch(item->type()) {
-			case Cell::Type: {
-				Cell *c = qgraphicsitem_cast<Cell*>(item);
-				if (c->layer() == layer->uid() && c->parentItem() == NULL)
-					toRemove.append(c);
-				break;
-			}
-			case Indicator::Type: {
-				Indicator*c = qgraphicsitem_cast<Indicator*>(item);
-				if (c->layer() == layer->uid() && c->parentItem() == NULL)
-					toRemove.append(c);
-				break;
-			}
-			case ItemGroup::Type: {
-				ItemGroup *c = qgraphicsitem_cast<ItemGroup*>(item);
-				if (c->layer() == layer->uid() && c->parentItem() == NULL)
-					toRemove.append(c);
-				break;
-			}
-			case ChartImage::Type: {
-				ChartImage *c = qgraphicsitem_cast<ChartImage*>(item);
-				if (c->layer() == layer->uid() && c->parentItem() == NULL)
-					toRemove.append(c);
-				break;
-			}
-			default:
-				WARN("Unknown data type: " + QString::number(item->type()));
-				break;
-		}
+	
+	foreach(QGraphicsItem *item, layerItems(uid)) {
+		if (item->parentItem() == NULL)
+			toRemove.append(item);
 	}
 	
 	mUndoStack.push(new RemoveItems(this, toRemove));
@@ -3287,32 +3331,28 @@ void Scene::mergeLayer(unsigned int from, unsigned int to)
 	if (mSelectedLayer != NULL)
 	{
 		mUndoStack.beginMacro("merge layers");
-		QList<QGraphicsItem*> itemslist = items();
+		materializeLayer(from);
 		//move all items in the from layer to the to layer
-		foreach(QGraphicsItem *item, itemslist) {
+		foreach(QGraphicsItem *item, layerItems(from)) {
 			switch(item->type()) {
 				case Cell::Type: {
 					Cell *c = qgraphicsitem_cast<Cell*>(item);
-					if (c->layer() == from)
-						mUndoStack.push(new SetLayerStitch(this, c, to));
+					mUndoStack.push(new SetLayerStitch(this, c, to));
 					break;
 				}
 				case Indicator::Type: {
 					Indicator*c = qgraphicsitem_cast<Indicator*>(item);
-					if (c->layer() == from)
-						mUndoStack.push(new SetLayerIndicator(this, c, to));
+					mUndoStack.push(new SetLayerIndicator(this, c, to));
 					break;
 				}
 				case ItemGroup::Type: {
 					ItemGroup *c = qgraphicsitem_cast<ItemGroup*>(item);
-					if (c->layer() == from)
-						mUndoStack.push(new SetLayerGroup(this, c, to));
+					mUndoStack.push(new SetLayerGroup(this, c, to));
 					break;
 				}
 				case ChartImage::Type: {
 					ChartImage *c = qgraphicsitem_cast<ChartImage*>(item);
-					if (c->layer() == from)
-						mUndoStack.push(new SetLayerImage(this, c, to));
+					mUndoStack.push(new SetLayerImage(this, c, to));
 					break;
 				}
 				default:
@@ -3334,42 +3374,24 @@ void Scene::selectLayer(unsigned int uid)
 {
 	clearSelection();
 	
+	ChartLayer* previous = mSelectedLayer;
 	ChartLayer* layer = mLayers[uid];
-	if (layer != NULL) {
-		mSelectedLayer = layer;
+	if (layer == NULL)
+		return;
+	mSelectedLayer = layer;
+	
+	//only the items in the old and the new layer change.
+	if (previous != NULL && previous != layer) {
+		foreach(QGraphicsItem *item, layerItems(previous->uid())) {
+			item->setFlag(QGraphicsItem::ItemIsSelectable, false);
+			item->setSelected(false);
+		}
 	}
 	
-    foreach(QGraphicsItem *item, items()) {
-        switch(item->type()) {
-            case Cell::Type: {
-			Cell *c = qgraphicsitem_cast<Cell*>(item);
-			c->setFlag(QGraphicsItem::ItemIsSelectable, c->layer() == layer->uid() && c->parentItem() == NULL);
-			c->setSelected(false);
-                break;
-            }
-            case Indicator::Type: {
-			Indicator*c = qgraphicsitem_cast<Indicator*>(item);
-			c->setFlag(QGraphicsItem::ItemIsSelectable, c->layer() == layer->uid() && c->parentItem() == NULL);
-			c->setSelected(false);
-                break;
-            }
-            case ItemGroup::Type: {
-			ItemGroup *c = qgraphicsitem_cast<ItemGroup*>(item);
-			c->setFlag(QGraphicsItem::ItemIsSelectable, c->layer() == layer->uid() && c->parentItem() == NULL);
-			c->setSelected(false);
-                break;
-            }
-            case ChartImage::Type: {
-			ChartImage *c = qgraphicsitem_cast<ChartImage*>(item);
-			c->setFlag(QGraphicsItem::ItemIsSelectable, c->layer() == layer->uid() && c->parentItem() == NULL);
-			c->setSelected(false);
-                break;
-            }
-            default:
-                WARN("Unknown data type: " + QString::number(item->type()));
-                break;
-        }
-    }
+	foreach(QGraphicsItem *item, layerItems(layer->uid())) {
+		item->setFlag(QGraphicsItem::ItemIsSelectable, item->parentItem() == NULL);
+		item->setSelected(false);
+	}
 }
 
 void Scene::editedLayer(ChartLayer* layer)
@@ -3377,49 +3399,15 @@ void Scene::editedLayer(ChartLayer* layer)
 	if (layer == NULL || mSelectedLayer == NULL)
 		return;
 	
-    foreach(QGraphicsItem *item, items()) {
-        switch(item->type()) {
-            case Cell::Type: {
-                Cell *c = qgraphicsitem_cast<Cell*>(item);
-                if (c->layer() == layer->uid()) {
-                c->setVisible(layer->visible());
-                c->setFlag(QGraphicsItem::ItemIsSelectable, layer->visible()
-                    && c->parentItem() == NULL && layer->uid() == mSelectedLayer->uid());
-                } 
-				break;
-            }
-            case Indicator::Type: {
-                Indicator*c = qgraphicsitem_cast<Indicator*>(item);
-                if (c->layer() == layer->uid()) {
-                c->setVisible(layer->visible());
-                c->setFlag(QGraphicsItem::ItemIsSelectable, layer->visible()
-                    && c->parentItem() == NULL && layer->uid() == mSelectedLayer->uid());
-                }
-                break;
-            }
-            case ItemGroup::Type: {
-                ItemGroup *c = qgraphicsitem_cast<ItemGroup*>(item);
-                if (c->layer() == layer->uid()) {
-                c->setVisible(layer->visible());
-                c->setFlag(QGraphicsItem::ItemIsSelectable, layer->visible()
-                    && c->parentItem() == NULL && layer->uid() == mSelectedLayer->uid());
-                }
-				break;
-            } case ChartImage::Type: {
-                ChartImage *c = qgraphicsitem_cast<ChartImage*>(item);
-                if (c->layer() == layer->uid()) {
-                c->setVisible(layer->visible());
-                c->setFlag(QGraphicsItem::ItemIsSelectable, layer->visible()
-                    && c->parentItem() == NULL && layer->uid() == mSelectedLayer->uid());
-                }
-				break;
-				
-			}
-            default:
-                WARN("Unknown data type: " + QString::number(item->type()));
-                break;
-        }
-    }
+	foreach(QGraphicsItem *item, layerItems(layer->uid())) {
+		item->setVisible(layer->visible());
+		item->setFlag(QGraphicsItem::ItemIsSelectable, layer->visible()
+			&& item->parentItem() == NULL && layer->uid() == mSelectedLayer->uid());
+	}
+	
+	CellStoreItem *stored = mCellStoreItems.value(layer->uid());
+	if (stored)
+		stored->setVisible(layer->visible());
 }
 
 ChartLayer* Scene::getCurrentLayer()
@@ -3456,6 +3444,199 @@ void Scene::refreshLayers()
 	}
 }
 
+void Scene::layerItemChange(QGraphicsItem *item, unsigned int layer, QGraphicsItem::GraphicsItemChange change)
+{
+	Scene *scene = qobject_cast<Scene*>(item->scene());
+	if (!scene)
+		return;
+	
+	if (change == QGraphicsItem::ItemSceneChange) {
+		QHash<unsigned int, QSet<QGraphicsItem*> >::iterator it = scene->mLayerItems.find(layer);
+		if (it != scene->mLayerItems.end())
+			it->remove(item);
+	} else if (change == QGraphicsItem::ItemSceneHasChanged) {
+		scene->mLayerItems[layer].insert(item);
+	}
+}
+
+void Scene::layerItemMoved(QGraphicsItem *item, unsigned int oldLayer, unsigned int newLayer)
+{
+	Scene *scene = qobject_cast<Scene*>(item->scene());
+	if (!scene || oldLayer == newLayer)
+		return;
+	
+	scene->mLayerItems[oldLayer].remove(item);
+	scene->mLayerItems[newLayer].insert(item);
+}
+
+QList<QGraphicsItem*> Scene::layerItems(unsigned int uid) const
+{
+	return mLayerItems.value(uid).toList();
+}
+
+void Scene::addCellRecord(const CellRecord &record)
+{
+    if(!record.stitch)
+        return;
+
+    int index = mCellStore.append(record);
+
+    CellStoreItem *item = mCellStoreItems.value(record.layer);
+    if(!item) {
+        item = new CellStoreItem(&mCellStore, record.layer);
+        mCellStoreItems.insert(record.layer, item);
+        addItem(item);
+        ChartLayer *layer = mLayers.value(record.layer);
+        if(layer)
+            item->setVisible(layer->visible());
+    } else {
+        item->extendBounds(mCellStore.sceneBoundingRect(index));
+    }
+
+    //count the stitch and colors the same way a Cell does when it's loaded.
+    emit stitchChanged("", record.stitch->name());
+    if(record.bgColor != QColor(Qt::white))
+        emit colorChanged("#ffffff", record.bgColor.name());
+    emit colorChanged("", record.color.name());
+}
+
+Cell* Scene::takeStoredCell(int index)
+{
+    CellRecord r = mCellStore.record(index);
+    mCellStore.remove(index);
+
+    //set up the cell before it's added to the scene so the pattern stitches and colors aren't counted twice.
+    Cell *c = new Cell();
+    c->setStitch(r.stitch);
+    c->setBgColor(r.bgColor);
+    c->setColor(r.color);
+    c->setLayer(r.layer);
+    c->setZValue(10);
+    c->setPos(r.pos);
+    c->setTransform(r.transform);
+    ChartItemTools::recalculateTransformations(c);
+
+    addItem(c);
+
+    ChartLayer *layer = mLayers.value(r.layer);
+    if(layer)
+        c->setVisible(layer->visible());
+    c->setFlag(QGraphicsItem::ItemIsSelectable, r.layer == getCurrentLayer()->uid());
+
+    //the stored cells are kept in line with the grid so the position is still free.
+    if(r.row >= 0 && r.row < grid.count() && r.column < grid[r.row].count() && !grid[r.row][r.column]) {
+        setGridCell(r.row, r.column, c);
+        c->setZValue(100);
+    }
+
+    if(r.group && mGroups.contains(r.group)) {
+        r.group->addToGroup(c);
+        c->setFlag(QGraphicsItem::ItemIsSelectable, false);
+    }
+
+    if(r.id)
+        mMaterializedCells.append(qMakePair(r.id, QPointer<Cell>(c)));
+
+    return c;
+}
+
+void Scene::updateCellStoreItems()
+{
+    foreach(CellStoreItem *item, mCellStoreItems)
+        item->updateBounds();
+}
+
+Cell* Scene::materializeCell(int index)
+{
+    if(index < 0 || index >= mCellStore.count())
+        return 0;
+
+    //a group is always edited as a whole.
+    if(mCellStore.group(index)) {
+        QList<int> indexes = mCellStore.cellsInGroup(mCellStore.group(index));
+        //the cells are taken from the highest index down.
+        return materializeCells(indexes).value(indexes.count() - 1 - indexes.indexOf(index));
+    }
+
+    Cell *c = takeStoredCell(index);
+    updateCellStoreItems();
+    return c;
+}
+
+QList<Cell*> Scene::materializeCells(QList<int> indexes)
+{
+    QList<Cell*> cells;
+    if(indexes.isEmpty())
+        return cells;
+
+    //take the rest of the stored cells of any group that is touched.
+    QSet<int> all = indexes.toSet();
+    QSet<ItemGroup*> groups;
+    foreach(int index, indexes) {
+        if(mCellStore.group(index))
+            groups.insert(mCellStore.group(index));
+    }
+    foreach(ItemGroup *g, groups)
+        all.unite(mCellStore.cellsInGroup(g).toSet());
+    indexes = all.toList();
+
+    //removing a stored cell moves the last one into its place so work from the end.
+    qSort(indexes.begin(), indexes.end(), qGreater<int>());
+    foreach(int index, indexes)
+        cells.append(takeStoredCell(index));
+
+    updateCellStoreItems();
+    return cells;
+}
+
+void Scene::materializeLayer(unsigned int uid)
+{
+    materializeCells(mCellStore.cellsInLayer(uid));
+}
+
+void Scene::materializeRow(int row)
+{
+    if(mCellStore.gridCellCount() == 0)
+        return;
+
+    materializeCells(mCellStore.cellsInRow(row));
+}
+
+Stitch* Scene::gridStitch(int row, int column)
+{
+    if(row < 0 || row >= grid.count() || column < 0 || column >= grid[row].count())
+        return 0;
+
+    if(grid[row][column])
+        return grid[row][column]->stitch();
+
+    int index = mCellStore.gridCell(row, column);
+    if(index >= 0)
+        return mCellStore.stitch(index);
+    return 0;
+}
+
+QList<QPair<quint32, QPointer<Cell> > > Scene::takeMaterializedCells()
+{
+    QList<QPair<quint32, QPointer<Cell> > > cells = mMaterializedCells;
+    mMaterializedCells.clear();
+    return cells;
+}
+
+void Scene::materializeGroups(QList<QGraphicsItem*> items)
+{
+    if(mCellStore.count() == 0)
+        return;
+
+    QList<int> indexes;
+    foreach(QGraphicsItem *item, items) {
+        QGraphicsItem *top = item->topLevelItem();
+        if(top->type() == ItemGroup::Type)
+            indexes << mCellStore.cellsInGroup(qgraphicsitem_cast<ItemGroup*>(top));
+    }
+    materializeCells(indexes);
+}
+
 
 /*************************************************\
 | Rounds Specific functions:                      |
@@ -3517,13 +3698,21 @@ void Scene::createRoundsChart(int rows, int cols, QString stitch, QSizeF rowSize
 
     mDefaultSize = rowSize;
 
+    Stitch *s = lookupStitch(stitch);
+
+    //add all the stitches without the scene index and build the index once at the end.
+    ItemIndexMethod indexMethod = itemIndexMethod();
+    setItemIndexMethod(QGraphicsScene::NoIndex);
+
     for(int i = 0; i < rows; ++i) {
         //FIXME: this padding should be dependant on the height of the sts.
         int pad = i * increaseBy;
 
-        createRow(i, cols + pad, stitch);
+        createRow(i, cols + pad, s);
     }
 
+    setItemIndexMethod(indexMethod);
+
     setShowChartCenter(Settings::inst()->value("showChartCenter").toBool());
 
     updateSceneRect();
@@ -3559,21 +3748,63 @@ QPointF Scene::calcPoint(double radius, double angleInDegrees, QPointF origin)
     return QPointF(x, y);
 }
 
-void Scene::createRow(int row, int columns, QString stitch)
+Stitch* Scene::lookupStitch(QString name)
 {
+    Stitch *s = StitchLibrary::inst()->findStitch(name);
 
-    Cell* c = 0;
+    if(!s) {
+        QString st = Settings::inst()->value("defaultStitch").toString();
+        s = StitchLibrary::inst()->findStitch(st);
+    }
 
+    return s;
+}
+
+void Scene::createRow(int row, int columns, QString stitch)
+{
+    createRow(row, columns, lookupStitch(stitch));
+}
+
+void Scene::createRow(int row, int columns, Stitch *s)
+{
     QList<Cell*> modelRow;
     for(int i = 0; i < columns; ++i) {
-        c = new Cell();
-        c->setStitch(stitch);
+        Cell *c = new Cell();
+        c->setStitch(s);
         addItem(c);
-        
+
         modelRow.append(c);
-        setCellPosition(row, i, c, columns);
     }
+
+    if(columns > 0) {
+        //all the stitches in the round are the same so they share one size and pivot point.
+        QRectF rect = modelRow.first()->boundingRect();
+        QPointF pivotPt = QPointF(rect.width()/2, rect.height());
+        QPointF center = QPointF(rect.width()/2, rect.height()/2);
+
+        double widthInDegrees = 360.0 / columns;
+        double radius = defaultSize().height() * (row + 1) + (32);
+
+        QVector<QPointF> positions(columns);
+        QVector<qreal> angles(columns);
+        for(int i = 0; i < columns; ++i) {
+            double degrees = widthInDegrees * i;
+            double radians = degrees * M_PI / 180;
+            positions[i] = QPointF(radius * cos(radians), radius * sin(radians)) - center;
+            angles[i] = degrees + 90;
+        }
+
+        for(int i = 0; i < columns; ++i) {
+            Cell *c = modelRow.at(i);
+            c->setTransformOriginPoint(pivotPt);
+            c->setRotation(angles.at(i));
+            c->setPos(positions.at(i));
+        }
+    }
+
     grid.insert(row, modelRow);
+    reindexRows(row);
+    mCellStore.shiftRows(row, 1);
 
 }
 
@@ -3629,7 +3860,14 @@ void Scene::setGuidelinesType(QString guides)
 void Scene::replaceStitches(QString original, QString replacement)
 {
 
-    undoStack()->beginMacro(tr("replace stitches"));
+    QList<int> stored;
+    for(int i = 0; i < mCellStore.count(); ++i) {
+        if(mCellStore.stitch(i)->name() == original)
+            stored.append(i);
+    }
+    materializeCells(stored);
+
+    QVector<Cell*> cells;
     foreach(QGraphicsItem *i, items()) {
         if(!i)
             continue;
@@ -3640,18 +3878,26 @@ void Scene::replaceStitches(QString original, QString replacement)
         if(!c)
             continue;
 
-        if(c->stitch()->name() == original) {
-            undoStack()->push(new SetCellStitch(c, replacement));
-        }
-
+        if(c->stitch()->name() == original)
+            cells.append(c);
     }
-    undoStack()->endMacro();
+
+    if(cells.count() > 0)
+        undoStack()->push(new ReplaceCellStitches(this, cells, original, replacement));
 
 }
 
 void Scene::replaceColor(QColor original, QColor replacement, int selection)
 {
-    undoStack()->beginMacro(tr("replace color"));
+    QList<int> stored;
+    for(int i = 0; i < mCellStore.count(); ++i) {
+        if(((selection == 1 || selection == 3) && mCellStore.color(i).name() == original.name()) ||
+           ((selection == 2 || selection == 3) && mCellStore.bgColor(i).name() == original.name()))
+            stored.append(i);
+    }
+    materializeCells(stored);
+
+    QVector<Cell*> fgCells, bgCells;
     foreach(QGraphicsItem *i, items()) {
         if(!i)
             continue;
@@ -3664,17 +3910,24 @@ void Scene::replaceColor(QColor original, QColor replacement, int selection)
             continue;
 
         if(selection == 1 || selection == 3) {
-            if(c->color().name() == original.name()) {
-                undoStack()->push(new SetCellColor(c, replacement));
-            }
+            if(c->color().name() == original.name())
+                fgCells.append(c);
         }
 
         if(selection == 2 || selection == 3) {
-            if(c->bgColor().name() == original.name()) {
-                undoStack()->push(new SetCellBgColor(c, replacement));
-            }
+            if(c->bgColor().name() == original.name())
+                bgCells.append(c);
         }
 
     }
+
+    if(fgCells.isEmpty() && bgCells.isEmpty())
+        return;
+
+    undoStack()->beginMacro(tr("replace color"));
+    if(!fgCells.isEmpty())
+        undoStack()->push(new ReplaceCellColors(this, fgCells, replacement, false));
+    if(!bgCells.isEmpty())
+        undoStack()->push(new ReplaceCellColors(this, bgCells, replacement, true));
     undoStack()->endMacro();
 }
\ No newline at end of file
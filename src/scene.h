@@ -27,10 +27,12 @@
 #include "ChartImage.h"
 
 #include <QHash>
-#include <QUndoStack>
+#include <QSet>
+#include "undostack.h"
 #include <QRubberBand>
 #include <functional>
 
+#include "cellstore.h"
 #include "chartLayer.h"
 #include "indicator.h"
 #include "itemgroup.h"
@@ -103,6 +105,8 @@ QDebug operator<<(QDebug d, IndicatorProperties & properties);
 Q_DECLARE_METATYPE(IndicatorProperties)
 
 class QKeyEvent;
+class CellStoreItem;
+class Guideline;
 
 class Scene : public QGraphicsScene
 {
@@ -110,6 +114,8 @@ class Scene : public QGraphicsScene
     friend class FileFactory;
     friend class File_v1;
     friend class File_v2;
+    friend class File_v3;
+    friend class Journal;
     friend class RowEditDialog;
     friend class TextView;
 
@@ -171,7 +177,7 @@ public:
     void setEditFgColor(QColor color) { mEditFgColor = color; }
     void setEditBgColor(QColor color) { mEditBgColor = color; }
 
-    QUndoStack* undoStack() { return &mUndoStack; }
+    UndoStack* undoStack() { return &mUndoStack; }
     
     QStringList modes();
 
@@ -213,12 +219,66 @@ public:
 	//returns the layer with the given id or creates a new one with that id if none exists yet
 	ChartLayer* getLayer(int uid);
 
+	/**
+	 * The chart items call these to keep the list of items in each layer up to date
+	 * when they're added to or removed from a Scene or moved to another layer.
+	 */
+	static void layerItemChange(QGraphicsItem *item, unsigned int layer, QGraphicsItem::GraphicsItemChange change);
+	static void layerItemMoved(QGraphicsItem *item, unsigned int oldLayer, unsigned int newLayer);
+	//all the cells, indicators, groups and images in layer @uid
+	QList<QGraphicsItem*> layerItems(unsigned int uid) const;
+
+    /**
+     * Compact storage for stitches that aren't being edited.
+     * Stored stitches are drawn by one CellStoreItem per layer
+     * and turned back into Cells when the user works with them.
+     */
+    CellStore* cellStore() { return &mCellStore; }
+    void addCellRecord(const CellRecord &record);
+    Cell* materializeCell(int index);
+    QList<Cell*> materializeCells(QList<int> indexes);
+    void materializeLayer(unsigned int uid);
+    /**
+     * Turn the stored cells in @row of the grid into Cells.
+     */
+    void materializeRow(int row);
+    /**
+     * Returns the stitch at @row, @column of the grid whether it's a Cell or a stored cell.
+     */
+    Stitch* gridStitch(int row, int column);
+    /**
+     * Turn the stored cells of the groups @items belong to into Cells.
+     */
+    void materializeGroups(QList<QGraphicsItem*> items);
+    /**
+     * The stored cells that became Cells since the last call, by the journal id they had
+     * in the store, so the journal can replace them with the Cells.
+     */
+    QList<QPair<quint32, QPointer<Cell> > > takeMaterializedCells();
+
     /**
      * Add a row of stitches to the grid.
      * If append == false, use the rowPos to insert the row into the grid.
      */
     void gridAddRow(QList< Cell* > row, bool append = true, int before = 0);
 
+    /**
+     * Put @c into the grid at @row, @column replacing what was there.
+     */
+    void setGridCell(int row, int column, Cell *c);
+    /**
+     * Remove the grid entries that don't hold a Cell or a stored cell, and any empty rows.
+     */
+    void removeGridGaps();
+    /**
+     * Rebuild the cell to (row, column) index after the grid has been changed directly.
+     */
+    void rebuildGridIndex();
+    /**
+     * Compare the grid index to the grid, warns about and returns false on any difference.
+     */
+    bool checkGridIndex();
+
     /**
      * @brief propertiesUpdate - updates the properties of all selected items.
      * @param property - name of the property to update
@@ -258,6 +318,12 @@ protected:
      */
     void removeFromRows(Cell *c);
 
+    /**
+     * Update the grid index for rows @first to @last (default: to the end of the grid).
+     */
+    void reindexRows(int first, int last = -1);
+    void reindexColumns(int row, int first);
+
     
 public slots:
 	/**
@@ -308,6 +374,8 @@ signals:
 	void showPropertiesSignal();
     void stitchChanged(QString oldSt, QString newSt = 0);
     void colorChanged(QString oldColor, QString newColor);
+    void stitchesChanged(QString oldSt, QString newSt, int count);
+    void colorsChanged(QString oldColor, QString newColor, int count);
 	void layersChanged(QList<ChartLayer*>& layers, ChartLayer* selected);
 
     void rowSelected();
@@ -496,6 +564,8 @@ private:
 
     //rows keeps track of the st order for individual rows;
     QList< QList<Cell*> > grid;
+    //reverse lookup for the grid: QPoint(column, row) of every cell on it.
+    QHash<Cell*, QPoint> mGridIndex;
     
     qreal scenePosToAngle(QPointF pt);
 
@@ -508,7 +578,7 @@ private:
      */
     QList<QGraphicsItem*> mRowSelection;
     
-    QUndoStack mUndoStack;
+    UndoStack mUndoStack;
     
     QList<Indicator*> mIndicators;
 
@@ -530,6 +600,18 @@ private:
 	
 	QHash<unsigned int, ChartLayer*> mLayers;
 	ChartLayer* mSelectedLayer;
+
+	QHash<unsigned int, QSet<QGraphicsItem*> > mLayerItems;
+
+    CellStore mCellStore;
+    QHash<unsigned int, CellStoreItem*> mCellStoreItems;
+    QList<QPair<quint32, QPointer<Cell> > > mMaterializedCells;
+
+    /**
+     * Create a Cell from a stored cell without updating the CellStoreItems.
+     */
+    Cell* takeStoredCell(int index);
+    void updateCellStoreItems();
 	
 	bool mbackgroundIsEnabled;
 	
@@ -551,6 +633,11 @@ public:
 
     void createRoundsChart(int rows, int cols, QString stitch, QSizeF rowSize, int increaseBy);
     void createRow(int row, int columns, QString stitch);
+    /**
+     * Create a whole round of @columns stitches @s.
+     * The positions and rotations are calculated in one pass for the round.
+     */
+    void createRow(int row, int columns, Stitch *s);
 
     /**
      * Does the chart have a symbol at all?
@@ -569,6 +656,11 @@ protected:
 private:
     QPointF calcPoint(double radius, double angleInDegrees, QPointF origin);
 
+    /**
+     * Find the stitch @name or the default stitch, like Cell::setStitch(QString).
+     */
+    Stitch* lookupStitch(QString name);
+
     QGraphicsItem *mCenterSymbol;
     bool mShowChartCenter;
 	bool mSnapAngle;
@@ -588,6 +680,13 @@ public:
      */
     void replaceColor(QColor original, QColor replacement, int selection);
 
+    /**
+     * Update the pattern stitches and colors for @count cells at once.
+     * Used by commands that change many cells with their signals blocked.
+     */
+    void emitStitchesChanged(QString oldSt, QString newSt, int count) { emit stitchesChanged(oldSt, newSt, count); }
+    void emitColorsChanged(QString oldColor, QString newColor, int count) { emit colorsChanged(oldColor, newColor, count); }
+
 protected slots:
     /**
      * @brief updateGuidelines - draw the guidelines
@@ -595,14 +694,15 @@ protected slots:
     void updateGuidelines();
 
 private:
-	void generateGuidelinesRows(int spacingW, int spacingH, int columns, int rows, QPointF center);
-	void generateGuidelinesRounds(int spacingW, int spacingH, int columns, int rows, QPointF center);
-	void generateGuidelinesTriangles(int spacingW, int spacingH, int columns, int rows, QPointF center);
+    /**
+     * @brief moveGuidelines - keep the guidelines on the chart center without rebuilding them
+     */
+    void moveGuidelines();
 
     /**
-     * @brief mGuidelinesLines - Hold all the lines that make up the grid
+     * @brief mGuideline - Draws the grid, 0 when the guidelines are turned off
      */
-    QList<QGraphicsItem*> mGuidelinesLines;
+    Guideline *mGuideline;
 
     /**
      * @brief mGuidelines - Hold the settings that are used to generate a grid background
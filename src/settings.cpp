@@ -120,6 +120,25 @@ void Settings::setupValueList() {
     mValueList["chartRowIndicator"] = QVariant(tr("Dots and Text"));
     mValueList["chartIndicatorColor"] = QVariant("#c00000");
     mValueList["showIndicatorOutline"] = QVariant(false);
+
+    //memory used by the rendered stitch symbols, in MB.
+    mValueList["spriteCacheSize"] = QVariant(64);
+
+    //keep stitches that are not being edited as plain values instead of graphics items.
+    mValueList["compactCellStorage"] = QVariant(true);
+
+    //memory each chart's undo history can use before the oldest steps are dropped, in MB. 0 = no limit.
+    mValueList["undoMemoryLimit"] = QVariant(128);
+
+    //seconds between writes to the autosave journal. 0 = no autosave.
+    mValueList["autosaveInterval"] = QVariant(5);
+    //minutes between full copies of the document in the autosave folder.
+    mValueList["autosaveCheckpointInterval"] = QVariant(10);
+
+    //printed width of a stitch in mm, larger charts are split across pages. 0 = one page per chart.
+    mValueList["printStitchSize"] = QVariant(0.0);
+    //how much of the chart neighbouring pages share, in mm.
+    mValueList["printPageOverlap"] = QVariant(10.0);
 	
 	//tools options
 	mValueList["replaceStitchWithPress"] = QVariant(true);
@@ -110,6 +110,8 @@ void SettingsUi::load(QObject *w)
         qobject_cast<QCheckBox*>(w)->setChecked(value.toBool());
     } else if (w->inherits("QSpinBox")) {
         qobject_cast<QSpinBox*>(w)->setValue(value.toInt());
+    } else if (w->inherits("QDoubleSpinBox")) {
+        qobject_cast<QDoubleSpinBox*>(w)->setValue(value.toDouble());
     } else if (w->inherits("QComboBox")) {
         QComboBox *cb = qobject_cast<QComboBox*>(w);
         int index = cb->findText(value.toString());
@@ -130,6 +132,8 @@ void SettingsUi::loadDefualt(QObject *w)
         qobject_cast<QCheckBox*>(w)->setChecked(value.toBool());
     } else if (w->inherits("QSpinBox")) {
         qobject_cast<QSpinBox*>(w)->setValue(value.toInt());
+    } else if (w->inherits("QDoubleSpinBox")) {
+        qobject_cast<QDoubleSpinBox*>(w)->setValue(value.toDouble());
     } else if (w->inherits("QComboBox")) {
         QComboBox *cb = qobject_cast<QComboBox*>(w);
         int index = cb->findText(value.toString());
@@ -148,6 +152,8 @@ void SettingsUi::save(QObject *w)
         value = QVariant(qobject_cast<QCheckBox*>(w)->isChecked());
     } else if (w->inherits("QSpinBox")) {
         value = QVariant(qobject_cast<QSpinBox*>(w)->value());
+    } else if (w->inherits("QDoubleSpinBox")) {
+        value = QVariant(qobject_cast<QDoubleSpinBox*>(w)->value());
     } else if (w->inherits("QComboBox")) {
         value = QVariant(qobject_cast<QComboBox*>(w)->currentText());
     } else {
@@ -166,6 +172,8 @@ bool SettingsUi::isSettingsWidget(QObject *obj)
         return true;
     if(obj->inherits("QSpinBox"))
         return true;
+    if(obj->inherits("QDoubleSpinBox"))
+        return true;
     if(obj->inherits("QComboBox"))
         return true;
 
@@ -28,6 +28,8 @@
 #include <QFile>
 
 #include "settings.h"
+#include "stitchspritecache.h"
+#include "iconstore.h"
 
 Stitch::Stitch(QObject *parent) :
     QObject(parent),
@@ -39,6 +41,8 @@ Stitch::Stitch(QObject *parent) :
 
 Stitch::~Stitch()
 {
+    StitchSpriteCache::inst()->removeStitch(this);
+
     foreach(QString key, mRenderers.keys())
         mRenderers.value(key)->deleteLater();
 
@@ -54,50 +58,80 @@ void Stitch::setFile ( QString f )
         delete mPixmap;
         mPixmap = 0;
 
+        StitchSpriteCache::inst()->removeStitch(this);
+        mSvgData.clear();
+        mColorOffsets.clear();
         setupSvgFiles();
 
         if(!isSvg()) {
-            mPixmap = new QPixmap(mFile);
+            mPixmap = new QPixmap(IconStore::inst()->pixmap(mFile));
         }
     }
 }
 
-bool Stitch::setupSvgFiles()
+bool Stitch::loadSvgTemplate()
 {
-    QFile file(mFile);
-    if(!file.open(QIODevice::ReadOnly)) {
+    //icons embedded in documents are read from memory.
+    mSvgData = IconStore::inst()->iconData(mFile);
+    if(mSvgData.isEmpty()) {
         WARN("cannot open file for svg setup");
         return false;
     }
 
-    QByteArray data = file.readAll();
-    QByteArray priData, secData;
+    mColorOffsets.clear();
 
-    QString black = "#000000";
+    //find all the places the default color is used so new colors can be spliced in.
+    QByteArray black = QByteArray("#000000");
+    int pos = mSvgData.indexOf(black);
+    while(pos != -1) {
+        mColorOffsets.append(pos);
+        pos = mSvgData.indexOf(black, pos + black.length());
+    }
 
-    QString pri = Settings::inst()->value("stitchPrimaryColor").toString();
-    QString sec = Settings::inst()->value("stitchAlternateColor").toString();
+    return true;
+}
 
-    priData = data;
-    secData = data;
+QByteArray Stitch::svgData(QString color) const
+{
+    QString black = "#000000";
 
     //Don't parse the color if we're using black
-    if(pri != black)
-        priData = priData.replace(QByteArray(black.toLatin1()), QByteArray(pri.toLatin1()));
+    if(color == black || mColorOffsets.isEmpty())
+        return mSvgData;
+
+    QByteArray clr = color.toLatin1();
+    QByteArray data;
+    data.reserve(mSvgData.size() + mColorOffsets.count() * (clr.length() - black.length()));
+
+    int last = 0;
+    foreach(int offset, mColorOffsets) {
+        data.append(mSvgData.constData() + last, offset - last);
+        data.append(clr);
+        last = offset + black.length();
+    }
+    data.append(mSvgData.constData() + last, mSvgData.size() - last);
+
+    return data;
+}
+
+bool Stitch::setupSvgFiles()
+{
+    if(mSvgData.isEmpty() && !loadSvgTemplate())
+        return false;
+
+    QString pri = Settings::inst()->value("stitchPrimaryColor").toString();
+    QString sec = Settings::inst()->value("stitchAlternateColor").toString();
 
     QSvgRenderer *svgR = new QSvgRenderer();
-    if(!svgR->load(priData)) {
+    if(!svgR->load(svgData(pri))) {
         mIsSvg = false;
         return false;
     }
 
     mRenderers.insert(pri, svgR);
 
-    if(sec != black)
-        secData = data.replace(QByteArray(black.toLatin1()), QByteArray(sec.toLatin1()));
-
     svgR = new QSvgRenderer();
-    if(!svgR->load(secData)) {
+    if(!svgR->load(svgData(sec))) {
         mIsSvg = false;
         return false;
     }
@@ -115,22 +149,12 @@ void Stitch::addStitchColor(QString color)
     if(mRenderers.contains(color))
         return;
 
-    QFile file(mFile);
-    if(!file.open(QIODevice::ReadOnly)) {
-        WARN("cannot open file for svg setup");
+    //the template is loaded with the file, new colors don't need to touch the disk.
+    if(mSvgData.isEmpty() && !loadSvgTemplate())
         return;
-    }
-
-    QByteArray data = file.readAll();
-
-    QString black = "#000000";
-
-    //Don't parse the color if we're using black
-    if(color != black)
-        data = data.replace(QByteArray(black.toLatin1()), QByteArray(color.toLatin1()));
 
     QSvgRenderer *svgR = new QSvgRenderer();
-    svgR->load(data);
+    svgR->load(svgData(color));
     mRenderers.insert(color, svgR);
 }
 
@@ -146,7 +170,8 @@ QPixmap* Stitch::renderPixmap()
     if(mPixmap && !mPixmap->isNull())
         return mPixmap;
 
-    mPixmap = new QPixmap(mFile);
+    delete mPixmap;
+    mPixmap = new QPixmap(IconStore::inst()->pixmap(mFile));
 
     return mPixmap;
 }
@@ -170,6 +195,7 @@ QSvgRenderer* Stitch::renderSvg(QColor color)
 
 void Stitch::reloadIcon()
 {
+    StitchSpriteCache::inst()->removeStitch(this);
     setupSvgFiles();
 }
 
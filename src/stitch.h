@@ -26,6 +26,7 @@
 #include <QObject>
 #include <QMap>
 #include <QColor>
+#include <QByteArray>
 
 class QSvgRenderer;
 class QPixmap;
@@ -35,6 +36,7 @@ class Stitch : public QObject
     friend class StitchSet;
     friend class StitchLibrary;
     friend class TestStitch;
+    friend class SvgWriter;
 public:
 
     enum StitchParts { Name = 0,
@@ -81,6 +83,15 @@ protected:
 private:
     bool setupSvgFiles();
 
+    /**
+     * Read mFile into memory and find where the default color (#000000) is used.
+     */
+    bool loadSvgTemplate();
+    /**
+     * Return the svg template with the default color replaced by @color.
+     */
+    QByteArray svgData(QString color) const;
+
     QString mName;
     QString mFile;
     QString mDescription;
@@ -90,6 +101,12 @@ private:
 
     QMap<QString, QSvgRenderer*> mRenderers;
 
+    /**
+     * The unmodified svg file and the offsets of each "#000000" in it.
+     */
+    QByteArray mSvgData;
+    QList<int> mColorOffsets;
+
     QPixmap* mPixmap;
 };
 
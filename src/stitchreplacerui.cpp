@@ -24,6 +24,7 @@
 #include "stitch.h"
 #include <QPushButton>
 #include "stitchlibrary.h"
+#include "iconstore.h"
 
 StitchReplacerUi::StitchReplacerUi(QString stitch, QList< QString > patternStitches, QWidget* parent) :
     QDialog(parent),
@@ -70,12 +71,12 @@ void StitchReplacerUi::populateStitchLists()
     foreach(QString stitch, mOriginalStitchList) {
         Stitch *s = StitchLibrary::inst()->findStitch(stitch);
 
-        ui->originalStitch->addItem(QIcon(s->file()), stitch);
+        ui->originalStitch->addItem(IconStore::inst()->icon(s->file()), stitch);
     }
 
     foreach(QString stitch, StitchLibrary::inst()->stitchList()) {
         Stitch *s = StitchLibrary::inst()->findStitch(stitch);
 
-        ui->replacementStitch->addItem(QIcon(s->file()), stitch);
+        ui->replacementStitch->addItem(IconStore::inst()->icon(s->file()), stitch);
     }
 }
@@ -29,6 +29,7 @@
 #include <QDataStream> //read/write the set file w/icon data.
 
 #include "settings.h"
+#include "iconstore.h"
 
 #include <QDebug>
 #include "debug.h"
@@ -195,7 +196,14 @@ void StitchSet::loadIcons(QDataStream* in)
     QMap<QString, QByteArray> icons;
     *in >> icons;
 
+    mIconPaths.clear();
     foreach(QString key, icons.keys()) {
+        //icons in documents don't need to be on disk.
+        if(isTemporary) {
+            mIconPaths.insert(key, IconStore::inst()->addIcon(icons.value(key), key));
+            continue;
+        }
+
         QFile f(stitchSetFolder() + key);
         f.open(QIODevice::WriteOnly);
         f.write(icons[key]);
@@ -241,7 +249,9 @@ void StitchSet::loadXmlStitch(QXmlStreamReader* stream, bool loadIcon)
                 s->setName(stream->readElementText());
             else if(name == "icon") {
                 QString filePath = stream->readElementText();
-                if(loadIcon && !filePath.startsWith(":/"))
+                if(loadIcon && mIconPaths.contains(filePath))
+                    s->setFile(mIconPaths.value(filePath));
+                else if(loadIcon && !filePath.startsWith(":/"))
                     s->setFile(stitchSetFolder() + filePath);
                 else
                     s->setFile(filePath);
@@ -336,10 +346,7 @@ void StitchSet::saveIcons(QDataStream *out)
 
         if(!s->file().startsWith(":/")) {
             qDebug() << "doesn't start with :/";
-            QFile f(s->file());
-            f.open(QIODevice::ReadOnly);
-            icons.insert(QFileInfo(s->file()).fileName(), f.readAll());
-            f.close();
+            icons.insert(QFileInfo(s->file()).fileName(), IconStore::inst()->iconData(s->file()));
         }
     }
     *out << icons;
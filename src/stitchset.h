@@ -42,6 +42,7 @@ class StitchSet : public QAbstractItemModel
     friend class FileFactory;
     friend class File_v1;
     friend class File_v2;
+    friend class File_v3;
 public:
 
     enum SaveVersion { Version_1_0_0 = 100 };
@@ -141,6 +142,9 @@ protected:
     void saveXmlStitchSet(QXmlStreamWriter* stream, bool saveIcons = false);
 
     void saveIcons(QDataStream* out);
+    /**
+     * Temporary sets keep their icons in the IconStore, other sets write them to stitchSetFolder().
+     */
     void loadIcons(QDataStream* in);
    
 private:
@@ -154,6 +158,9 @@ private:
     bool removeDir(const QString &dirName);
 
     QList<Stitch*> mStitches;
+
+    //the IconStore paths of the icons loaded by loadIcons(), by file name.
+    QMap<QString, QString> mIconPaths;
     
     /**
      * list of checked items
@@ -0,0 +1,171 @@
+/****************************************************************************\
+ Copyright (c) 2010-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "stitchspritecache.h"
+
+#include <QPainter>
+#include <QPaintEngine>
+#include <QStyleOptionGraphicsItem>
+#include <QtSvg/QSvgRenderer>
+
+#include <math.h>
+
+#include "stitch.h"
+#include "settings.h"
+
+//zoom levels are split into 4 buckets per doubling of size.
+#define SPRITE_BUCKETS_PER_OCTAVE 4
+//don't create sprites smaller than 1/16th or larger than 16x the symbol size.
+#define SPRITE_MAX_BUCKET (4 * SPRITE_BUCKETS_PER_OCTAVE)
+
+// Global static pointer
+StitchSpriteCache* StitchSpriteCache::mInstance = NULL;
+
+// singleton constructor:
+StitchSpriteCache* StitchSpriteCache::inst()
+{
+   if (!mInstance)   // Only allow one instance of the sprite cache.
+      mInstance = new StitchSpriteCache();
+   return mInstance;
+}
+
+StitchSpriteCache::StitchSpriteCache()
+    : mHits(0),
+      mMisses(0)
+{
+    setMaxCost(Settings::inst()->value("spriteCacheSize").toInt() * 1024 * 1024);
+}
+
+StitchSpriteCache::~StitchSpriteCache()
+{
+    mSprites.clear();
+}
+
+void StitchSpriteCache::setMaxCost(int bytes)
+{
+    mSprites.setMaxCost(bytes);
+}
+
+void StitchSpriteCache::resetCounters()
+{
+    mHits = 0;
+    mMisses = 0;
+}
+
+void StitchSpriteCache::clear()
+{
+    mSprites.clear();
+}
+
+void StitchSpriteCache::removeStitch(Stitch *s)
+{
+    foreach(SpriteKey key, mSprites.keys()) {
+        if(key.stitch == s)
+            mSprites.remove(key);
+    }
+}
+
+bool StitchSpriteCache::isVectorDevice(QPainter *painter)
+{
+    if(!painter || !painter->paintEngine())
+        return true;
+
+    switch(painter->paintEngine()->type()) {
+        case QPaintEngine::PostScript:
+        case QPaintEngine::Pdf:
+        case QPaintEngine::SVG:
+        case QPaintEngine::Picture:
+        case QPaintEngine::MacPrinter:
+        case QPaintEngine::Windows:
+            return true;
+        default:
+            break;
+    }
+
+    return (painter->device() && painter->device()->devType() == QInternal::Printer);
+}
+
+int StitchSpriteCache::zoomBucket(qreal levelOfDetail)
+{
+    if(levelOfDetail <= 0)
+        return 0;
+
+    //round up so sprites are never stretched more than one bucket.
+    int bucket = (int)ceil(log(levelOfDetail) / log(2.0) * SPRITE_BUCKETS_PER_OCTAVE - 0.001);
+
+    return qBound(-SPRITE_MAX_BUCKET, bucket, SPRITE_MAX_BUCKET);
+}
+
+qreal StitchSpriteCache::bucketScale(int bucket)
+{
+    return pow(2.0, (qreal)bucket / SPRITE_BUCKETS_PER_OCTAVE);
+}
+
+QImage StitchSpriteCache::sprite(Stitch *s, QColor color, QPainter *painter, qreal *scale)
+{
+    if(!s || !s->isSvg())
+        return QImage();
+
+    qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    int bucket = zoomBucket(lod);
+
+    if(scale)
+        *scale = bucketScale(bucket);
+
+    SpriteKey key(s, color.rgba(), bucket);
+
+    QImage *img = mSprites.object(key);
+    if(img) {
+        mHits++;
+        return *img;
+    }
+
+    mMisses++;
+    img = render(s, color, bucketScale(bucket));
+    if(!img)
+        return QImage();
+
+    QImage sprite = *img;
+    //if the sprite is larger than the whole cache it is deleted right away.
+    mSprites.insert(key, img, img->byteCount());
+
+    return sprite;
+}
+
+QImage* StitchSpriteCache::render(Stitch *s, QColor color, qreal scale)
+{
+    QSvgRenderer *r = s->renderSvg(color);
+    if(!r)
+        return 0;
+
+    QSize size = (QSizeF(r->defaultSize()) * scale).toSize();
+    if(size.isEmpty())
+        return 0;
+
+    QImage *img = new QImage(size, QImage::Format_ARGB32_Premultiplied);
+    img->fill(0);
+
+    QPainter p(img);
+    p.setRenderHint(QPainter::Antialiasing);
+    r->render(&p, QRectF(QPointF(0, 0), size));
+    p.end();
+
+    return img;
+}
@@ -0,0 +1,117 @@
+/****************************************************************************\
+ Copyright (c) 2010-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef STITCHSPRITECACHE_H
+#define STITCHSPRITECACHE_H
+
+#include <QCache>
+#include <QColor>
+#include <QImage>
+
+class Stitch;
+class QPainter;
+
+/**
+ * A sprite is a stitch symbol rendered to an image for one
+ * foreground color at one zoom level.
+ */
+struct SpriteKey
+{
+    SpriteKey(Stitch *s = 0, QRgb c = 0, int b = 0)
+        : stitch(s), color(c), bucket(b) {}
+
+    Stitch *stitch;
+    QRgb color;
+    int bucket;
+
+    bool operator==(const SpriteKey &other) const
+    {
+        return stitch == other.stitch && color == other.color && bucket == other.bucket;
+    }
+};
+
+inline uint qHash(const SpriteKey &key)
+{
+    return qHash(quintptr(key.stitch)) ^ (key.color * 31) ^ uint(key.bucket << 24);
+}
+
+/**
+ * The StitchSpriteCache holds pre-rasterized stitch symbols for all open charts.
+ *
+ * Sprites are created the first time they're requested and the least recently
+ * used sprites are dropped once the cache grows past the memory cap set in
+ * the "spriteCacheSize" option (in MB).
+ */
+class StitchSpriteCache
+{
+public:
+    static StitchSpriteCache* inst();
+    ~StitchSpriteCache();
+
+    /**
+     * Return the sprite for stitch @s in @color at the zoom level of @painter.
+     * Returns a null image if the stitch can't be rendered.
+     * @scale is set to the zoom level the sprite was rendered at.
+     */
+    QImage sprite(Stitch *s, QColor color, QPainter *painter, qreal *scale = 0);
+
+    /**
+     * Drop all sprites for stitch @s, for when the stitch is deleted or its icon changes.
+     */
+    void removeStitch(Stitch *s);
+    void clear();
+
+    /**
+     * Max memory the sprites can use, in bytes.
+     */
+    int maxCost() const { return mSprites.maxCost(); }
+    void setMaxCost(int bytes);
+    int totalCost() const { return mSprites.totalCost(); }
+    int count() const { return mSprites.count(); }
+
+    quint64 hits() const { return mHits; }
+    quint64 misses() const { return mMisses; }
+    void resetCounters();
+
+    /**
+     * Vector devices (print, pdf, svg) should always be painted with the svg renderer.
+     */
+    static bool isVectorDevice(QPainter *painter);
+
+    /**
+     * Round the level of detail to a zoom bucket so small zoom changes reuse the same sprites.
+     */
+    static int zoomBucket(qreal levelOfDetail);
+    static qreal bucketScale(int bucket);
+
+private:
+    StitchSpriteCache();
+
+    QImage* render(Stitch *s, QColor color, qreal scale);
+
+    static StitchSpriteCache *mInstance;
+
+    QCache<SpriteKey, QImage> mSprites;
+
+    quint64 mHits;
+    quint64 mMisses;
+};
+
+#endif // STITCHSPRITECACHE_H
@@ -0,0 +1,312 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "svgwriter.h"
+
+#include <QFile>
+#include <QBuffer>
+#include <QPainter>
+#include <QGraphicsScene>
+#include <QGraphicsItem>
+#include <QStyleOptionGraphicsItem>
+#include <QXmlStreamWriter>
+#include <QXmlStreamReader>
+#include <QSvgGenerator>
+#include <QtSvg/QSvgRenderer>
+
+#include "cell.h"
+#include "cellstoreitem.h"
+#include "itemgroup.h"
+#include "stitch.h"
+#include "debug.h"
+
+#define SVG_NAMESPACE "http://www.w3.org/2000/svg"
+#define XLINK_NAMESPACE "http://www.w3.org/1999/xlink"
+
+SvgWriter::SvgWriter()
+    : mItemCount(0)
+{
+}
+
+SvgWriter::~SvgWriter()
+{
+}
+
+bool SvgWriter::write(const QString &fileName, QGraphicsScene *scene, QRectF rect, bool selectedOnly)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly)) {
+        WARN("Could not open file for writing: " + fileName);
+        return false;
+    }
+
+    bool ok = write(&file, scene, rect, selectedOnly);
+    file.close();
+    return ok;
+}
+
+bool SvgWriter::write(QIODevice *device, QGraphicsScene *scene, QRectF rect, bool selectedOnly)
+{
+    mSymbols.clear();
+    mItemCount = 0;
+
+    QList<QGraphicsItem*> items = exportItems(scene, selectedOnly);
+
+    QXmlStreamWriter stream(device);
+    stream.writeStartDocument();
+    stream.writeStartElement("svg");
+    stream.writeDefaultNamespace(SVG_NAMESPACE);
+    stream.writeNamespace(XLINK_NAMESPACE, "xlink");
+    stream.writeAttribute("version", "1.1");
+    stream.writeAttribute("width", QString::number(rect.width()));
+    stream.writeAttribute("height", QString::number(rect.height()));
+    stream.writeAttribute("viewBox", QString("%1 %2 %3 %4").arg(rect.x()).arg(rect.y())
+                                                            .arg(rect.width()).arg(rect.height()));
+
+    if(!mTitle.isEmpty())
+        stream.writeTextElement("title", mTitle);
+    if(!mDescription.isEmpty())
+        stream.writeTextElement("desc", mDescription);
+
+    //the symbols have to come before the cells that use them.
+    stream.writeStartElement("defs");
+    foreach(QGraphicsItem *item, items) {
+        foreach(const CellRecord &cell, cellRecords(item))
+            writeSymbol(&stream, cell);
+    }
+    stream.writeEndElement(); //defs
+
+    foreach(QGraphicsItem *item, items) {
+        if(item->type() == Cell::Type || item->type() == CellStoreItem::Type) {
+            foreach(const CellRecord &cell, cellRecords(item))
+                writeCell(&stream, cell);
+        } else if(item->type() != ItemGroup::Type) {
+            writeItem(&stream, item);
+        }
+    }
+
+    stream.writeEndElement(); //svg
+    stream.writeEndDocument();
+
+    return !stream.hasError();
+}
+
+QList<QGraphicsItem*> SvgWriter::exportItems(QGraphicsScene *scene, bool selectedOnly)
+{
+    QList<QGraphicsItem*> items;
+
+    //same order the scene paints them in.
+    foreach(QGraphicsItem *item, scene->items(Qt::AscendingOrder)) {
+        if(!item->isVisible())
+            continue;
+
+        if(selectedOnly) {
+            QGraphicsItem *i = item;
+            while(i && !i->isSelected())
+                i = i->parentItem();
+            if(!i)
+                continue;
+        }
+
+        items.append(item);
+    }
+
+    return items;
+}
+
+QList<CellRecord> SvgWriter::cellRecords(QGraphicsItem *item)
+{
+    QList<CellRecord> cells;
+
+    if(item->type() == Cell::Type) {
+        Cell *c = qgraphicsitem_cast<Cell*>(item);
+        if(c->stitch())
+            cells.append(CellStore::recordFromCell(c));
+
+    } else if(item->type() == CellStoreItem::Type) {
+        CellStoreItem *storeItem = static_cast<CellStoreItem*>(item);
+        CellStore *store = storeItem->store();
+        foreach(int i, store->cellsInLayer(storeItem->layer())) {
+            if(store->stitch(i))
+                cells.append(store->record(i));
+        }
+    }
+
+    return cells;
+}
+
+void SvgWriter::writeSymbol(QXmlStreamWriter *stream, const CellRecord &cell)
+{
+    Stitch *s = cell.stitch;
+    QPair<Stitch*, QRgb> key(s, s->isSvg() ? cell.color.rgba() : 0);
+    if(mSymbols.contains(key))
+        return;
+
+    QString id = "s" + QString::number(mSymbols.count());
+    mSymbols.insert(key, id);
+
+    stream->writeStartElement("symbol");
+    stream->writeAttribute("id", id);
+    stream->writeAttribute("preserveAspectRatio", "none");
+
+    if(s->isSvg()) {
+        //the cells stretch the svg's view box over its default size, same as QSvgRenderer::render().
+        QSvgRenderer *r = s->renderSvg(cell.color);
+        QRectF box = r ? r->viewBoxF() : CellStore::stitchRect(s);
+        stream->writeAttribute("viewBox", QString("%1 %2 %3 %4").arg(box.x()).arg(box.y())
+                                                                .arg(box.width()).arg(box.height()));
+        copyContent(stream, s->svgData(cell.color.name()), id + "-");
+
+    } else {
+        QByteArray png;
+        QBuffer buffer(&png);
+        buffer.open(QIODevice::WriteOnly);
+        s->renderPixmap()->save(&buffer, "PNG");
+
+        QRectF box = CellStore::stitchRect(s);
+        stream->writeAttribute("viewBox", QString("0 0 %1 %2").arg(box.width()).arg(box.height()));
+        stream->writeStartElement("image");
+        stream->writeAttribute("width", QString::number(box.width()));
+        stream->writeAttribute("height", QString::number(box.height()));
+        stream->writeAttribute(XLINK_NAMESPACE, "href", "data:image/png;base64," + png.toBase64());
+        stream->writeEndElement(); //image
+    }
+
+    stream->writeEndElement(); //symbol
+}
+
+void SvgWriter::writeCell(QXmlStreamWriter *stream, const CellRecord &cell)
+{
+    Stitch *s = cell.stitch;
+    QRectF rect = CellStore::stitchRect(s);
+    QString transform = transformValue(cell.transform * QTransform::fromTranslate(cell.pos.x(), cell.pos.y()));
+
+    if(cell.bgColor.isValid() && cell.bgColor != Qt::white) {
+        stream->writeStartElement("rect");
+        stream->writeAttribute("width", QString::number(rect.width()));
+        stream->writeAttribute("height", QString::number(rect.height()));
+        stream->writeAttribute("fill", cell.bgColor.name());
+        if(!transform.isEmpty())
+            stream->writeAttribute("transform", transform);
+        stream->writeEndElement(); //rect
+    }
+
+    QPair<Stitch*, QRgb> key(s, s->isSvg() ? cell.color.rgba() : 0);
+
+    stream->writeStartElement("use");
+    stream->writeAttribute(XLINK_NAMESPACE, "href", "#" + mSymbols.value(key));
+    stream->writeAttribute("width", QString::number(rect.width()));
+    stream->writeAttribute("height", QString::number(rect.height()));
+    if(!transform.isEmpty())
+        stream->writeAttribute("transform", transform);
+    stream->writeEndElement(); //use
+}
+
+void SvgWriter::writeItem(QXmlStreamWriter *stream, QGraphicsItem *item)
+{
+    QByteArray svg;
+    QBuffer buffer(&svg);
+    buffer.open(QIODevice::WriteOnly);
+
+    QSvgGenerator gen;
+    gen.setOutputDevice(&buffer);
+
+    QStyleOptionGraphicsItem option;
+    option.rect = item->boundingRect().toRect();
+    option.exposedRect = item->boundingRect();
+
+    QPainter p;
+    p.begin(&gen);
+    p.setTransform(item->sceneTransform());
+    item->paint(&p, &option, 0);
+    p.end();
+
+    copyContent(stream, svg, "i" + QString::number(mItemCount++) + "-");
+}
+
+void SvgWriter::copyContent(QXmlStreamWriter *stream, const QByteArray &svg, QString idPrefix)
+{
+    QXmlStreamReader in(svg);
+    int depth = 0;
+
+    while(!in.atEnd()) {
+        in.readNext();
+
+        if(in.isStartElement()) {
+            depth++;
+            if(depth == 1)
+                continue;
+
+            //drop editor data like sodipodi:namedview and anything that isn't drawn.
+            if(in.namespaceUri() != SVG_NAMESPACE || in.name() == "title" ||
+               in.name() == "desc" || in.name() == "metadata") {
+                in.skipCurrentElement();
+                depth--;
+                continue;
+            }
+
+            stream->writeStartElement(in.name().toString());
+            foreach(const QXmlStreamAttribute &attr, in.attributes()) {
+                QString ns = attr.namespaceUri().toString();
+                if(!ns.isEmpty() && ns != XLINK_NAMESPACE)
+                    continue;
+
+                QString name = attr.name().toString();
+                QString value = attr.value().toString();
+                if(name == "id")
+                    value = idPrefix + value;
+                else if(name == "href" && value.startsWith("#"))
+                    value.insert(1, idPrefix);
+                value.replace("url(#", "url(#" + idPrefix);
+
+                if(ns.isEmpty())
+                    stream->writeAttribute(name, value);
+                else
+                    stream->writeAttribute(ns, name, value);
+            }
+
+        } else if(in.isEndElement()) {
+            depth--;
+            if(depth > 0)
+                stream->writeEndElement();
+
+        } else if(in.isCDATA()) {
+            stream->writeCDATA(in.text().toString());
+
+        } else if(in.isCharacters() && !in.isWhitespace() && depth > 1) {
+            stream->writeCharacters(in.text().toString());
+        }
+    }
+
+    if(in.hasError())
+        WARN("Could not copy svg content: " + in.errorString());
+}
+
+QString SvgWriter::transformValue(const QTransform &t)
+{
+    if(t.isIdentity())
+        return QString();
+
+    if(t.type() == QTransform::TxTranslate)
+        return QString("translate(%1 %2)").arg(t.dx()).arg(t.dy());
+
+    return QString("matrix(%1 %2 %3 %4 %5 %6)").arg(t.m11()).arg(t.m12()).arg(t.m21())
+                                              .arg(t.m22()).arg(t.dx()).arg(t.dy());
+}
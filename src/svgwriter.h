@@ -0,0 +1,94 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef SVGWRITER_H
+#define SVGWRITER_H
+
+#include <QString>
+#include <QMap>
+#include <QPair>
+#include <QRgb>
+#include <QRectF>
+#include <QList>
+
+#include "cellstore.h"
+
+class QGraphicsItem;
+class QGraphicsScene;
+class QXmlStreamWriter;
+class QIODevice;
+
+/**
+ * Writes a chart as an svg file that draws each stitch symbol only once.
+ *
+ * Every stitch and color combination becomes a <symbol> made from the stitch's
+ * own svg, and each cell is a <use> of that symbol with the cell's transform.
+ * Everything else (indicators, images, guidelines, etc) is painted through
+ * QSvgGenerator and copied into the file as plain svg elements.
+ */
+class SvgWriter
+{
+public:
+    SvgWriter();
+    ~SvgWriter();
+
+    void setTitle(QString title) { mTitle = title; }
+    void setDescription(QString description) { mDescription = description; }
+
+    /**
+     * Write the visible items of @scene, @rect is the area of the scene in the view box.
+     * If @selectedOnly is true only the selected items and their children are written.
+     */
+    bool write(const QString &fileName, QGraphicsScene *scene, QRectF rect, bool selectedOnly = false);
+    bool write(QIODevice *device, QGraphicsScene *scene, QRectF rect, bool selectedOnly = false);
+
+    /**
+     * The number of symbols in the last file written.
+     */
+    int symbolCount() const { return mSymbols.count(); }
+
+private:
+    QList<QGraphicsItem*> exportItems(QGraphicsScene *scene, bool selectedOnly);
+    /**
+     * The stitches drawn by @item, empty if it isn't a Cell or CellStoreItem.
+     */
+    QList<CellRecord> cellRecords(QGraphicsItem *item);
+
+    void writeSymbol(QXmlStreamWriter *stream, const CellRecord &cell);
+    void writeCell(QXmlStreamWriter *stream, const CellRecord &cell);
+    void writeItem(QXmlStreamWriter *stream, QGraphicsItem *item);
+
+    /**
+     * Copy the children of the root element of @svg, ids are prefixed with @idPrefix
+     * so they don't clash with the other symbols and items in the file.
+     */
+    void copyContent(QXmlStreamWriter *stream, const QByteArray &svg, QString idPrefix);
+
+    static QString transformValue(const QTransform &t);
+
+    QString mTitle;
+    QString mDescription;
+
+    //the symbol id for each stitch and color.
+    QMap<QPair<Stitch*, QRgb>, QString> mSymbols;
+    int mItemCount;
+};
+
+#endif // SVGWRITER_H
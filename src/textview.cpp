@@ -48,11 +48,11 @@ QString TextView::generateTextRow(int row, bool cleanOutput, bool useRepeats)
     //create a list of stitches
     for(int c = 0; c < cols; ++c) {
 		qDebug() << "row iteration!";
-        Cell* cell = mScene->grid[row][c];
-        if(!cell)
+        Stitch* s = mScene->gridStitch(row, c);
+        if(!s)
             continue;
 
-        curStitch = cell->name();
+        curStitch = s->name();
         if(cleanOutput) {
             //TODO: any special preprocessing that needs to be done.
         }
@@ -0,0 +1,261 @@
+/****************************************************************************\
+ Copyright (c) 2010-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "undostack.h"
+
+#include <QSharedPointer>
+
+#include "settings.h"
+#include "crochetchartcommands.h"
+#include "debug.h"
+
+//drop commands until the history is down to this part of the limit so it isn't rebuilt on every push.
+#define UNDO_TRIM_RATIO 0.75
+
+/**
+ * Wraps a command pushed onto an UndoStack so the command can outlive the
+ * QUndoStack entry that owns it.
+ */
+class UndoEntry : public QUndoCommand
+{
+public:
+    UndoEntry(UndoStack *stack, QSharedPointer<QUndoCommand> cmd, qint64 size, QUndoCommand *parent = 0)
+        : QUndoCommand(cmd->text(), parent),
+          mStack(stack),
+          mCmd(cmd),
+          mSize(size)
+    {
+    }
+
+    void redo()
+    {
+        if(mStack->mReplaying)
+            return;
+        mCmd->redo();
+        emit mStack->commandDone(mCmd.data());
+    }
+
+    void undo()
+    {
+        if(mStack->mReplaying)
+            return;
+        mCmd->undo();
+        emit mStack->commandDone(mCmd.data());
+    }
+
+    int id() const
+    {
+        //don't merge entries while the stack is rebuilt.
+        return mStack->mReplaying ? -1 : mCmd->id();
+    }
+
+    bool mergeWith(const QUndoCommand *other)
+    {
+        const UndoEntry *entry = dynamic_cast<const UndoEntry*>(other);
+        if(!entry || !mCmd->mergeWith(entry->mCmd.data()))
+            return false;
+        setText(mCmd->text());
+
+        //@other is deleted by the stack, its size was counted when it was pushed.
+        qint64 size = UndoStack::commandSize(mCmd.data());
+        mStack->mMemoryUsage += size - mSize - entry->size();
+        mSize = size;
+        return true;
+    }
+
+    QSharedPointer<QUndoCommand> command() const { return mCmd; }
+    qint64 size() const { return mSize; }
+
+private:
+    UndoStack *mStack;
+    QSharedPointer<QUndoCommand> mCmd;
+    qint64 mSize;
+};
+
+UndoStack::UndoStack(QObject *parent)
+    : QUndoStack(parent),
+      mMacroDepth(0),
+      mReplaying(false),
+      mMemoryUsage(0)
+{
+}
+
+UndoStack::~UndoStack()
+{
+}
+
+void UndoStack::push(QUndoCommand *cmd)
+{
+    if(!cmd)
+        return;
+
+    if(mMacroDepth == 0)
+        discardRedoCommands();
+
+    qint64 size = commandSize(cmd);
+    mMemoryUsage += size;
+    QUndoStack::push(new UndoEntry(this, QSharedPointer<QUndoCommand>(cmd), size));
+
+    if(mMacroDepth == 0)
+        checkMemoryLimit();
+}
+
+void UndoStack::beginMacro(const QString &text)
+{
+    if(mMacroDepth == 0)
+        discardRedoCommands();
+
+    mMacroDepth++;
+    QUndoStack::beginMacro(text);
+}
+
+void UndoStack::endMacro()
+{
+    QUndoStack::endMacro();
+    mMacroDepth--;
+
+    if(mMacroDepth == 0) {
+        //the entries were counted when they were pushed, add the macro commands around them.
+        if(index() > 0)
+            mMemoryUsage += macroSize(command(index() - 1));
+        checkMemoryLimit();
+    }
+}
+
+void UndoStack::discardRedoCommands()
+{
+    //QUndoStack deletes the commands that can be redone when a new command is added.
+    for(int i = index(); i < count(); ++i)
+        mMemoryUsage -= commandSize(command(i));
+}
+
+qint64 UndoStack::memoryLimit() const
+{
+    return (qint64)Settings::inst()->value("undoMemoryLimit").toInt() * 1024 * 1024;
+}
+
+void UndoStack::checkMemoryLimit()
+{
+    qint64 limit = memoryLimit();
+    if(limit > 0 && mMemoryUsage > limit)
+        trimTo(limit * UNDO_TRIM_RATIO);
+
+    emit memoryUsageChanged(mMemoryUsage);
+}
+
+qint64 UndoStack::commandSize(const QUndoCommand *cmd)
+{
+    const UndoEntry *entry = dynamic_cast<const UndoEntry*>(cmd);
+    if(entry)
+        return entry->size();
+
+    qint64 size = undoCommandSize(cmd);
+    for(int i = 0; i < cmd->childCount(); ++i)
+        size += commandSize(cmd->child(i));
+    return size;
+}
+
+qint64 UndoStack::macroSize(const QUndoCommand *cmd)
+{
+    if(dynamic_cast<const UndoEntry*>(cmd))
+        return 0;
+
+    qint64 size = undoCommandSize(cmd);
+    for(int i = 0; i < cmd->childCount(); ++i)
+        size += macroSize(cmd->child(i));
+    return size;
+}
+
+QUndoCommand* UndoStack::cloneEntry(const QUndoCommand *cmd, QUndoCommand *parent)
+{
+    const UndoEntry *entry = dynamic_cast<const UndoEntry*>(cmd);
+    if(entry)
+        return new UndoEntry(this, entry->command(), entry->size(), parent);
+
+    //a macro, its children are all entries.
+    if(cmd->childCount() == 0)
+        return 0;
+
+    QUndoCommand *macro = new QUndoCommand(cmd->text(), parent);
+    for(int i = 0; i < cmd->childCount(); ++i) {
+        if(!cloneEntry(cmd->child(i), macro)) {
+            delete macro;
+            return 0;
+        }
+    }
+    return macro;
+}
+
+void UndoStack::trimTo(qint64 bytes)
+{
+    if(mMacroDepth > 0)
+        return;
+
+    int total = count();
+    int current = index();
+    int clean = cleanIndex();
+
+    qint64 usage = mMemoryUsage;
+    int drop = 0;
+    //always keep the last command that was done.
+    while(drop < current - 1 && usage > bytes) {
+        usage -= commandSize(command(drop));
+        drop++;
+    }
+
+    if(drop == 0)
+        return;
+
+    QList<QUndoCommand*> kept;
+    for(int i = drop; i < total; ++i) {
+        QUndoCommand *c = cloneEntry(command(i));
+        if(!c) {
+            WARN("undo history contains a command that can't be moved, not trimming it.");
+            qDeleteAll(kept);
+            return;
+        }
+        kept.append(c);
+    }
+
+    DEBUG(QString("dropping %1 undo commands").arg(drop));
+
+    mReplaying = true;
+    clear();
+
+    //clear() makes the empty stack clean, if the saved state was dropped
+    //push a placeholder and replace it so the clean state becomes unreachable.
+    if(clean < drop) {
+        QUndoStack::push(new QUndoCommand());
+        setClean();
+        setIndex(0);
+    }
+
+    foreach(QUndoCommand *c, kept)
+        QUndoStack::push(c);
+
+    if(clean >= drop) {
+        setIndex(clean - drop);
+        setClean();
+    }
+    setIndex(current - drop);
+    mReplaying = false;
+
+    mMemoryUsage = usage;
+}
@@ -0,0 +1,98 @@
+/****************************************************************************\
+ Copyright (c) 2010-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef UNDOSTACK_H
+#define UNDOSTACK_H
+
+#include <QUndoStack>
+
+/**
+ * An undo stack with a memory limit.
+ *
+ * Every command pushed onto the stack is wrapped in an entry that knows
+ * roughly how much memory the command holds. When the history grows past
+ * the "undoMemoryLimit" option (in MB) the oldest commands are dropped.
+ *
+ * QUndoStack can't remove single commands, so the stack is rebuilt from the
+ * entries that are kept without running their undo() or redo().
+ *
+ * Only push(), beginMacro() and endMacro() called on an UndoStack are tracked.
+ */
+class UndoStack : public QUndoStack
+{
+    Q_OBJECT
+    friend class UndoEntry;
+public:
+    UndoStack(QObject *parent = 0);
+    ~UndoStack();
+
+    void push(QUndoCommand *cmd);
+    void beginMacro(const QString &text);
+    void endMacro();
+
+    /**
+     * Estimated memory used by all the commands on the stack, in bytes.
+     * The total is kept up to date as commands are pushed, merged and dropped.
+     */
+    qint64 memoryUsage() const { return mMemoryUsage; }
+    /**
+     * The memory limit in bytes, 0 means no limit.
+     */
+    qint64 memoryLimit() const;
+
+    /**
+     * Drop the oldest commands until the stack fits in @bytes.
+     * Commands that can still be redone are never dropped.
+     */
+    void trimTo(qint64 bytes);
+
+signals:
+    void memoryUsageChanged(qint64 bytes);
+    /**
+     * Emitted after a command pushed onto this stack was done, undone or redone.
+     */
+    void commandDone(const QUndoCommand *cmd);
+
+private slots:
+    void checkMemoryLimit();
+
+private:
+    static qint64 commandSize(const QUndoCommand *cmd);
+    /**
+     * The size of the macro commands in @cmd, without the entries inside them.
+     */
+    static qint64 macroSize(const QUndoCommand *cmd);
+    /**
+     * Remove the size of the commands that are deleted when a new command is added.
+     */
+    void discardRedoCommands();
+    /**
+     * Create a new command that shares the wrapped commands of @cmd.
+     * Returns 0 if @cmd wasn't pushed through this stack.
+     */
+    QUndoCommand* cloneEntry(const QUndoCommand *cmd, QUndoCommand *parent = 0);
+
+    int mMacroDepth;
+    //while the stack is rebuilt the entries don't run their commands.
+    bool mReplaying;
+    qint64 mMemoryUsage;
+};
+
+#endif // UNDOSTACK_H
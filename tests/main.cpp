@@ -24,6 +24,10 @@
 #include "testcell.h"
 #include "testtextview.h"
 #include "teststitchlibrary.h"
+#include "testscene.h"
+#include "testchartparser.h"
+#include "testbandwriter.h"
+#include "testundostack.h"
 
 int main(int argc, char** argv) 
 {
@@ -64,6 +68,26 @@ int main(int argc, char** argv)
     retval +=QTest::qExec(test, argc, argv);
     delete test;
     test = 0;
+
+    test = new TestScene();
+    retval +=QTest::qExec(test, argc, argv);
+    delete test;
+    test = 0;
+
+    test = new TestChartParser();
+    retval +=QTest::qExec(test, argc, argv);
+    delete test;
+    test = 0;
+
+    test = new TestBandWriter();
+    retval +=QTest::qExec(test, argc, argv);
+    delete test;
+    test = 0;
+
+    test = new TestUndoStack();
+    retval +=QTest::qExec(test, argc, argv);
+    delete test;
+    test = 0;
     
     return (retval ? 1 : 0);
 }
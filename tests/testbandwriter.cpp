@@ -0,0 +1,133 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "testbandwriter.h"
+
+#include <QPainter>
+#include <QPicture>
+#include <QGraphicsScene>
+#include <QGraphicsTextItem>
+#include <QtConcurrentMap>
+#include <QFontDatabase>
+
+QImage TestBandWriter::testImage(QSize size)
+{
+    QImage img(size, QImage::Format_ARGB32);
+    img.fill(QColor(Qt::white).rgba());
+
+    //large flat areas like a chart, and some noise.
+    QPainter p(&img);
+    p.fillRect(QRect(10, 10, size.width() / 2, size.height() / 3), QColor("#3a7bd5"));
+    p.setPen(QPen(Qt::black, 3));
+    p.drawEllipse(QRect(20, 30, size.width() - 40, size.height() - 60));
+    p.end();
+
+    for(int i = 0; i < 500; ++i) {
+        int x = (i * 7919) % size.width();
+        int y = (i * 104729) % size.height();
+        img.setPixel(x, y, qRgb(i % 256, (i * 3) % 256, (i * 5) % 256));
+    }
+
+    return img;
+}
+
+void TestBandWriter::writeBands()
+{
+    QFETCH(QString, format);
+    QFETCH(int, rows);
+
+    QImage img = testImage(QSize(301, 203));
+    QString fileName = "bandwriter-" + QString::number(rows) + "." + format;
+
+    BandWriter *writer = BandWriter::create(format);
+    QVERIFY(writer);
+    QVERIFY(writer->begin(fileName, img.size(), 11811));
+    for(int y = 0; y < img.height(); y += rows)
+        QVERIFY(writer->writeBand(img.copy(0, y, img.width(), qMin(rows, img.height() - y))));
+    QVERIFY(writer->finish());
+    delete writer;
+
+    QImage loaded(fileName);
+    QCOMPARE(loaded.size(), img.size());
+    QCOMPARE(loaded.convertToFormat(QImage::Format_RGB32), img.convertToFormat(QImage::Format_RGB32));
+    QCOMPARE(loaded.dotsPerMeterX(), 11811);
+}
+
+void TestBandWriter::writeBands_data()
+{
+    QTest::addColumn<QString>("format");
+    QTest::addColumn<int>("rows");
+
+    QTest::newRow("png, one band") << "png" << 203;
+    QTest::newRow("png, bands") << "png" << 17;
+    QTest::newRow("tiff, one band") << "tiff" << 203;
+    QTest::newRow("tiff, bands") << "tiff" << 17;
+}
+
+void TestBandWriter::renderBands()
+{
+    QGraphicsScene scene;
+    scene.addRect(QRectF(5, 5, 120, 60), QPen(Qt::black, 2), QBrush(QColor("#3a7bd5")));
+    scene.addEllipse(QRectF(40, 30, 150, 90), QPen(Qt::red, 3));
+    QGraphicsTextItem *text = scene.addText("Row 1");
+    text->setPos(20, 100);
+    text->setRotation(30);
+
+    QSize size(301, 203);
+    QRectF target(QPointF(0, 0), size);
+
+    QImage direct(size, QImage::Format_ARGB32);
+    direct.setDotsPerMeterX(11811);
+    direct.setDotsPerMeterY(11811);
+    QPainter p;
+    p.begin(&direct);
+    p.fillRect(target, QColor(Qt::white));
+    scene.render(&p, target, scene.itemsBoundingRect());
+    p.end();
+
+    QPicture picture;
+    p.begin(&picture);
+    scene.render(&p, target, scene.itemsBoundingRect());
+    p.end();
+
+    ExportBand page;
+    page.picture = QByteArray(picture.data(), picture.size());
+    page.size = size;
+    page.dotsPerMeter = 11811;
+
+    QList<ExportBand> bands;
+    for(int y = 0; y < size.height(); y += 17) {
+        ExportBand band = page;
+        band.top = y;
+        band.rows = qMin(17, size.height() - y);
+        bands.append(band);
+    }
+
+    QList<QImage> images;
+    if(QFontDatabase::supportsThreadedFontRendering()) {
+        images = QtConcurrent::blockingMapped<QList<QImage> >(bands, &ExportUi::renderBand);
+    } else {
+        foreach(const ExportBand &band, bands)
+            images.append(ExportUi::renderBand(band));
+    }
+    QCOMPARE(images.count(), bands.count());
+    for(int i = 0; i < images.count(); ++i)
+        QCOMPARE(images.at(i), direct.copy(0, bands.at(i).top, size.width(), bands.at(i).rows));
+}
@@ -0,0 +1,425 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "testchartparser.h"
+
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QHash>
+
+void TestChartParser::toDouble()
+{
+    QFETCH(QString, text);
+
+    bool expectedOk = false;
+    double expected = text.toDouble(&expectedOk);
+
+    bool ok = false;
+    double value = ChartParser::toDouble(QStringRef(&text), &ok);
+
+    QCOMPARE(ok, expectedOk);
+    QCOMPARE(value, expected);
+}
+
+void TestChartParser::toDouble_data()
+{
+    QTest::addColumn<QString>("text");
+
+    QTest::newRow("zero")       << "0";
+    QTest::newRow("integer")    << "42";
+    QTest::newRow("negative")   << "-17.25";
+    QTest::newRow("fraction")   << "0.000123";
+    QTest::newRow("g format")   << "1.23457e-05";
+    QTest::newRow("exponent")   << "1e+06";
+    QTest::newRow("long")       << "3.14159265358979323846";
+    QTest::newRow("huge")       << "1.5e+300";
+    QTest::newRow("empty")      << "";
+    QTest::newRow("text")       << "abc";
+    QTest::newRow("trailing")   << "1.5x";
+}
+
+QByteArray TestChartParser::generatePattern(int cells)
+{
+    QByteArray data;
+    QXmlStreamWriter stream(&data);
+    stream.setAutoFormatting(true);
+    stream.writeStartDocument();
+
+    stream.writeStartElement("pattern");
+    stream.writeEmptyElement("stitch_set");
+
+    stream.writeStartElement("colors");
+    stream.writeStartElement("color");
+    stream.writeAttribute("added", "0");
+    stream.writeCharacters("#000000");
+    stream.writeEndElement();
+    stream.writeEndElement();
+
+    stream.writeStartElement("chart");
+    stream.writeTextElement("name", "Chart");
+    stream.writeTextElement("style", "102");
+    stream.writeTextElement("defaultSt", "ch");
+
+    stream.writeStartElement("chartLayer");
+    stream.writeAttribute("name", "Layer 1");
+    stream.writeAttribute("uid", "1");
+    stream.writeAttribute("visible", "1");
+    stream.writeEndElement();
+
+    const char *stitches[] = { "ch", "sc", "dc", "hdc", "tr" };
+    const char *colors[] = { "#000000", "#ff0000", "#00ff00", "#0000ff" };
+
+    //the same tags File_v2::saveCharts() writes for each cell.
+    for(int i = 0; i < cells; ++i) {
+        stream.writeStartElement("cell");
+        stream.writeTextElement("stitch", stitches[i % 5]);
+        stream.writeTextElement("layer", "1");
+
+        stream.writeStartElement("position");
+        stream.writeAttribute("x", QString::number((i % 500) * 32.5));
+        stream.writeAttribute("y", QString::number((i / 500) * -96.25));
+        stream.writeEndElement();
+
+        stream.writeStartElement("newscale");
+        stream.writeAttribute("scaleX", "1");
+        stream.writeAttribute("scaleY", "1");
+        stream.writeAttribute("pivotX", "16");
+        stream.writeAttribute("pivotY", "48");
+        stream.writeEndElement();
+
+        stream.writeStartElement("rotation");
+        stream.writeAttribute("rotation", QString::number(i * 0.36));
+        stream.writeAttribute("pivotX", "16");
+        stream.writeAttribute("pivotY", "48");
+        stream.writeEndElement();
+
+        stream.writeTextElement("color", colors[i % 4]);
+        stream.writeTextElement("bgColor", "#ffffff");
+
+        stream.writeStartElement("pivotPoint");
+        stream.writeAttribute("x", "16");
+        stream.writeAttribute("y", "48");
+        stream.writeEndElement();
+
+        stream.writeEndElement(); //cell
+    }
+
+    stream.writeEndElement(); //chart
+    stream.writeEndElement(); //pattern
+    stream.writeEndDocument();
+
+    return data;
+}
+
+void TestChartParser::parseCells()
+{
+    QByteArray data = generatePattern(1000);
+
+    ChartParser parser;
+    QList<ChartData> charts;
+    QVERIFY(parser.parse(data, &charts));
+
+    QCOMPARE(charts.count(), 1);
+    const ChartData &chart = charts.first();
+    QCOMPARE(chart.name, QString("Chart"));
+    QCOMPARE(chart.style, 102);
+    QCOMPARE(chart.layers.count(), 1);
+    QCOMPARE(chart.layers.first().uid, (unsigned int)1);
+    QCOMPARE(chart.cells.count(), 1000);
+
+    const CellData &cell = chart.cells.at(501);
+    QCOMPARE(cell.stitch, QString("sc"));
+    QCOMPARE(cell.color, QString("#ff0000"));
+    QCOMPARE(cell.bgColor, QString("#ffffff"));
+    QCOMPARE(cell.layer, (unsigned int)1);
+    QCOMPARE(cell.position, QPointF(32.5, -96.25));
+    QCOMPARE(cell.rotation, QString::number(501 * 0.36).toDouble());
+    QCOMPARE(cell.pivotScale, QPointF(16, 48));
+    QCOMPARE(cell.pivotPoint, QPointF(16, 48));
+    QCOMPARE(cell.row, -1);
+    QCOMPARE(cell.group, -1);
+
+    //repeated values share one string.
+    QVERIFY(chart.cells.at(1).stitch.constData() == chart.cells.at(6).stitch.constData());
+}
+
+void TestChartParser::parseCharts()
+{
+    QFETCH(int, cells);
+
+    QByteArray data = generatePattern(cells);
+    QList<ChartData> charts;
+
+    QBENCHMARK {
+        ChartParser parser;
+        charts.clear();
+        parser.parse(data, &charts);
+    }
+
+    QCOMPARE(charts.first().cells.count(), cells);
+}
+
+void TestChartParser::parseCharts_data()
+{
+    QTest::addColumn<int>("cells");
+
+    QTest::newRow("10k")    << 10000;
+    QTest::newRow("100k")   << 100000;
+}
+
+void TestChartParser::parseChartsWithStrings()
+{
+    QFETCH(int, cells);
+
+    QByteArray data = generatePattern(cells);
+    QList<CellData> parsed;
+
+    QBENCHMARK {
+        parsed.clear();
+        QXmlStreamReader stream(data);
+
+        while(!stream.atEnd() && !stream.hasError()) {
+            stream.readNext();
+            if(!stream.isStartElement() || stream.name().toString() != "cell")
+                continue;
+
+            CellData cell;
+            while(!(stream.isEndElement() && stream.name() == "cell")) {
+                stream.readNext();
+                QString tag = stream.name().toString();
+
+                if(tag == "stitch") {
+                    cell.stitch = stream.readElementText();
+                } else if(tag == "layer") {
+                    cell.layer = stream.readElementText().toUInt();
+                } else if(tag == "color") {
+                    cell.color = stream.readElementText();
+                } else if(tag == "bgColor") {
+                    cell.bgColor = stream.readElementText();
+                } else if(tag == "position") {
+                    cell.position.rx() = stream.attributes().value("x").toString().toDouble();
+                    cell.position.ry() = stream.attributes().value("y").toString().toDouble();
+                    stream.readElementText();
+                } else if(tag == "newscale") {
+                    cell.scaleX = stream.attributes().value("scaleX").toString().toDouble();
+                    cell.scaleY = stream.attributes().value("scaleY").toString().toDouble();
+                    cell.pivotScale.rx() = stream.attributes().value("pivotX").toString().toDouble();
+                    cell.pivotScale.ry() = stream.attributes().value("pivotY").toString().toDouble();
+                    stream.readElementText();
+                } else if(tag == "rotation") {
+                    cell.rotation = stream.attributes().value("rotation").toString().toDouble();
+                    cell.pivotRotation.rx() = stream.attributes().value("pivotX").toString().toDouble();
+                    cell.pivotRotation.ry() = stream.attributes().value("pivotY").toString().toDouble();
+                    stream.readElementText();
+                } else if(tag == "pivotPoint") {
+                    cell.pivotPoint.rx() = stream.attributes().value("x").toString().toDouble();
+                    cell.pivotPoint.ry() = stream.attributes().value("y").toString().toDouble();
+                    stream.readElementText();
+                }
+            }
+            parsed.append(cell);
+        }
+    }
+
+    QCOMPARE(parsed.count(), cells);
+}
+
+void TestChartParser::parseChartsWithStrings_data()
+{
+    parseCharts_data();
+}
+
+void TestChartParser::binaryCharts()
+{
+    QByteArray xml = generatePattern(1000);
+
+    ChartParser parser;
+    QList<ChartData> charts;
+    QVERIFY(parser.parse(xml, &charts));
+    charts.first().cells[10].group = 2;
+    charts.first().cells[11].row = 3;
+    charts.first().cells[11].column = 4;
+
+    QByteArray data = File_v3::writeCharts(charts);
+    QVERIFY(data.size() < xml.size());
+
+    QList<ChartData> loaded;
+    QVERIFY(File_v3::readCharts(data, &loaded));
+
+    QCOMPARE(loaded.count(), 1);
+    const ChartData &a = charts.first();
+    const ChartData &b = loaded.first();
+    QCOMPARE(b.name, a.name);
+    QCOMPARE(b.style, a.style);
+    QCOMPARE(b.layers.count(), a.layers.count());
+    QCOMPARE(b.layers.first().uid, a.layers.first().uid);
+    QCOMPARE(b.cells.count(), a.cells.count());
+
+    for(int i = 0; i < a.cells.count(); ++i) {
+        const CellData &x = a.cells.at(i);
+        const CellData &y = b.cells.at(i);
+        QCOMPARE(y.stitch, x.stitch);
+        QCOMPARE(y.color, x.color);
+        QCOMPARE(y.bgColor, x.bgColor);
+        QCOMPARE(y.layer, x.layer);
+        QCOMPARE(y.group, x.group);
+        QCOMPARE(y.row, x.row);
+        QCOMPARE(y.column, x.column);
+        QCOMPARE(y.position, x.position);
+        QCOMPARE(y.rotation, x.rotation);
+        QCOMPARE(y.pivotScale, x.pivotScale);
+        QCOMPARE(y.pivotPoint, x.pivotPoint);
+        QCOMPARE(y.transform, x.transform);
+    }
+
+    //a damaged file is rejected.
+    QList<ChartData> damaged;
+    QVERIFY(!File_v3::readCharts(data.left(data.size() / 2), &damaged));
+
+    //a cell count that doesn't fit in the section is rejected before the cells are created.
+    QList<ChartData> single;
+    single << charts.first();
+    single.first().cells = charts.first().cells.mid(0, 1);
+    QByteArray small = File_v3::writeCharts(single);
+    int section = small.indexOf("CELL");
+    QVERIFY(section >= 0);
+
+    //skip the section id, version, flags and payload size.
+    QDataStream patch(&small, QIODevice::ReadWrite);
+    patch.device()->seek(section + 4 + 2 + 1 + 4);
+    patch << (quint32)0xffffffff;
+    QVERIFY(!File_v3::readCharts(small, &damaged));
+}
+
+void TestChartParser::chartIndex()
+{
+    ChartParser parser;
+    QList<ChartData> charts;
+    QVERIFY(parser.parse(generatePattern(100), &charts));
+    QVERIFY(parser.parse(generatePattern(200), &charts));
+    QCOMPARE(charts.count(), 2);
+    charts[1].name = "Second";
+
+    //a single chart doesn't need an index.
+    QList<ChartIndexData> index;
+    QVERIFY(!File_v3::readIndex(File_v3::writeCharts(charts.mid(0, 1)), &index));
+
+    QByteArray data = File_v3::writeCharts(charts);
+    QVERIFY(File_v3::readIndex(data, &index));
+    QCOMPARE(index.count(), 2);
+    QCOMPARE(index.at(0).offset, (quint32)0);
+    QCOMPARE(index.at(1).offset, index.at(0).size);
+
+    for(int i = 0; i < index.count(); ++i) {
+        const ChartIndexData &entry = index.at(i);
+        QCOMPARE(entry.name, charts.at(i).name);
+
+        QMap<QString, int> stitches, colors;
+        File_v3::chartCounts(charts.at(i), &stitches, &colors);
+        QCOMPARE(entry.stitches, stitches);
+        QCOMPARE(entry.colors, colors);
+
+        QList<ChartData> loaded;
+        QVERIFY(File_v3::readCharts(data.mid(entry.offset, entry.size), &loaded));
+        QCOMPARE(loaded.count(), 1);
+        QCOMPARE(loaded.first().name, charts.at(i).name);
+        QCOMPARE(loaded.first().cells.count(), charts.at(i).cells.count());
+    }
+
+    //the index is skipped when all the charts are read.
+    QList<ChartData> loaded;
+    QVERIFY(File_v3::readCharts(data, &loaded));
+    QCOMPARE(loaded.count(), 2);
+}
+
+QByteArray TestChartParser::cellsRecord(quint64 seq, const QList<CellData> &cells)
+{
+    ChartData chart;
+    chart.cells = cells;
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_7);
+    out << (quint16)0 << File_v3::writeCharts(QList<ChartData>() << chart);
+    return Journal::frame(seq, Journal::Op_Items, data);
+}
+
+void TestChartParser::journalReplay()
+{
+    ChartParser parser;
+    QList<ChartData> charts;
+    QVERIFY(parser.parse(generatePattern(20), &charts));
+    QList<CellData> &cells = charts.first().cells;
+    for(int i = 0; i < cells.count(); ++i)
+        cells[i].id = i + 1;
+
+    QByteArray journal;
+    QDataStream out(&journal, QIODevice::WriteOnly);
+    out << (quint32)0x434a524e << (quint16)1;
+
+    //already in the checkpoint.
+    CellData before = cells.at(0);
+    before.stitch = "tr";
+    journal.append(cellsRecord(3, QList<CellData>() << before));
+
+    QByteArray name;
+    QDataStream nameOut(&name, QIODevice::WriteOnly);
+    nameOut << QString("/tmp/pattern.pattern");
+    journal.append(Journal::frame(6, Journal::Op_FileName, name));
+
+    CellData moved = cells.at(1);
+    moved.position = QPointF(100, 200);
+    CellData added;
+    added.id = 1000;
+    added.stitch = "dc";
+    journal.append(cellsRecord(7, QList<CellData>() << moved << added));
+
+    QByteArray removed;
+    QDataStream removedOut(&removed, QIODevice::WriteOnly);
+    removedOut << (quint16)0 << (QVector<quint32>() << 3);
+    journal.append(Journal::frame(8, Journal::Op_Remove, removed));
+
+    added.color = "#ff0000";
+    journal.append(cellsRecord(9, QList<CellData>() << added));
+
+    //the program stopped while this record was written.
+    QByteArray torn;
+    QDataStream tornOut(&torn, QIODevice::WriteOnly);
+    tornOut << (quint16)0 << (QVector<quint32>() << 4);
+    journal.append(Journal::frame(10, Journal::Op_Remove, torn).left(12));
+
+    QString fileName;
+    QList<ChartData> replayed = charts;
+    QVERIFY(Journal::replay(journal, 5, &replayed, &fileName));
+
+    QCOMPARE(fileName, QString("/tmp/pattern.pattern"));
+
+    QHash<quint32, CellData> result;
+    foreach(const CellData &c, replayed.first().cells)
+        result.insert(c.id, c);
+
+    QCOMPARE(result.count(), cells.count());
+    QCOMPARE(result.value(1).stitch, cells.at(0).stitch);
+    QCOMPARE(result.value(2).position, QPointF(100, 200));
+    QVERIFY(!result.contains(3));
+    QVERIFY(result.contains(4));
+    QCOMPARE(result.value(1000).stitch, QString("dc"));
+    QCOMPARE(result.value(1000).color, QString("#ff0000"));
+}
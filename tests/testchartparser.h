@@ -0,0 +1,61 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef TESTCHARTPARSER_H
+#define TESTCHARTPARSER_H
+
+#include <QtTest/QTest>
+#include <QDebug>
+#include <QObject>
+
+#include "../src/chartparser.h"
+#include "../src/file_v3.h"
+#include "../src/journal.h"
+
+class TestChartParser : public QObject
+{
+    Q_OBJECT
+private slots:
+    void toDouble();
+    void toDouble_data();
+
+    void parseCells();
+
+    //load time of the chart xml.
+    void parseCharts();
+    void parseCharts_data();
+    //the same document read with a QString for every tag and number, for comparison.
+    void parseChartsWithStrings();
+    void parseChartsWithStrings_data();
+
+    //the same charts saved and loaded as version 1.3 sections.
+    void binaryCharts();
+    //the index lets each chart of a file be read on its own.
+    void chartIndex();
+
+    //a checkpoint with the autosave journal records after it.
+    void journalReplay();
+
+private:
+    QByteArray generatePattern(int cells);
+    QByteArray cellsRecord(quint64 seq, const QList<CellData> &cells);
+};
+
+#endif // TESTCHARTPARSER_H
@@ -0,0 +1,329 @@
+/****************************************************************************\
+ Copyright (c) 2010-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "testscene.h"
+#include "../src/stitchlibrary.h"
+#include "../src/cell.h"
+#include "../src/indicator.h"
+#include "../src/svgwriter.h"
+#include "../src/crochettab.h"
+#include "../src/pagetiler.h"
+
+#include <QBuffer>
+#include <QPainter>
+#include <QtSvg/QSvgRenderer>
+
+#include <math.h>
+
+void TestScene::initTestCase()
+{
+    StitchLibrary::inst()->loadStitchSets();
+}
+
+QPointF TestScene::cellPosition(int index, int count)
+{
+    //lay the stitches out in a square so the chart grows in both directions.
+    int columns = (int)ceil(sqrt((double)count));
+    return QPointF((index % columns) * 40.0, (index / columns) * 100.0);
+}
+
+void TestScene::selectableItemAt()
+{
+    QFETCH(int, count);
+
+    Scene *scene = new Scene();
+    Stitch *s = StitchLibrary::inst()->findStitch("dc");
+    QList<Cell*> cells;
+
+    for(int i = 0; i < count; ++i) {
+        Cell *c = new Cell();
+        c->setStitch(s);
+        c->setPos(cellPosition(i, count));
+        scene->addItem(c);
+        cells.append(c);
+    }
+
+    int index = count / 2;
+    QPointF pos = cellPosition(index, count) + QPointF(16, 40);
+
+    QCOMPARE(scene->selectableItemAt(pos), (QGraphicsItem*)cells.at(index));
+
+    QGraphicsItem *item = 0;
+    QBENCHMARK {
+        item = scene->selectableItemAt(pos);
+    }
+    QCOMPARE(item, (QGraphicsItem*)cells.at(index));
+
+    delete scene;
+    scene = 0;
+}
+
+void TestScene::selectableItemAt_data()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("1k")     << 1000;
+    QTest::newRow("10k")    << 10000;
+    QTest::newRow("100k")   << 100000;
+}
+
+void TestScene::cellStoreCellAt()
+{
+    QFETCH(int, count);
+
+    CellStore store;
+    Stitch *s = StitchLibrary::inst()->findStitch("dc");
+
+    for(int i = 0; i < count; ++i) {
+        CellRecord r;
+        r.stitch = s;
+        r.pos = cellPosition(i, count);
+        store.append(r);
+    }
+
+    int index = count / 2;
+    QPointF pos = cellPosition(index, count) + QPointF(16, 40);
+
+    int found = -1;
+    QBENCHMARK {
+        found = store.cellAt(pos, 0);
+    }
+    QCOMPARE(found, index);
+
+    //removing a cell moves the last cell into its place, it must still be found.
+    store.remove(index);
+    QCOMPARE(store.cellAt(pos, 0), -1);
+    QCOMPARE(store.cellAt(cellPosition(count - 1, count) + QPointF(16, 40), 0), index);
+}
+
+void TestScene::cellStoreCellAt_data()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("1k")     << 1000;
+    QTest::newRow("10k")    << 10000;
+    QTest::newRow("100k")   << 100000;
+}
+
+void TestScene::cellStoreGrid()
+{
+    Scene *scene = new Scene();
+    scene->createRowsChart(2, 3, "dc", QSizeF(32, 96));
+
+    //store the last stitch of the second row the way a chart is loaded.
+    Cell *c = scene->cell(1, 2);
+    CellRecord r = CellStore::recordFromCell(c);
+    r.row = 1;
+    r.column = 2;
+    scene->setGridCell(1, 2, 0);
+    scene->removeItem(c);
+    delete c;
+    scene->addCellRecord(r);
+
+    QCOMPARE(scene->cellStore()->gridCellCount(), 1);
+    QCOMPARE(scene->columnCount(1), 3);
+
+    //deleting a stitch in front of it moves the stored stitch without making it a Cell.
+    Cell *first = scene->cell(1, 0);
+    scene->removeItem(first);
+    delete first;
+
+    QCOMPARE(scene->columnCount(1), 2);
+    QCOMPARE(scene->cellStore()->count(), 1);
+    QCOMPARE(scene->cellStore()->column(0), 1);
+    QCOMPARE(scene->gridStitch(1, 1), r.stitch);
+
+    c = scene->cell(1, 1);
+    QVERIFY(c);
+    QCOMPARE(scene->cellStore()->count(), 0);
+    QCOMPARE(scene->indexOf(c), QPoint(1, 1));
+    QCOMPARE(c->pos(), r.pos);
+    QVERIFY(scene->checkGridIndex());
+
+    delete scene;
+}
+
+void TestScene::createRoundsChart()
+{
+    QFETCH(int, rows);
+    QFETCH(int, columns);
+
+    Scene *scene = 0;
+    QBENCHMARK_ONCE {
+        scene = new Scene();
+        scene->createRoundsChart(rows, columns, "dc", QSizeF(32, 96), 0);
+    }
+
+    QCOMPARE(scene->rowCount(), rows);
+    QCOMPARE(scene->columnCount(rows - 1), columns);
+
+    //the first stitch of each round is to the right of the center, standing up.
+    Cell *c = scene->cell(0, 0);
+    QCOMPARE(c->rotation(), 90.0);
+    QCOMPARE(c->pos(), QPointF(96 + 32 - 16, -40));
+
+    delete scene;
+    scene = 0;
+}
+
+void TestScene::createRoundsChart_data()
+{
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<int>("columns");
+
+    QTest::newRow("10k")    << 50 << 200;
+    QTest::newRow("100k")   << 100 << 1000;
+}
+
+void TestScene::createRowsChart()
+{
+    QFETCH(int, rows);
+    QFETCH(int, columns);
+
+    Scene *scene = 0;
+    QBENCHMARK_ONCE {
+        scene = new Scene();
+        scene->createRowsChart(rows, columns, "dc", QSizeF(32, 96));
+    }
+
+    QCOMPARE(scene->rowCount(), rows);
+    QCOMPARE(scene->columnCount(0), columns);
+
+    delete scene;
+    scene = 0;
+}
+
+void TestScene::createRowsChart_data()
+{
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<int>("columns");
+
+    QTest::newRow("10k")    << 100 << 100;
+    QTest::newRow("100k")   << 250 << 400;
+}
+
+void TestScene::svgSymbols()
+{
+    Scene *scene = new Scene();
+    Stitch *s = StitchLibrary::inst()->findStitch("dc");
+
+    int count = 500;
+    for(int i = 0; i < count; ++i) {
+        Cell *c = new Cell();
+        c->setStitch(s);
+        c->setColor(i % 2 ? QColor(Qt::black) : QColor(Qt::red));
+        c->setPos(cellPosition(i, count));
+        scene->addItem(c);
+    }
+
+    Indicator *ind = new Indicator();
+    ind->setText("Row 1");
+    ind->setStyle("Dots and Text");
+    scene->addItem(ind);
+
+    QByteArray svg;
+    QBuffer buffer(&svg);
+    buffer.open(QIODevice::WriteOnly);
+
+    SvgWriter writer;
+    QVERIFY(writer.write(&buffer, scene, scene->itemsBoundingRect()));
+    QCOMPARE(writer.symbolCount(), 2);
+    QCOMPARE(svg.count("<symbol"), 2);
+    QCOMPARE(svg.count("<use"), count);
+    QVERIFY(svg.contains("Row 1"));
+
+    QSvgRenderer renderer(svg);
+    QVERIFY(renderer.isValid());
+
+    delete scene;
+    scene = 0;
+}
+
+void TestScene::renderSelection()
+{
+    QMap<QString, int> stitches;
+    QMap<QString, QMap<QString, qint64> > colors;
+    CrochetTab *tab = new CrochetTab(Scene::Blank, 0, "dc", QColor(Qt::black), QColor(Qt::white));
+    tab->setPatternStitches(&stitches);
+    tab->setPatternColors(&colors);
+
+    Stitch *s = StitchLibrary::inst()->findStitch("dc");
+    QList<Cell*> cells;
+    for(int i = 0; i < 3; ++i) {
+        Cell *c = new Cell();
+        c->setStitch(s);
+        c->setPos(cellPosition(i, 3));
+        tab->scene()->addItem(c);
+        cells.append(c);
+    }
+
+    cells.at(1)->setVisible(false);
+    cells.at(2)->setSelected(true);
+
+    QImage img(200, 200, QImage::Format_ARGB32);
+    img.fill(QColor(Qt::white).rgba());
+    QPainter p(&img);
+    tab->renderChartSelected(&p, QRectF(0, 0, 200, 200));
+    p.end();
+
+    QVERIFY(cells.at(0)->isVisible());
+    QVERIFY(!cells.at(1)->isVisible());
+    QVERIFY(cells.at(2)->isVisible());
+    QVERIFY(cells.at(2)->isSelected());
+
+    //the selected stitch was drawn.
+    bool drawn = false;
+    for(int y = 0; y < img.height() && !drawn; ++y) {
+        for(int x = 0; x < img.width() && !drawn; ++x)
+            drawn = (img.pixel(x, y) != QColor(Qt::white).rgba());
+    }
+    QVERIFY(drawn);
+
+    delete tab;
+    tab = 0;
+}
+
+void TestScene::pageTiles()
+{
+    QRectF chart(0, 0, 1000, 500);
+    PageTiler tiler(chart, QRectF(0, 0, 340, 340), 1.0, 20, 20);
+
+    QCOMPARE(tiler.targetRect(), QRectF(20, 20, 300, 300));
+    QCOMPARE(tiler.columns(), 4);
+    QCOMPARE(tiler.rows(), 2);
+    QCOMPARE(tiler.count(), 8);
+
+    QCOMPARE(tiler.sourceRect(0), QRectF(0, 0, 300, 300));
+    QCOMPARE(tiler.sourceRect(5), QRectF(280, 280, 300, 300));
+
+    //every part of the chart is on a page.
+    QRectF covered;
+    for(int i = 0; i < tiler.count(); ++i)
+        covered = covered.united(tiler.sourceRect(i));
+    QVERIFY(covered.contains(chart));
+
+    //a chart that fits is printed on one page.
+    PageTiler small(QRectF(0, 0, 100, 100), QRectF(0, 0, 340, 340), 2.0, 20, 20);
+    QCOMPARE(small.count(), 1);
+}
+
+void TestScene::cleanupTestCase()
+{
+}
@@ -0,0 +1,66 @@
+/****************************************************************************\
+ Copyright (c) 2010-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef TESTSCENE_H
+#define TESTSCENE_H
+
+#include <QtTest/QTest>
+#include <QDebug>
+#include <QObject>
+
+#include "../src/scene.h"
+
+class TestScene : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+
+    //press to select latency.
+    void selectableItemAt();
+    void selectableItemAt_data();
+
+    void cellStoreCellAt();
+    void cellStoreCellAt_data();
+    //a stored stitch on the grid goes back to its row and column.
+    void cellStoreGrid();
+
+    //chart generation from the new chart dialog.
+    void createRoundsChart();
+    void createRoundsChart_data();
+    void createRowsChart();
+    void createRowsChart_data();
+
+    //svg export writes each stitch once no matter how many cells use it.
+    void svgSymbols();
+
+    //exporting the selection leaves hidden items hidden.
+    void renderSelection();
+
+    //a chart printed at a fixed stitch size is split across overlapping pages.
+    void pageTiles();
+
+    void cleanupTestCase();
+
+private:
+    QPointF cellPosition(int index, int count);
+};
+
+#endif // TESTSCENE_H
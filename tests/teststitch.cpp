@@ -26,9 +26,12 @@
 #include <QtSvg/QSvgGenerator>
 
 #include <QFile>
+#include <QFileInfo>
 #include <QCryptographicHash>
 #include <QDebug>
 
+#include "../src/iconstore.h"
+
 void TestStitch::initTestCase()
 {
     mS = new Stitch();
@@ -164,6 +167,30 @@ void TestStitch::stitchRender_data()
 //TODO: render other stitches esp tall and wide stitches.
 }
 
+void TestStitch::stitchFromIconStore()
+{
+    QFile f("../stitches/ch.svg");
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QByteArray data = f.readAll();
+
+    //the same icon in two documents is only stored once.
+    int count = IconStore::inst()->count();
+    QString path = IconStore::inst()->addIcon(data, "ch.svg");
+    QString other = IconStore::inst()->addIcon(data, "chain.svg");
+    QCOMPARE(IconStore::inst()->count(), count + 1);
+    QVERIFY(IconStore::isStored(path));
+    QCOMPARE(QFileInfo(path).fileName(), QString("ch.svg"));
+    QCOMPARE(QFileInfo(other).fileName(), QString("chain.svg"));
+    QCOMPARE(IconStore::inst()->iconData(other), data);
+
+    Stitch file, stored;
+    file.setFile("../stitches/ch.svg");
+    stored.setFile(path);
+    QVERIFY(stored.isSvg());
+    QCOMPARE(stored.width(), file.width());
+    QCOMPARE(stored.height(), file.height());
+}
+
 void TestStitch::cleanupTestCase()
 {
 }
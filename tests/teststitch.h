@@ -35,6 +35,8 @@ private slots:
     void stitchSetup();
     void stitchRender();
     void stitchRender_data();
+    //icons embedded in a document are loaded from memory.
+    void stitchFromIconStore();
     void cleanupTestCase();
 
 private:
@@ -0,0 +1,202 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#include "testundostack.h"
+
+#include "../src/crochetchartcommands.h"
+
+/**
+ * Counts how often it was done, commands with the same id merge.
+ */
+class CountCommand : public QUndoCommand
+{
+public:
+    CountCommand(const QString &text, int *count, int id = -1)
+        : QUndoCommand(text), mCount(count), mId(id) {}
+
+    void redo() { (*mCount)++; }
+    void undo() { (*mCount)--; }
+    int id() const { return mId; }
+
+    bool mergeWith(const QUndoCommand *other)
+    {
+        const CountCommand *cmd = dynamic_cast<const CountCommand*>(other);
+        if(!cmd || cmd->mId != mId)
+            return false;
+        setText(text() + cmd->text());
+        return true;
+    }
+
+private:
+    int *mCount;
+    int mId;
+};
+
+qint64 TestUndoStack::commandSize(const QString &text)
+{
+    QUndoCommand cmd(text);
+    return undoCommandSize(&cmd);
+}
+
+void TestUndoStack::mergeMemoryUsage()
+{
+    int count = 0;
+    UndoStack stack;
+
+    stack.push(new CountCommand("a", &count, 1));
+    stack.push(new CountCommand("bbbb", &count, 1));
+
+    QCOMPARE(stack.count(), 1);
+    QCOMPARE(stack.text(0), QString("abbbb"));
+    QCOMPARE(count, 2);
+    QCOMPARE(stack.memoryUsage(), commandSize("abbbb"));
+
+    stack.push(new CountCommand("c", &count));
+    QCOMPARE(stack.memoryUsage(), commandSize("abbbb") + commandSize("c"));
+}
+
+void TestUndoStack::macroMemoryUsage()
+{
+    int count = 0;
+    UndoStack stack;
+
+    stack.push(new CountCommand("a", &count));
+    stack.beginMacro("macro");
+    stack.push(new CountCommand("b", &count));
+    stack.push(new CountCommand("c", &count));
+    stack.endMacro();
+
+    QCOMPARE(stack.count(), 2);
+    QCOMPARE(count, 3);
+    QCOMPARE(stack.memoryUsage(), commandSize("a") + commandSize("macro") + commandSize("b") + commandSize("c"));
+
+    //the whole macro is deleted when a new command replaces it.
+    stack.undo();
+    QCOMPARE(count, 1);
+    stack.push(new CountCommand("d", &count));
+    QCOMPARE(stack.count(), 2);
+    QCOMPARE(stack.memoryUsage(), commandSize("a") + commandSize("d"));
+}
+
+void TestUndoStack::discardRedoMemoryUsage()
+{
+    int count = 0;
+    UndoStack stack;
+
+    stack.push(new CountCommand("a", &count));
+    stack.push(new CountCommand("bb", &count));
+    stack.push(new CountCommand("ccc", &count));
+    stack.undo();
+    stack.undo();
+
+    //the commands that can be redone are still counted.
+    QCOMPARE(stack.memoryUsage(), commandSize("a") + commandSize("bb") + commandSize("ccc"));
+
+    stack.push(new CountCommand("dddd", &count));
+    QCOMPARE(stack.count(), 2);
+    QCOMPARE(count, 2);
+    QCOMPARE(stack.memoryUsage(), commandSize("a") + commandSize("dddd"));
+}
+
+void TestUndoStack::trimKeepsRedo()
+{
+    int count = 0;
+    UndoStack stack;
+
+    for(int i = 1; i <= 5; ++i)
+        stack.push(new CountCommand(QString::number(i), &count));
+    stack.undo();
+    QCOMPARE(count, 4);
+
+    qint64 size = commandSize("1");
+    stack.trimTo(2 * size);
+
+    //the last command done and the one that can be redone are kept, nothing is run again.
+    QCOMPARE(stack.count(), 2);
+    QCOMPARE(stack.index(), 1);
+    QCOMPARE(count, 4);
+    QCOMPARE(stack.memoryUsage(), 2 * size);
+
+    QVERIFY(stack.canRedo());
+    QCOMPARE(stack.redoText(), QString("5"));
+    stack.redo();
+    QCOMPARE(count, 5);
+
+    stack.undo();
+    stack.undo();
+    QCOMPARE(count, 3);
+    QVERIFY(!stack.canUndo());
+    QCOMPARE(stack.memoryUsage(), 2 * size);
+}
+
+void TestUndoStack::trimCleanBeforeDrop()
+{
+    int count = 0;
+    UndoStack stack;
+
+    stack.push(new CountCommand("1", &count));
+    stack.push(new CountCommand("2", &count));
+    stack.setClean();
+    for(int i = 3; i <= 5; ++i)
+        stack.push(new CountCommand(QString::number(i), &count));
+
+    qint64 size = commandSize("1");
+    stack.trimTo(2 * size);
+
+    QCOMPARE(stack.count(), 2);
+    QCOMPARE(stack.index(), 2);
+    QCOMPARE(stack.memoryUsage(), 2 * size);
+    QVERIFY(!stack.isClean());
+
+    //the saved state was dropped, undoing everything doesn't get back to it.
+    stack.undo();
+    stack.undo();
+    QCOMPARE(count, 3);
+    QVERIFY(!stack.isClean());
+    QCOMPARE(stack.cleanIndex(), -1);
+}
+
+void TestUndoStack::trimCleanAfterDrop()
+{
+    int count = 0;
+    UndoStack stack;
+
+    for(int i = 1; i <= 4; ++i)
+        stack.push(new CountCommand(QString::number(i), &count));
+    stack.setClean();
+    stack.push(new CountCommand("5", &count));
+
+    qint64 size = commandSize("1");
+    stack.trimTo(2 * size);
+
+    QCOMPARE(stack.count(), 2);
+    QCOMPARE(stack.index(), 2);
+    QCOMPARE(stack.cleanIndex(), 1);
+    QCOMPARE(stack.memoryUsage(), 2 * size);
+    QVERIFY(!stack.isClean());
+
+    stack.undo();
+    QCOMPARE(count, 4);
+    QVERIFY(stack.isClean());
+
+    stack.redo();
+    QVERIFY(!stack.isClean());
+    QCOMPARE(count, 5);
+}
@@ -0,0 +1,54 @@
+/****************************************************************************\
+ Copyright (c) 2011-2014 Stitch Works Software
+ Brian C. Milco <bcmilco@gmail.com>
+
+ This file is part of Crochet Charts.
+
+ Crochet Charts is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Crochet Charts is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Crochet Charts. If not, see <http://www.gnu.org/licenses/>.
+
+ \****************************************************************************/
+#ifndef TESTUNDOSTACK_H
+#define TESTUNDOSTACK_H
+
+#include <QtTest/QTest>
+#include <QDebug>
+#include <QObject>
+
+#include "../src/undostack.h"
+
+class TestUndoStack : public QObject
+{
+    Q_OBJECT
+private slots:
+    //merged commands are counted once, with the size of the merged command.
+    void mergeMemoryUsage();
+    //a macro is counted with the commands inside it.
+    void macroMemoryUsage();
+    //the commands deleted by a new push aren't counted any more.
+    void discardRedoMemoryUsage();
+    //trimming keeps the commands that can be redone.
+    void trimKeepsRedo();
+    //a clean state before the dropped commands can't be reached again.
+    void trimCleanBeforeDrop();
+    //a clean state after the dropped commands moves with the stack.
+    void trimCleanAfterDrop();
+
+private:
+    /**
+     * The size the stack counts for a command with @text.
+     */
+    qint64 commandSize(const QString &text);
+};
+
+#endif // TESTUNDOSTACK_H